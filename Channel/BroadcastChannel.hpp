@@ -0,0 +1,234 @@
+/**
+ * @file BroadcastChannel.hpp
+ * @author Aaryaman Sagar
+ *
+ * A channel where every value sent is read by every subscriber, as opposed to
+ * sharp::Channel where each value is read by exactly one reader
+ */
+
+#pragma once
+
+#include <sharp/Channel/detail/Channel-pre.hpp>
+#include <sharp/Portability/cpp17.hpp>
+#include <sharp/Try/Try.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace sharp {
+
+/**
+ * What a broadcast channel does when a value is sent while the slowest
+ * subscriber is a full buffer behind
+ *
+ * BLOCK makes the send wait till the slowest subscriber reads a value,
+ * nothing is ever lost but one slow subscriber slows everyone down
+ *
+ * DROP_OLDEST overwrites the oldest value in the buffer, subscribers that had
+ * not read it yet skip it, see Subscriber::dropped()
+ *
+ * DISCONNECT disconnects the subscribers that are holding the send up, their
+ * next read throws a SubscriberDisconnectedError
+ */
+enum class BroadcastOverflow {
+    BLOCK,
+    DROP_OLDEST,
+    DISCONNECT,
+};
+
+/**
+ * @class SubscriberDisconnectedError
+ *
+ * Thrown from a read on a subscriber that fell too far behind on a
+ * broadcast channel with the DISCONNECT overflow policy.  As far as that
+ * subscriber is concerned the channel has been closed, so this derives from
+ * ChannelClosedError
+ */
+class SubscriberDisconnectedError : public ChannelClosedError {
+public:
+    using ChannelClosedError::ChannelClosedError;
+};
+
+/**
+ * @class BroadcastChannel
+ *
+ * A fan out channel, values are written once into a single ring buffer and
+ * every subscriber reads them from there at its own pace, each keeps its own
+ * cursor into the buffer
+ *
+ *      auto channel = sharp::BroadcastChannel<int>{64};
+ *      auto one = channel.subscribe();
+ *      auto two = channel.subscribe();
+ *
+ *      channel.send(1);
+ *      assert(one.read() == 1);
+ *      assert(two.read() == 1);
+ *
+ * This replaces looping over a vector of channels and sending a copy of the
+ * value to each, a send takes one lock and does one copy (or move) no matter
+ * how many subscribers there are.  The buffer holds sharp::Try objects, so
+ * exceptions sent with send_exception() reach every subscriber as well
+ *
+ * A subscriber only sees the values sent after it subscribed, and values sent
+ * while there are no subscribers are not read by anyone.  Once the channel is
+ * closed subscribers can still read the values left in the buffer, after
+ * which reads throw a ChannelClosedError
+ *
+ * The buffer is allocated once at construction and the values in it are
+ * only destroyed when they are overwritten or when the channel is destroyed.
+ * Subscribers do not take the internal lock to read a value that is already
+ * in the buffer, they only take it to wait for one.  Each slot carries the
+ * sequence number of the value in it and a count of the subscribers copying
+ * out of it, a sender about to overwrite a slot waits for those copies to
+ * finish.  So subscribers copy values out in parallel with each other and
+ * with the sender
+ */
+template <typename Type,
+          typename Mutex = std::mutex,
+          typename Cv = std::condition_variable>
+class BroadcastChannel {
+public:
+
+    /**
+     * The buffer size must be at least 1, otherwise this throws a
+     * std::invalid_argument
+     */
+    explicit BroadcastChannel(
+            int buffer_size,
+            BroadcastOverflow overflow = BroadcastOverflow::BLOCK);
+
+    /**
+     * Not copyable or movable, for the same reasons as sharp::Channel
+     */
+    BroadcastChannel(const BroadcastChannel&) = delete;
+    BroadcastChannel(BroadcastChannel&&) = delete;
+    BroadcastChannel& operator=(const BroadcastChannel&) = delete;
+    BroadcastChannel& operator=(BroadcastChannel&&) = delete;
+
+    /**
+     * A handle with a read cursor into the channel, values are read through
+     * this.  A subscriber can be moved but not copied, and it unsubscribes
+     * when it is destroyed.  Subscribers must not outlive the channel
+     *
+     * Each subscriber should only be used by one thread at a time
+     */
+    class Subscriber;
+
+    /**
+     * Create a new subscriber, it will read every value sent from here on
+     */
+    Subscriber subscribe();
+
+    /**
+     * Send a value or an exception to all the subscribers, this throws a
+     * ChannelClosedError if the channel is closed.  What happens when the
+     * buffer is full is decided by the overflow policy, see
+     * BroadcastOverflow
+     */
+    void send(const Type& value);
+    void send(Type&& value);
+    void send_exception(std::exception_ptr exception);
+
+    /**
+     * Close the channel, this wakes up every subscriber and sender blocked on
+     * the channel
+     */
+    void close();
+    bool is_closed();
+
+private:
+
+    /**
+     * The state of a subscriber, the sequence number of the next value it
+     * will read, the number of values it has skipped because they were
+     * overwritten and whether it has been disconnected.  Only the subscriber
+     * writes next and dropped, senders read next to find the oldest value
+     * still wanted and set disconnected
+     */
+    struct Cursor {
+        explicit Cursor(std::size_t next_in) : next{next_in} {}
+        std::atomic<std::size_t> next;
+        std::size_t dropped{0};
+        std::atomic<bool> disconnected{false};
+    };
+    using CursorIterator = typename std::list<Cursor>::iterator;
+
+    /**
+     * Write a value into the slot after the newest one, the enqueue function
+     * is passed the slot to construct the Try in
+     */
+    template <typename EnqueueFunc>
+    void send_impl(EnqueueFunc enqueue);
+
+    /**
+     * Read the next value for the subscriber, returns an empty Try if there
+     * is nothing to read (in which case the channel has been closed if this
+     * was blocking)
+     */
+    sharp::Try<Type> read(CursorIterator cursor, bool blocking);
+    void unsubscribe(CursorIterator cursor);
+
+    /**
+     * Copy the next value for the subscriber out of the buffer without
+     * taking the lock, returns an empty Try if there is no value to read yet
+     */
+    sharp::Try<Type> read_slot(Cursor& cursor);
+
+    /**
+     * The sequence number of the oldest value that a connected subscriber
+     * has not read yet, this must be called with the mutex held
+     */
+    std::size_t oldest() const;
+
+    /**
+     * A slot in the ring buffer, sequence is the sequence number of the value
+     * in it or empty while there is none, and readers is the number of
+     * subscribers that might be copying the value out
+     */
+    struct Slot {
+        static constexpr auto empty = ~std::size_t{0};
+        std::atomic<std::size_t> sequence{empty};
+        std::atomic<int> readers{0};
+        std::optional<sharp::Try<Type>> value;
+    };
+
+    /**
+     * The ring buffer and the sequence numbers of the oldest value that is
+     * still in it and of the next value to be sent.  A value with sequence
+     * number n lives in slot n % slots.size().  Both are only written with
+     * the mutex held, subscribers read them without it
+     */
+    std::vector<Slot> slots;
+    std::atomic<std::size_t> head{0};
+    std::atomic<std::size_t> tail{0};
+
+    /**
+     * The subscribers, a list so that each can hold on to its own cursor
+     * while others come and go
+     */
+    std::list<Cursor> cursors;
+
+    const BroadcastOverflow overflow;
+    bool closed{false};
+
+    /**
+     * Subscribers wait on one condition variable for values and senders on
+     * the other for space, each is only signalled if there are threads
+     * waiting on it.  Subscribers check waiting_senders without the mutex
+     * after moving their cursor, so it is atomic
+     */
+    Mutex mtx;
+    Cv readers;
+    Cv senders;
+    int waiting_readers{0};
+    std::atomic<int> waiting_senders{0};
+};
+
+} // namespace sharp
+
+#include <sharp/Channel/BroadcastChannel.ipp>
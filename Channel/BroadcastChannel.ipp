@@ -0,0 +1,295 @@
+#pragma once
+
+#include <sharp/Channel/BroadcastChannel.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace sharp {
+
+template <typename Type, typename Mutex, typename Cv>
+class BroadcastChannel<Type, Mutex, Cv>::Subscriber {
+public:
+
+    /**
+     * A moved from subscriber cannot be used to read anymore
+     */
+    Subscriber(Subscriber&& other) noexcept
+            : channel{other.channel}, cursor{other.cursor} {
+        other.channel = nullptr;
+    }
+    Subscriber(const Subscriber&) = delete;
+    Subscriber& operator=(const Subscriber&) = delete;
+    Subscriber& operator=(Subscriber&&) = delete;
+
+    ~Subscriber() {
+        if (this->channel) {
+            this->channel->unsubscribe(this->cursor);
+        }
+    }
+
+    /**
+     * Read the next value, blocking till there is one.  These work like the
+     * corresponding methods on sharp::Channel, read() throws the exception
+     * if one was sent and a ChannelClosedError once the channel is closed
+     * and this subscriber has read everything.  read_try() returns those
+     * in the Try instead.  try_read() returns an empty optional instead of
+     * blocking
+     *
+     * A disconnected subscriber gets a SubscriberDisconnectedError
+     */
+    Type read() {
+        return this->read_try().get();
+    }
+    sharp::Try<Type> read_try() {
+        auto element = this->channel->read(this->cursor, true);
+        if (!element.valid()) {
+            return std::make_exception_ptr(ChannelClosedError{
+                    "sharp::BroadcastChannel: read on closed channel"});
+        }
+        return element;
+    }
+    std::optional<Type> try_read() {
+        auto element = this->channel->read(this->cursor, false);
+        if (!element.valid()) {
+            return std::nullopt;
+        }
+        return std::move(element).get();
+    }
+
+    /**
+     * The number of values this subscriber has missed because they were
+     * overwritten by the DROP_OLDEST policy, as of the last read
+     */
+    std::size_t dropped() {
+        return this->cursor->dropped;
+    }
+
+    friend class BroadcastChannel;
+
+private:
+    Subscriber(BroadcastChannel* channel_in, CursorIterator cursor_in)
+        : channel{channel_in}, cursor{cursor_in} {}
+
+    BroadcastChannel* channel;
+    CursorIterator cursor;
+};
+
+template <typename Type, typename Mutex, typename Cv>
+BroadcastChannel<Type, Mutex, Cv>::BroadcastChannel(
+        int buffer_size, BroadcastOverflow overflow_in)
+        : overflow{overflow_in} {
+    if (buffer_size < 1) {
+        throw std::invalid_argument{"sharp::BroadcastChannel: the buffer "
+                                    "size must be at least 1"};
+    }
+    this->slots = std::vector<Slot>(buffer_size);
+}
+
+template <typename Type, typename Mutex, typename Cv>
+typename BroadcastChannel<Type, Mutex, Cv>::Subscriber
+BroadcastChannel<Type, Mutex, Cv>::subscribe() {
+    auto lck = std::unique_lock<Mutex>{this->mtx};
+    auto cursor = this->cursors.emplace(this->cursors.end(), this->tail);
+    return Subscriber{this, cursor};
+}
+
+template <typename Type, typename Mutex, typename Cv>
+void BroadcastChannel<Type, Mutex, Cv>::unsubscribe(CursorIterator cursor) {
+    auto lck = std::unique_lock<Mutex>{this->mtx};
+    this->cursors.erase(cursor);
+
+    // this might have been the subscriber holding a send up
+    if (this->waiting_senders.load()) {
+        this->senders.notify_all();
+    }
+}
+
+template <typename Type, typename Mutex, typename Cv>
+void BroadcastChannel<Type, Mutex, Cv>::send(const Type& value) {
+    this->send_impl([&](auto& slot) { slot.emplace(std::in_place, value); });
+}
+
+template <typename Type, typename Mutex, typename Cv>
+void BroadcastChannel<Type, Mutex, Cv>::send(Type&& value) {
+    this->send_impl([&](auto& slot) {
+        slot.emplace(std::in_place, std::move(value));
+    });
+}
+
+template <typename Type, typename Mutex, typename Cv>
+void BroadcastChannel<Type, Mutex, Cv>::send_exception(
+        std::exception_ptr exception) {
+    this->send_impl([&](auto& slot) { slot.emplace(std::move(exception)); });
+}
+
+template <typename Type, typename Mutex, typename Cv>
+std::size_t BroadcastChannel<Type, Mutex, Cv>::oldest() const {
+    // cursors that are behind the head have had their values dropped, they
+    // catch up on their next read
+    auto oldest = this->tail.load();
+    for (auto& cursor : this->cursors) {
+        if (!cursor.disconnected) {
+            oldest = std::min(oldest, std::max(cursor.next.load(),
+                                               this->head.load()));
+        }
+    }
+    return oldest;
+}
+
+template <typename Type, typename Mutex, typename Cv>
+template <typename EnqueueFunc>
+void BroadcastChannel<Type, Mutex, Cv>::send_impl(EnqueueFunc enqueue) {
+    auto lck = std::unique_lock<Mutex>{this->mtx};
+    auto size = this->slots.size();
+    while (true) {
+        if (this->closed) {
+            throw ChannelClosedError{"sharp::BroadcastChannel: send on "
+                                     "closed channel"};
+        }
+
+        // the head is only moved forward here, when the buffer looks full,
+        // so neither sends with room to spare nor reads have to look at the
+        // other subscribers
+        if (this->tail.load() - this->head.load() < size) {
+            break;
+        }
+        this->head.store(this->oldest());
+        if (this->tail.load() - this->head.load() < size) {
+            break;
+        }
+
+        if (this->overflow == BroadcastOverflow::BLOCK) {
+            // subscribers move their cursors without the mutex and then
+            // check for waiting senders, so look at the cursors once more
+            // after announcing this one
+            ++this->waiting_senders;
+            this->head.store(this->oldest());
+            if (this->tail.load() - this->head.load() >= size) {
+                this->senders.wait(lck);
+            }
+            --this->waiting_senders;
+        } else if (this->overflow == BroadcastOverflow::DROP_OLDEST) {
+            ++this->head;
+            break;
+        } else {
+            // every connected subscriber at the head is holding the send up,
+            // cut them off and look again
+            for (auto& cursor : this->cursors) {
+                if (!cursor.disconnected.load()
+                        && cursor.next.load() <= this->head.load()) {
+                    cursor.disconnected.store(true);
+                }
+            }
+            if (this->waiting_readers) {
+                this->readers.notify_all();
+            }
+        }
+    }
+
+    // mark the slot empty before waiting for the subscribers copying out of
+    // it, a subscriber either sees the mark or is seen here, see read_slot()
+    auto sequence = this->tail.load();
+    auto& slot = this->slots[sequence % size];
+    slot.sequence.store(Slot::empty);
+    while (slot.readers.load()) {
+        std::this_thread::yield();
+    }
+
+    // if the enqueue function throws then the tail is not moved, so the
+    // empty slot is never read
+    slot.value = std::nullopt;
+    enqueue(slot.value);
+    slot.sequence.store(sequence);
+    this->tail.store(sequence + 1);
+    if (this->waiting_readers) {
+        this->readers.notify_all();
+    }
+}
+
+template <typename Type, typename Mutex, typename Cv>
+sharp::Try<Type> BroadcastChannel<Type, Mutex, Cv>::read_slot(Cursor& cursor) {
+    while (true) {
+        // skip over whatever was overwritten since the last read
+        auto next = cursor.next.load();
+        auto head = this->head.load();
+        if (next < head) {
+            cursor.dropped += head - next;
+            next = head;
+            cursor.next.store(next);
+        }
+        if (next >= this->tail.load()) {
+            return nullptr;
+        }
+
+        // announce the copy before checking that the slot still holds the
+        // value, a sender overwriting it either waits for the copy to finish
+        // or has already marked the slot and moved the head past it
+        auto& slot = this->slots[next % this->slots.size()];
+        ++slot.readers;
+        auto deferred = sharp::defer([&slot]() { --slot.readers; });
+        if (slot.sequence.load() == next) {
+            auto element = sharp::Try<Type>{*slot.value};
+            cursor.next.store(next + 1);
+            return element;
+        }
+    }
+}
+
+template <typename Type, typename Mutex, typename Cv>
+sharp::Try<Type> BroadcastChannel<Type, Mutex, Cv>::read(CursorIterator cursor,
+                                                         bool blocking) {
+    while (true) {
+        if (cursor->disconnected.load()) {
+            return std::make_exception_ptr(SubscriberDisconnectedError{
+                    "sharp::BroadcastChannel: subscriber disconnected"});
+        }
+
+        auto element = this->read_slot(*cursor);
+        if (element.valid()) {
+            // senders announce themselves before they look at the cursors
+            // for the last time, so one that missed the move is seen here
+            if (this->waiting_senders.load()) {
+                auto lck = std::unique_lock<Mutex>{this->mtx};
+                this->senders.notify_all();
+            }
+            return element;
+        }
+
+        // the tail only moves with the mutex held, so nothing can be sent
+        // between looking at it here and going to sleep
+        auto lck = std::unique_lock<Mutex>{this->mtx};
+        if (cursor->next.load() < this->tail.load()
+                || cursor->disconnected.load()) {
+            continue;
+        }
+        if (this->closed || !blocking) {
+            return nullptr;
+        }
+        ++this->waiting_readers;
+        this->readers.wait(lck);
+        --this->waiting_readers;
+    }
+}
+
+template <typename Type, typename Mutex, typename Cv>
+void BroadcastChannel<Type, Mutex, Cv>::close() {
+    auto lck = std::unique_lock<Mutex>{this->mtx};
+    this->closed = true;
+    this->readers.notify_all();
+    this->senders.notify_all();
+}
+
+template <typename Type, typename Mutex, typename Cv>
+bool BroadcastChannel<Type, Mutex, Cv>::is_closed() {
+    auto lck = std::unique_lock<Mutex>{this->mtx};
+    return this->closed;
+}
+
+} // namespace sharp
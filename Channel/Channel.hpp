@@ -9,20 +9,25 @@
 
 #pragma once
 
+#include <sharp/Channel/detail/Awaitable.hpp>
+#include <sharp/Channel/detail/Channel-pre.hpp>
+#include <sharp/Channel/detail/LockedChannel.hpp>
+#include <sharp/Channel/detail/MpmcChannel.hpp>
+#include <sharp/Channel/detail/SpscChannel.hpp>
 #include <sharp/Tags/Tags.hpp>
 #include <sharp/Try/Try.hpp>
-#include <sharp/Concurrent/Concurrent.hpp>
 #include <sharp/Portability/cpp17.hpp>
+#include <sharp/Portability/cpp20.hpp>
 
+#include <chrono>
+#include <cstddef>
 #include <mutex>
 #include <condition_variable>
 #include <utility>
-#include <deque>
 #include <memory>
 #include <exception>
 #include <initializer_list>
 #include <vector>
-#include <queue>
 
 namespace sharp {
 
@@ -74,6 +79,21 @@ namespace sharp {
  * Further the behavior of the channel can be customized to fit thread
  * implementations by changing the mutex and condition variable type
  *
+ * The internal queue can also be changed by passing one of the policies in
+ * sharp::channel_policy as the last template parameter.  By default all state
+ * is kept under a mutex, but contended channels with a buffer can opt into a
+ * lock free ring buffer where sends and reads only ever block when the buffer
+ * is full or empty respectively
+ *
+ *      auto channel = sharp::Channel<int, std::mutex, std::condition_variable,
+ *                                    sharp::channel_policy::Mpmc>{4096};
+ *
+ * And channels that connect one stage of a pipeline to the next can use
+ * sharp::channel_policy::Spsc, which is cheaper still but only supports one
+ * sending and one reading thread.  Bursty producers can use
+ * sharp::channel_policy::Unbounded, where the buffer grows as needed and
+ * sends only block above a high watermark in bytes
+ *
  * Channels also capture the value or error semantics of Go channels by
  * providing methods to send exceptions across channels, for example
  *
@@ -107,10 +127,10 @@ namespace sharp {
  * but for a quick example
  *
  *      sharp::select(
- *          sharp::case(channel_one, []() -> int {
+ *          std::make_pair(std::ref(channel_one), []() -> int {
  *              return 1;
  *          }),
- *          sharp::case(channel_two, [](auto value) {
+ *          std::make_pair(std::ref(channel_two), [](auto value) {
  *              cout << "Read value " << value << endl;
  *          })
  *      );
@@ -120,7 +140,8 @@ namespace sharp {
  */
 template <typename Type,
           typename Mutex = std::mutex,
-          typename Cv = std::condition_variable>
+          typename Cv = std::condition_variable,
+          typename Policy = channel_policy::Locked>
 class Channel {
 public:
 
@@ -188,6 +209,14 @@ public:
     template <typename U, typename... Args>
     void send(std::in_place_t, std::initializer_list<U> il, Args&&... args);
 
+    /**
+     * Sends an exception through the channel, the read on the other end that
+     * gets it rethrows it (or returns it in the Try for read_try()).  This
+     * takes up a slot in the channel like any other value, and blocks the
+     * same way send() does
+     */
+    void send_exception(std::exception_ptr exception);
+
     /**
      * Speculative versions of send, these return a true if the read was
      * successful, false otherwise.  And either move or copy the value out of
@@ -239,6 +268,88 @@ public:
      */
     sharp::Try<Type> try_read_try();
 
+    /**
+     * Timed sends and reads, these block like send() and read() but give up
+     * once the timeout expires or the deadline passes.  This allows a thread
+     * to back off when the other end falls behind rather than stall
+     *
+     *      if (!channel.send_for(std::move(record), 10ms)) {
+     *          // the readers are backed up, shed load
+     *      }
+     *
+     * The sends return false if the value could not be sent in time, and
+     * like try_send() the value is not moved from in that case.  The reads
+     * return an empty optional if there was no value in time
+     *
+     * Like send() and read() these throw a ChannelClosedError if the channel
+     * is closed (and empty for reads) and reads rethrow exceptions that were
+     * sent through the channel
+     */
+    template <typename Rep, typename Period>
+    bool send_for(const Type& value,
+                  const std::chrono::duration<Rep, Period>& timeout);
+    template <typename Rep, typename Period>
+    bool send_for(Type&& value,
+                  const std::chrono::duration<Rep, Period>& timeout);
+    template <typename Clock, typename Duration>
+    bool send_until(const Type& value,
+                    const std::chrono::time_point<Clock, Duration>& deadline);
+    template <typename Clock, typename Duration>
+    bool send_until(Type&& value,
+                    const std::chrono::time_point<Clock, Duration>& deadline);
+    template <typename Rep, typename Period>
+    std::optional<Type> read_for(
+            const std::chrono::duration<Rep, Period>& timeout);
+    template <typename Clock, typename Duration>
+    std::optional<Type> read_until(
+            const std::chrono::time_point<Clock, Duration>& deadline);
+
+    /**
+     * Batched sends and reads, these move a whole batch of values through
+     * the channel while holding the internal lock once and waking up the
+     * other side once, rather than once per value
+     *
+     * send_many() sends every value in the range [first, last) in order,
+     * blocking till all of them have been sent.  Values are copied out of the
+     * range, use std::make_move_iterator() to move them instead
+     *
+     *      auto records = std::vector<Record>{...};
+     *      channel.send_many(std::make_move_iterator(records.begin()),
+     *                        std::make_move_iterator(records.end()));
+     *
+     * read_many() blocks till there is at least one value in the channel and
+     * then reads as many as are there, up to max, into the output iterator.
+     * It returns the number of values read, which is 0 only when the channel
+     * has been closed and has no values left
+     *
+     *      auto batch = std::vector<Record>{};
+     *      while (channel.read_many(std::back_inserter(batch), 1024)) {
+     *          process(batch);
+     *          batch.clear();
+     *      }
+     *
+     * read_up_to() keeps reading till it has read n values, the timeout
+     * expires or the channel is closed and empty, and returns the values it
+     * read.  This is useful for flushing batches on a timer
+     *
+     * On an unbuffered channel a batched read counts as max (or n) readers
+     * waiting on the channel, so a send_many() on the other end can hand it
+     * the whole batch at once
+     *
+     * If a value read was an exception sent through the channel, the
+     * exception is rethrown and the batch ends there.  Values read before it
+     * have already been written to the output iterator in read_many().
+     * read_up_to() instead returns the values it read before an exception
+     * and leaves the exception in the channel, the next read throws it
+     */
+    template <typename InputIt>
+    void send_many(InputIt first, InputIt last);
+    template <typename OutputIt>
+    std::size_t read_many(OutputIt out, std::size_t max);
+    template <typename Rep, typename Period>
+    std::vector<Type> read_up_to(
+            std::size_t n, const std::chrono::duration<Rep, Period>& timeout);
+
     /**
      * Iterator class for the channel
      *
@@ -259,6 +370,10 @@ public:
      * Close the channel and mark the channel as a completed range, after this
      * point any read will throw an exception and any iteration will stop
      * after reading in all the elements that are currently in the channel
+     *
+     * The exception thrown is a sharp::ChannelClosedError, sends on a closed
+     * channel throw the same.  Any thread blocked on the channel is woken up
+     * when it is closed
      */
     void close();
 
@@ -269,6 +384,52 @@ public:
      */
     bool is_closed();
 
+    /**
+     * Returns the number of values currently in the channel, the most there
+     * have ever been at once and the number of bytes the channel holds on
+     * to for them, see sharp::ChannelStats.  This is meant for sizing buffers
+     * from production data
+     *
+     * Only available with the Locked and Unbounded policies, the lock free
+     * policies do not keep track of their peak depth since that would cost
+     * an extra atomic operation on every send
+     */
+    ChannelStats stats();
+
+#if SHARP_HAS_COROUTINES
+    /**
+     * Awaitable versions of read() and send() for use in C++20 coroutines,
+     * for example
+     *
+     *      auto value = co_await channel.async_read(executor);
+     *      co_await channel.async_send(std::move(value), executor);
+     *
+     * If the operation can go through right away it does so without
+     * suspending the coroutine.  Otherwise the coroutine is parked on the
+     * channel without blocking the thread it was running on, and is resumed
+     * on the executor once the read or send has gone through.  This way many
+     * coroutines can wait on channels while sharing a few threads
+     *
+     * Parked coroutines are handed to the executor after the channel has
+     * released its internal lock, so any executor works, including one that
+     * runs closures inline in add() like sharp::InlineExecutor
+     *
+     * Errors are the same as with read() and send(), co_await throws a
+     * ChannelClosedError if the channel is closed and a read rethrows any
+     * exception sent through the channel.  The object returned must be
+     * awaited right away, it cannot be moved
+     */
+    channel_detail::ReadAwaiter<
+        channel_detail::ChannelImpl_t<Policy, Type, Mutex, Cv>, Type>
+    async_read(sharp::Executor& executor);
+    channel_detail::SendAwaiter<
+        channel_detail::ChannelImpl_t<Policy, Type, Mutex, Cv>, Type>
+    async_send(const Type& value, sharp::Executor& executor);
+    channel_detail::SendAwaiter<
+        channel_detail::ChannelImpl_t<Policy, Type, Mutex, Cv>, Type>
+    async_send(Type&& value, sharp::Executor& executor);
+#endif
+
     /**
      * Make friends with the select function, each select operation waits on a
      * monitor for the channel to either have a ready value or to be ready for
@@ -279,35 +440,15 @@ public:
 
 private:
 
-    template <typename EnqueueFunc>
-    void send_impl(EnqueueFunc enqueue);
-    template <typename EnqueueFunc>
-    bool try_send_impl(EnqueueFunc enqueue);
-
     /**
-     * The number of objects the internal queue can hold without blocking,
-     * once this is set at construction time it never changes
+     * The implementation of the channel, this is picked based on the policy
+     * the channel was instantiated with.  All of them have the same
+     * interface, see sharp/Channel/detail/LockedChannel.hpp
+     *
+     * Reads from the implementation return an empty Try when the channel has
+     * been closed and all the values in it have been read
      */
-    const int buffer_length{0};
-
-    struct State {
-        /**
-         * The number of open slots in the current buffer, this corresponds to
-         * the number of readers waiting + the buffer length
-         */
-        State(int buffer_length) : open_slots{buffer_length} {}
-        int open_slots;
-
-        /**
-         * The queue of objects or exceptions, represented conveniently using
-         * sharp::Try, see sharp/Try/README.md for documentation and usage
-         * examples of Try
-         *
-         * Represented by a concurrent object so protected by a mutex
-         */
-        std::queue<sharp::Try<Type>> elements;
-    };
-    sharp::Concurrent<State> state;
+    channel_detail::ChannelImpl_t<Policy, Type, Mutex, Cv> impl;
 };
 
 /**
@@ -315,6 +456,26 @@ private:
  * Based on the type of the function passed in to the function call the
  * select method implicitly decides whether the channel is being used to
  * wait on a read or a write operation, and multiplexes I/O based on that
+ *
+ * Each statement is a pair of a channel and a function.  If the function can
+ * be called with no arguments then the case is a send and the value returned
+ * by the function is sent on the channel, otherwise the case is a read and
+ * the value read is passed to the function.  Reads and sends can be mixed
+ * freely, and the channels can have different types and policies
+ *
+ * Exactly one case is run.  Like Go, if more than one case is ready then one
+ * is picked at random, and if none are ready then the call blocks till one
+ * is.  The function for a send is only called once there is room for the
+ * value in the channel, so it is never called for a case that was not picked
+ * and it is never called with any of the channel's locks held
+ *
+ * A blocked select registers a single waiter with all the channels it is
+ * waiting on and sleeps till one of them changes, it does not poll
+ *
+ * A read case on a channel that has been closed and drained, and a send case
+ * on a closed channel both cause the select to throw a ChannelClosedError.
+ * If a read picks up an exception that was sent through the channel then
+ * that is rethrown, as is anything thrown by the functions
  */
 template <typename... SelectStatements>
 void select(SelectStatements&&... statements);
@@ -4,84 +4,312 @@
 #include <sharp/Traits/Traits.hpp>
 #include <sharp/ForEach/ForEach.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <iterator>
 #include <mutex>
+#include <numeric>
 #include <exception>
+#include <random>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace sharp {
 
-template <typename Type, typename Mutex, typename Cv>
-Channel<Type, Mutex, Cv>::Channel(int b) : buffer_length{b}, state{State{b}} {}
+namespace channel_detail {
 
-template <typename Type, typename Mutex, typename Cv>
-void Channel<Type, Mutex, Cv>::send(const Type& value) {
-    this->send_impl([&](auto& elements) { elements.emplace(value); });
+    /**
+     * Converts the empty Try returned by a read on a closed channel to a Try
+     * holding a ChannelClosedError
+     */
+    template <typename Type>
+    sharp::Try<Type> closed_if_empty(sharp::Try<Type> element) {
+        if (!element.valid()) {
+            return std::make_exception_ptr(ChannelClosedError{
+                    "sharp::Channel: read on closed channel"});
+        }
+        return element;
+    }
+
+    /**
+     * The channel in a select statement can either be passed as a reference
+     * or wrapped in a std::reference_wrapper
+     */
+    template <typename Type>
+    Type& unwrap(Type& channel) {
+        return channel;
+    }
+    template <typename Type>
+    Type& unwrap(std::reference_wrapper<Type> channel) {
+        return channel.get();
+    }
+
+    /**
+     * A select case sends to its channel if its function can be called with
+     * no arguments, otherwise it reads from the channel and the value read
+     * is passed to the function
+     */
+    template <typename Func, typename = sharp::void_t<>>
+    struct IsSendCase : std::false_type {};
+    template <typename Func>
+    struct IsSendCase<Func, sharp::void_t<decltype(std::declval<Func&>()())>>
+        : std::true_type {};
+
+    /**
+     * @class SelectCase
+     *
+     * One case in a select statement, this holds the channel implementation
+     * and the function for the case along with the node that is linked into
+     * the channel's list of waiters while the select is blocked
+     */
+    template <typename Impl, typename Func>
+    class SelectCase {
+    public:
+        SelectCase(Impl& impl_in, Func& func_in)
+            : impl{impl_in}, func{func_in} {}
+
+        /**
+         * Run the case if the channel is ready for it, returns true if it
+         * was run
+         */
+        bool try_execute() {
+            return this->try_execute(IsSendCase<Func>{});
+        }
+
+        /**
+         * Register and unregister the waiter with the channel
+         */
+        void subscribe(Waiter& waiter) {
+            this->node.datum = &waiter;
+            this->impl.add_waiter(&this->node, this->operation());
+        }
+        void unsubscribe() {
+            this->impl.remove_waiter(&this->node, this->operation());
+        }
+
+    private:
+        static constexpr SelectOperation operation() {
+            return IsSendCase<Func>::value ? SelectOperation::SEND
+                                           : SelectOperation::READ;
+        }
+
+        /**
+         * The function for a send is only called once there is room for its
+         * value in the channel, so its side effects only happen when the
+         * case is selected
+         */
+        bool try_execute(std::true_type) {
+            using Type = typename std::decay_t<decltype(
+                    std::declval<Impl&>().try_read())>::value_type;
+            return this->impl.try_send_unlocked([this](auto& elements) {
+                elements.emplace(static_cast<Type>(this->func()));
+            });
+        }
+
+        /**
+         * Check whether the channel was closed before trying to read, if the
+         * read then comes up empty there is no value coming in the future
+         */
+        bool try_execute(std::false_type) {
+            auto closed = this->impl.is_closed();
+            auto element = this->impl.try_read();
+            if (element.valid()) {
+                this->func(std::move(element).get());
+                return true;
+            }
+            if (closed) {
+                throw ChannelClosedError{"sharp::Channel: read on closed "
+                                         "channel"};
+            }
+            return false;
+        }
+
+        Impl& impl;
+        Func& func;
+        WaiterNode node{sharp::emplace_construct::tag, nullptr};
+    };
+
+    template <typename Impl, typename Func>
+    SelectCase<Impl, Func> make_select_case(Impl& impl, Func& func) {
+        return SelectCase<Impl, Func>{impl, func};
+    }
+
+    /**
+     * Returns a random permutation of the case indices, like Go a select
+     * goes through its cases in a random order so that one channel that is
+     * always ready cannot starve the others
+     */
+    template <std::size_t NumberCases>
+    std::array<std::size_t, NumberCases> random_order() {
+        thread_local auto engine = std::minstd_rand{std::random_device{}()};
+        auto order = std::array<std::size_t, NumberCases>{};
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), engine);
+        return order;
+    }
+
+    /**
+     * Try the cases in the given order and run the first one that is ready,
+     * the table of functions lets the cases be indexed at runtime
+     */
+    template <std::size_t Index, typename Cases>
+    bool try_case(Cases& cases) {
+        return std::get<Index>(cases).try_execute();
+    }
+    template <typename Cases, std::size_t... Indices>
+    bool try_cases(Cases& cases,
+                   const std::array<std::size_t, sizeof...(Indices)>& order,
+                   std::index_sequence<Indices...>) {
+        using TryCase = bool (*)(Cases&);
+        const TryCase try_case_at[] = {&try_case<Indices, Cases>...};
+        for (auto index : order) {
+            if (try_case_at[index](cases)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace channel_detail
+
+/**
+ * The iterator reads a value from the channel on construction and on every
+ * increment, until the channel is closed and has no more values, at which
+ * point it compares equal to the end iterator
+ */
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+class Channel<Type, Mutex, Cv, Policy>::Iterator {
+public:
+
+    /**
+     * This is an input iterator, once a value has been read it cannot be
+     * read again from another iterator
+     */
+    using difference_type = std::ptrdiff_t;
+    using value_type = Type;
+    using pointer = Type*;
+    using reference = Type&;
+    using iterator_category = std::input_iterator_tag;
+
+    /**
+     * Returns the value that was read, if an exception was sent through the
+     * channel then that is rethrown here
+     */
+    Type& operator*() {
+        return this->current->get();
+    }
+
+    /**
+     * Reads the next value from the channel, blocks until there is one
+     */
+    Iterator& operator++() {
+        this->advance();
+        return *this;
+    }
+
+    /**
+     * Iterators are only equal when they are both at the end
+     */
+    bool operator==(const Iterator& other) const noexcept {
+        return this->channel == other.channel;
+    }
+    bool operator!=(const Iterator& other) const noexcept {
+        return !(*this == other);
+    }
+
+    friend class Channel;
+
+private:
+    explicit Iterator(Channel* channel_in) : channel{channel_in} {
+        if (this->channel) {
+            this->advance();
+        }
+    }
+
+    void advance() {
+        auto element = this->channel->impl.read();
+        if (!element.valid()) {
+            this->channel = nullptr;
+            this->current = std::nullopt;
+        } else {
+            this->current.emplace(std::move(element));
+        }
+    }
+
+    Channel* channel;
+    std::optional<sharp::Try<Type>> current;
+};
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+Channel<Type, Mutex, Cv, Policy>::Channel(int b) : impl{b} {}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+void Channel<Type, Mutex, Cv, Policy>::send(const Type& value) {
+    this->impl.send([&](auto& elements) { elements.emplace(value); });
 }
 
-template <typename Type, typename Mutex, typename Cv>
-void Channel<Type, Mutex, Cv>::send(Type&& v) {
-    this->send_impl([&](auto& elements) { elements.emplace(std::move(v)); });
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+void Channel<Type, Mutex, Cv, Policy>::send(Type&& v) {
+    this->impl.send([&](auto& elements) { elements.emplace(std::move(v)); });
 }
 
-template <typename Type, typename Mutex, typename Cv>
+template <typename Type, typename Mutex, typename Cv, typename Policy>
 template <typename... Args>
-void Channel<Type, Mutex, Cv>::send(std::in_place_t, Args&&... args) {
-    this->send_impl([&](auto& elements) {
-        elements.emplace(std::in_place, std::forward<Args>(args)...);
+void Channel<Type, Mutex, Cv, Policy>::send(std::in_place_t, Args&&... args) {
+    this->impl.send([&](auto& elements) {
+        elements.emplace(std::forward<Args>(args)...);
     });
 }
 
-template <typename Type, typename Mutex, typename Cv>
+template <typename Type, typename Mutex, typename Cv, typename Policy>
 template <typename U, typename... Args>
-void Channel<Type, Mutex, Cv>::send(std::in_place_t,
-                                    std::initializer_list<U> il,
-                                    Args&&... args) {
-    this->send_impl([&](auto& elements) {
-        elements.emplace(std::in_place, il, std::forward<Args>(args)...);
+void Channel<Type, Mutex, Cv, Policy>::send(std::in_place_t,
+                                            std::initializer_list<U> il,
+                                            Args&&... args) {
+    this->impl.send([&](auto& elements) {
+        elements.emplace(il, std::forward<Args>(args)...);
     });
 }
 
-template <typename Type, typename Mutex, typename Cv>
-bool Channel<Type, Mutex, Cv>::try_send(const Type& v) {
-    return this->try_send_impl([&](auto& elements) { elements.emplace(v); });
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+void Channel<Type, Mutex, Cv, Policy>::send_exception(
+        std::exception_ptr exception) {
+    this->impl.send([&](auto& elements) {
+        elements.set_exception(std::move(exception));
+    });
 }
 
-template <typename Type, typename Mutex, typename Cv>
-bool Channel<Type, Mutex, Cv>::try_send(Type&& v) {
-    return this->try_send_impl([&](auto& elements) {
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+bool Channel<Type, Mutex, Cv, Policy>::try_send(const Type& v) {
+    return this->impl.try_send([&](auto& elements) { elements.emplace(v); });
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+bool Channel<Type, Mutex, Cv, Policy>::try_send(Type&& v) {
+    return this->impl.try_send([&](auto& elements) {
         elements.emplace(std::move(v));
     });
 }
 
-template <typename Type, typename Mutex, typename Cv>
-Type Channel<Type, Mutex, Cv>::read() {
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+Type Channel<Type, Mutex, Cv, Policy>::read() {
     return this->read_try().get();
 }
 
-template <typename Type, typename Mutex, typename Cv>
-sharp::Try<Type> Channel<Type, Mutex, Cv>::read_try() {
-    // wait for the elements to have an element and then read it
-    auto state = this->state.lock();
-
-    // increment the number of open slots before going to bed because there is
-    // now a read which is possibly waiting for a write to go through on the
-    // other end
-    ++(state->open_slots);
-
-    // sleep af if the elements queue is empty
-    state.wait([](auto& state) {
-        return !state.elements.empty();
-    });
-
-    // return the first element and pop af
-    auto deferred = sharp::defer([&]() { state->elements.pop(); });
-    return std::move(state->elements.front());
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+sharp::Try<Type> Channel<Type, Mutex, Cv, Policy>::read_try() {
+    return channel_detail::closed_if_empty(this->impl.read());
 }
 
-template <typename Type, typename Mutex, typename Cv>
-std::optional<Type> Channel<Type, Mutex, Cv>::try_read() {
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+std::optional<Type> Channel<Type, Mutex, Cv, Policy>::try_read() {
     auto t = this->try_read_try();
     if (t.valid()) {
         return std::move(t).value();
@@ -90,48 +318,183 @@ std::optional<Type> Channel<Type, Mutex, Cv>::try_read() {
     }
 }
 
-template <typename Type, typename Mutex, typename Cv>
-sharp::Try<Type> Channel<Type, Mutex, Cv>::try_read_try() {
-    return this->state.synchronized([](auto& state) -> sharp::Try<Type> {
-        if (!state.elements.empty()) {
-            // return the first element and pop af
-            auto deferred = sharp::defer([&]() { state.elements.pop(); });
-            return std::move(state.elements.front());
-        } else {
-            return nullptr;
-        }
-    });
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+sharp::Try<Type> Channel<Type, Mutex, Cv, Policy>::try_read_try() {
+    return this->impl.try_read();
 }
 
-template <typename Type, typename Mutex, typename Cv>
-template <typename Func>
-bool Channel<Type, Mutex, Cv>::try_send_impl(Func enqueue) {
-    return this->state.synchronized([enqueue](auto& state) {
-        if (state.open_slots) {
-            // if there is space then enqueue the element and decrement the
-            // number of open slots for sends
-            enqueue(state.elements);
-            --(state.open_slots);
-            return true;
-        }
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename Rep, typename Period>
+bool Channel<Type, Mutex, Cv, Policy>::send_for(
+        const Type& value, const std::chrono::duration<Rep, Period>& timeout) {
+    return this->send_until(value, std::chrono::steady_clock::now() + timeout);
+}
 
-        return false;
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename Rep, typename Period>
+bool Channel<Type, Mutex, Cv, Policy>::send_for(
+        Type&& value, const std::chrono::duration<Rep, Period>& timeout) {
+    return this->send_until(std::move(value),
+                            std::chrono::steady_clock::now() + timeout);
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename Clock, typename Duration>
+bool Channel<Type, Mutex, Cv, Policy>::send_until(
+        const Type& value,
+        const std::chrono::time_point<Clock, Duration>& deadline) {
+    return this->impl.send_until([&](auto& elements) {
+        elements.emplace(value);
+    }, deadline);
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename Clock, typename Duration>
+bool Channel<Type, Mutex, Cv, Policy>::send_until(
+        Type&& value,
+        const std::chrono::time_point<Clock, Duration>& deadline) {
+    return this->impl.send_until([&](auto& elements) {
+        elements.emplace(std::move(value));
+    }, deadline);
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename Rep, typename Period>
+std::optional<Type> Channel<Type, Mutex, Cv, Policy>::read_for(
+        const std::chrono::duration<Rep, Period>& timeout) {
+    return this->read_until(std::chrono::steady_clock::now() + timeout);
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename Clock, typename Duration>
+std::optional<Type> Channel<Type, Mutex, Cv, Policy>::read_until(
+        const std::chrono::time_point<Clock, Duration>& deadline) {
+    auto element = this->impl.read_until(deadline);
+    if (!element) {
+        return std::nullopt;
+    }
+    return channel_detail::closed_if_empty(std::move(*element)).value();
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename InputIt>
+void Channel<Type, Mutex, Cv, Policy>::send_many(InputIt first,
+                                                 InputIt last) {
+    this->impl.send_many(first, last);
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename OutputIt>
+std::size_t Channel<Type, Mutex, Cv, Policy>::read_many(OutputIt out,
+                                                        std::size_t max) {
+    return this->impl.read_many(max, [&out](auto element) {
+        *out = std::move(element).get();
+        ++out;
     });
 }
 
-template <typename Type, typename Mutex, typename Cv>
-template <typename Func>
-void Channel<Type, Mutex, Cv>::send_impl(Func enqueue) {
-    auto state = this->state.lock();
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+template <typename Rep, typename Period>
+std::vector<Type> Channel<Type, Mutex, Cv, Policy>::read_up_to(
+        std::size_t n, const std::chrono::duration<Rep, Period>& timeout) {
+    auto values = std::vector<Type>{};
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    this->impl.read_up_to(n, deadline, [&values](auto element) {
+        values.push_back(std::move(element).get());
+    });
+    return values;
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+typename Channel<Type, Mutex, Cv, Policy>::Iterator
+Channel<Type, Mutex, Cv, Policy>::begin() {
+    return Iterator{this};
+}
 
-    // wait for open slots to be non 0
-    state.wait([](auto& state) {
-        return state.open_slots != 0;
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+typename Channel<Type, Mutex, Cv, Policy>::Iterator
+Channel<Type, Mutex, Cv, Policy>::end() {
+    return Iterator{nullptr};
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+void Channel<Type, Mutex, Cv, Policy>::close() {
+    this->impl.close();
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+bool Channel<Type, Mutex, Cv, Policy>::is_closed() {
+    return this->impl.is_closed();
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+ChannelStats Channel<Type, Mutex, Cv, Policy>::stats() {
+    return this->impl.stats();
+}
+
+#if SHARP_HAS_COROUTINES
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+channel_detail::ReadAwaiter<
+    channel_detail::ChannelImpl_t<Policy, Type, Mutex, Cv>, Type>
+Channel<Type, Mutex, Cv, Policy>::async_read(sharp::Executor& executor) {
+    return {this->impl, executor};
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+channel_detail::SendAwaiter<
+    channel_detail::ChannelImpl_t<Policy, Type, Mutex, Cv>, Type>
+Channel<Type, Mutex, Cv, Policy>::async_send(const Type& value,
+                                             sharp::Executor& executor) {
+    return {this->impl, executor, value};
+}
+
+template <typename Type, typename Mutex, typename Cv, typename Policy>
+channel_detail::SendAwaiter<
+    channel_detail::ChannelImpl_t<Policy, Type, Mutex, Cv>, Type>
+Channel<Type, Mutex, Cv, Policy>::async_send(Type&& value,
+                                             sharp::Executor& executor) {
+    return {this->impl, executor, std::move(value)};
+}
+#endif
+
+template <typename... SelectStatements>
+void select(SelectStatements&&... statements) {
+    static_assert(sizeof...(SelectStatements) > 0,
+                  "sharp::select() needs at least one case");
+
+    auto cases = std::make_tuple(channel_detail::make_select_case(
+            channel_detail::unwrap(statements.first).impl,
+            statements.second)...);
+    auto order = channel_detail::random_order<sizeof...(SelectStatements)>();
+    auto indices = std::index_sequence_for<SelectStatements...>{};
+
+    // the fast path, if a case is ready then the channels never hear about
+    // this select
+    if (channel_detail::try_cases(cases, order, indices)) {
+        return;
+    }
+
+    // otherwise register one waiter with all the channels and sleep on it
+    // until one of them changes, the event is cleared before the cases are
+    // checked so a change that comes in while they are being checked wakes
+    // this up right away
+    channel_detail::BlockingWaiter waiter;
+    sharp::for_each(cases, [&waiter](auto& select_case) {
+        select_case.subscribe(waiter);
+    });
+    auto deferred = sharp::defer([&cases]() {
+        sharp::for_each(cases, [](auto& select_case) {
+            select_case.unsubscribe();
+        });
     });
 
-    // then decrement the open slots and write to the queue af
-    enqueue(state->elements);
-    --(state->open_slots);
+    while (true) {
+        waiter.reset();
+        if (channel_detail::try_cases(cases, order, indices)) {
+            return;
+        }
+        waiter.wait();
+    }
 }
 
 } // namespace sharp
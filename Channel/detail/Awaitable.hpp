@@ -0,0 +1,260 @@
+/**
+ * @file Awaitable.hpp
+ * @author Aaryaman Sagar
+ *
+ * The awaitable objects returned by Channel::async_read() and
+ * Channel::async_send(), these let a coroutine wait on a channel without
+ * blocking the thread it is running on.  Only available when compiling with
+ * coroutine support, see sharp/Portability/cpp20.hpp
+ */
+
+#pragma once
+
+#include <sharp/Portability/cpp20.hpp>
+
+#if SHARP_HAS_COROUTINES
+
+#include <sharp/Channel/detail/Channel-pre.hpp>
+#include <sharp/Channel/detail/Waiter.hpp>
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Portability/cpp17.hpp>
+#include <sharp/Tags/Tags.hpp>
+#include <sharp/Try/Try.hpp>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class AsyncOperation
+     *
+     * The part of an awaitable that is common to reads and sends.  The
+     * derived class provides try_complete(), which tries the operation on
+     * the channel without blocking and returns true if it went through (or
+     * failed for good, for example because the channel was closed)
+     *
+     * When the operation cannot go through right away the coroutine is
+     * suspended and this registers itself as a waiter with the channel, the
+     * same way a select does.  Each notification from the channel schedules
+     * one attempt at the operation on the executor, and the attempt that
+     * succeeds unregisters the waiter and resumes the coroutine on the
+     * executor's thread
+     *
+     * Notifications come in with the channel's internal lock held, so the
+     * attempt is handed to the executor only after the channel has released
+     * the lock, see UnlockedNotifications.  That way an executor that runs
+     * closures inline in add() can go ahead and run the attempt right away
+     *
+     * At most one attempt is scheduled at a time, notifications that come in
+     * while an attempt is running make it go around once more instead.  And
+     * the channel only notifies as many waiters for the same operation as
+     * there are values or slots for them.  So a busy channel does not flood
+     * the executor with closures, no matter how many coroutines are parked
+     * on it
+     */
+    template <typename Derived, typename Impl>
+    class AsyncOperation : public Waiter {
+    public:
+        AsyncOperation(Impl& impl_in, sharp::Executor& executor_in,
+                       SelectOperation operation_in)
+            : impl{impl_in}, executor{executor_in}, operation{operation_in} {}
+
+        /**
+         * The waiter is linked into the channel by address, so these cannot
+         * be moved once they have been created
+         */
+        AsyncOperation(const AsyncOperation&) = delete;
+        AsyncOperation(AsyncOperation&&) = delete;
+        AsyncOperation& operator=(const AsyncOperation&) = delete;
+        AsyncOperation& operator=(AsyncOperation&&) = delete;
+
+        /**
+         * The awaitable interface, the coroutine is only suspended if the
+         * operation cannot go through right away
+         */
+        bool await_ready() {
+            return this->instance().try_complete();
+        }
+        bool await_suspend(std::coroutine_handle<> handle_in) {
+            this->handle = handle_in;
+
+            // the channel might have changed between await_ready() and
+            // registering, so this tries again as if it were an attempt that
+            // was scheduled by a notification
+            this->state.store(SCHEDULED);
+            this->impl.add_waiter(&this->node, this->operation);
+            return !this->attempt();
+        }
+
+        /**
+         * Schedule an attempt at the operation, or if one is already running
+         * make it try again
+         */
+        void notify() override {
+            auto current = this->state.load();
+            while (true) {
+                if (current == IDLE) {
+                    if (this->state.compare_exchange_weak(current, SCHEDULED)) {
+                        UnlockedNotifications::defer(this);
+                        return;
+                    }
+                } else if (current == SCHEDULED) {
+                    if (this->state.compare_exchange_weak(current, NOTIFIED)) {
+                        return;
+                    }
+                } else {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * Called once the channel has released its lock.  Nothing else can
+         * resume the coroutine while the attempt is scheduled, so this is
+         * still alive here
+         */
+        void notify_unlocked() override {
+            this->executor.add([this]() {
+                if (this->attempt()) {
+                    this->handle.resume();
+                }
+            });
+        }
+
+    protected:
+        Impl& impl;
+
+    private:
+        /**
+         * IDLE means no attempt is running, SCHEDULED means one is and
+         * NOTIFIED means one is and the channel has changed since it started
+         */
+        enum : int {
+            IDLE,
+            SCHEDULED,
+            NOTIFIED,
+        };
+
+        Derived& instance() {
+            return static_cast<Derived&>(*this);
+        }
+
+        /**
+         * Try the operation till it either goes through or fails with no
+         * notifications having come in while it was being tried.  Returns
+         * true if it went through, in which case the waiter has been
+         * unregistered.  Once this returns false the coroutine can be
+         * resumed by another attempt at any time, so this must not be touched
+         * after that
+         */
+        bool attempt() {
+            while (true) {
+                this->state.store(SCHEDULED);
+                if (this->instance().try_complete()) {
+                    this->impl.remove_waiter(&this->node, this->operation);
+                    return true;
+                }
+
+                auto expected = static_cast<int>(SCHEDULED);
+                if (this->state.compare_exchange_strong(expected, IDLE)) {
+                    return false;
+                }
+            }
+        }
+
+        sharp::Executor& executor;
+        const SelectOperation operation;
+        std::coroutine_handle<> handle;
+        std::atomic<int> state{IDLE};
+        WaiterNode node{sharp::emplace_construct::tag, this};
+    };
+
+    /**
+     * @class ReadAwaiter
+     *
+     * co_await on this returns the value read, or throws the exception that
+     * was sent through the channel, or throws a ChannelClosedError if the
+     * channel was closed and there is nothing left to read
+     */
+    template <typename Impl, typename Type>
+    class ReadAwaiter : public AsyncOperation<ReadAwaiter<Impl, Type>, Impl> {
+    public:
+        ReadAwaiter(Impl& impl_in, sharp::Executor& executor_in)
+            : AsyncOperation<ReadAwaiter, Impl>{impl_in, executor_in,
+                                                SelectOperation::READ} {}
+
+        Type await_resume() {
+            return std::move(*this->element).get();
+        }
+
+        /**
+         * Check whether the channel was closed before trying to read, if the
+         * read then comes up empty there is no value coming in the future
+         */
+        bool try_complete() {
+            auto closed = this->impl.is_closed();
+            auto element = this->impl.try_read();
+            if (element.valid()) {
+                this->element.emplace(std::move(element));
+                return true;
+            }
+            if (closed) {
+                this->element.emplace(std::make_exception_ptr(
+                    ChannelClosedError{"sharp::Channel: read on closed "
+                                       "channel"}));
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        std::optional<sharp::Try<Type>> element;
+    };
+
+    /**
+     * @class SendAwaiter
+     *
+     * Holds the value till there is room for it in the channel, co_await on
+     * this throws a ChannelClosedError if the channel was closed before the
+     * value could be sent
+     */
+    template <typename Impl, typename Type>
+    class SendAwaiter : public AsyncOperation<SendAwaiter<Impl, Type>, Impl> {
+    public:
+        template <typename Value>
+        SendAwaiter(Impl& impl_in, sharp::Executor& executor_in,
+                    Value&& value_in)
+            : AsyncOperation<SendAwaiter, Impl>{impl_in, executor_in,
+                                                SelectOperation::SEND},
+              value{std::forward<Value>(value_in)} {}
+
+        void await_resume() {
+            if (this->exception) {
+                std::rethrow_exception(this->exception);
+            }
+        }
+
+        bool try_complete() {
+            try {
+                return this->impl.try_send([this](auto& elements) {
+                    elements.emplace(std::move(this->value));
+                });
+            } catch (...) {
+                this->exception = std::current_exception();
+                return true;
+            }
+        }
+
+    private:
+        Type value;
+        std::exception_ptr exception;
+    };
+
+} // namespace channel_detail
+} // namespace sharp
+
+#endif // SHARP_HAS_COROUTINES
@@ -0,0 +1,156 @@
+/**
+ * @file Buffer.hpp
+ * @author Aaryaman Sagar
+ *
+ * The queue of values that LockedChannel keeps under its lock, a ring buffer
+ * laid out in one contiguous allocation
+ */
+
+#pragma once
+
+#include <sharp/Try/Try.hpp>
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class Buffer
+     *
+     * A FIFO queue of values and exceptions.  All the slots are allocated
+     * once on construction, so a channel that keeps sending and reading does
+     * not call the allocator, unlike a std::deque which allocates and frees
+     * a block every few hundred elements
+     *
+     * The slots only have room for values.  Exceptions are rare, so they are
+     * kept in a side table keyed by the position in the queue that they were
+     * sent at, and the slot at that position is left unused.  Sending and
+     * reading a value therefore never constructs, copies or destroys an
+     * exception_ptr
+     *
+     * The buffer can hold more values than the channel's buffer length when
+     * there are readers waiting, since sends go through for them as well.  In
+     * that case the buffer grows to fit, this only happens till it is large
+     * enough for the largest number of readers that have been waiting at
+     * once, after which it does not allocate again
+     *
+     * Not thread safe, LockedChannel only touches this with its lock held
+     */
+    template <typename Type>
+    class Buffer {
+    public:
+
+        /**
+         * Allocates room for the channel's buffer
+         */
+        explicit Buffer(int buffer_length);
+        ~Buffer();
+
+        /**
+         * The buffer is not movable or copyable, it lives in a channel which
+         * is not either
+         */
+        Buffer(const Buffer&) = delete;
+        Buffer(Buffer&&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        Buffer& operator=(Buffer&&) = delete;
+
+        /**
+         * The number of slots the channel starts out with, one for every
+         * value in the buffer
+         */
+        static int open_slots(int buffer_length);
+
+        /**
+         * Construct a value at the back of the queue with the arguments, or
+         * put an exception there.  If the constructor of the value throws
+         * then the queue is left as it was
+         */
+        template <typename... Args>
+        void emplace(Args&&... args);
+        void set_exception(std::exception_ptr exception);
+
+        /**
+         * Remove the value or the exception at the front of the queue and
+         * return it, the queue must not be empty
+         */
+        sharp::Try<Type> pop();
+
+        /**
+         * Returns true if the front of the queue is an exception, the queue
+         * must not be empty
+         */
+        bool front_is_exception() const noexcept;
+
+        /**
+         * The number of values and exceptions in the queue
+         */
+        bool empty() const noexcept;
+        std::size_t size() const noexcept;
+
+        /**
+         * The largest number of values and exceptions that have been in the
+         * queue at once, and the number of bytes allocated for them
+         */
+        std::size_t peak() const noexcept;
+        std::size_t bytes_retained() const noexcept;
+
+    private:
+        using Storage = std::aligned_storage_t<sizeof(Type), alignof(Type)>;
+
+        /**
+         * Make room for at least one more element, moving the elements over
+         * to a larger allocation
+         */
+        void grow();
+
+        /**
+         * Returns true if the element at the given position in the queue is
+         * an exception
+         */
+        bool is_exception(std::size_t position) const noexcept;
+
+        /**
+         * Calls func with the index (relative to the front of the queue) of
+         * each of the first n elements that is a value and not an exception
+         */
+        template <typename Func>
+        void for_each_value(std::size_t n, Func func);
+
+        /**
+         * The slots, the number of them and the index of the slot at the
+         * front of the queue
+         */
+        std::unique_ptr<Storage[]> slots;
+        std::size_t capacity;
+        std::size_t head{0};
+
+        /**
+         * The number of elements in the queue and the number of elements
+         * that have ever been put in the queue, the position of the element
+         * at the front is the difference of the two
+         */
+        std::size_t count{0};
+        std::size_t pushed{0};
+        std::size_t peak_count{0};
+
+        /**
+         * The exceptions in the queue along with their positions, in order.
+         * The ones before exceptions_front have been popped already, they
+         * are erased in bulk once they make up half the vector so popping
+         * an exception does not shift the rest down every time
+         */
+        std::vector<std::pair<std::size_t, std::exception_ptr>> exceptions;
+        std::size_t exceptions_front{0};
+    };
+
+} // namespace channel_detail
+} // namespace sharp
+
+#include <sharp/Channel/detail/Buffer.ipp>
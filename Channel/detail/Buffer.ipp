@@ -0,0 +1,175 @@
+#pragma once
+
+#include <sharp/Channel/detail/Buffer.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+
+namespace sharp {
+namespace channel_detail {
+
+    template <typename Type>
+    Buffer<Type>::Buffer(int buffer_length)
+            : slots{new Storage[buffer_length]},
+              capacity{static_cast<std::size_t>(buffer_length)} {}
+
+    template <typename Type>
+    int Buffer<Type>::open_slots(int buffer_length) {
+        return buffer_length;
+    }
+
+    template <typename Type>
+    Buffer<Type>::~Buffer() {
+        while (!this->empty()) {
+            this->pop();
+        }
+    }
+
+    template <typename Type>
+    bool Buffer<Type>::empty() const noexcept {
+        return !this->count;
+    }
+
+    template <typename Type>
+    std::size_t Buffer<Type>::size() const noexcept {
+        return this->count;
+    }
+
+    template <typename Type>
+    std::size_t Buffer<Type>::peak() const noexcept {
+        return this->peak_count;
+    }
+
+    template <typename Type>
+    std::size_t Buffer<Type>::bytes_retained() const noexcept {
+        return this->capacity * sizeof(Storage)
+            + this->exceptions.capacity() * sizeof(this->exceptions[0]);
+    }
+
+    template <typename Type>
+    bool Buffer<Type>::is_exception(std::size_t position) const noexcept {
+        return this->exceptions_front < this->exceptions.size()
+            && this->exceptions[this->exceptions_front].first == position;
+    }
+
+    template <typename Type>
+    bool Buffer<Type>::front_is_exception() const noexcept {
+        assert(!this->empty());
+        return this->is_exception(this->pushed - this->count);
+    }
+
+    template <typename Type>
+    template <typename... Args>
+    void Buffer<Type>::emplace(Args&&... args) {
+        if (this->count == this->capacity) {
+            this->grow();
+        }
+
+        auto index = (this->head + this->count) % this->capacity;
+        new (&this->slots[index]) Type(std::forward<Args>(args)...);
+        ++this->count;
+        ++this->pushed;
+        this->peak_count = std::max(this->peak_count, this->count);
+    }
+
+    template <typename Type>
+    void Buffer<Type>::set_exception(std::exception_ptr exception) {
+        if (this->count == this->capacity) {
+            this->grow();
+        }
+
+        // the slot for this position is left empty
+        this->exceptions.emplace_back(this->pushed, std::move(exception));
+        ++this->count;
+        ++this->pushed;
+        this->peak_count = std::max(this->peak_count, this->count);
+    }
+
+    template <typename Type>
+    sharp::Try<Type> Buffer<Type>::pop() {
+        assert(!this->empty());
+
+        auto position = this->pushed - this->count;
+        auto& storage = this->slots[this->head];
+        auto deferred = sharp::defer([&]() {
+            this->head = (this->head + 1) % this->capacity;
+            --this->count;
+        });
+
+        if (this->is_exception(position)) {
+            auto& front = this->exceptions[this->exceptions_front];
+            auto exception = std::move(front.second);
+            ++this->exceptions_front;
+            if (this->exceptions_front == this->exceptions.size()) {
+                this->exceptions.clear();
+                this->exceptions_front = 0;
+            } else if (2 * this->exceptions_front >= this->exceptions.size()) {
+                auto begin = this->exceptions.begin();
+                this->exceptions.erase(begin, begin + this->exceptions_front);
+                this->exceptions_front = 0;
+            }
+            return sharp::Try<Type>{std::move(exception)};
+        }
+
+        auto& value = *reinterpret_cast<Type*>(&storage);
+        auto destroy = sharp::defer([&]() { value.~Type(); });
+        return sharp::Try<Type>{std::move(value)};
+    }
+
+    template <typename Type>
+    template <typename Func>
+    void Buffer<Type>::for_each_value(std::size_t n, Func func) {
+        // the exceptions are sorted by position, so walk them alongside
+        auto front = this->pushed - this->count;
+        auto exception = this->exceptions.begin() + this->exceptions_front;
+        for (auto i = std::size_t{0}; i < n; ++i) {
+            if (exception != this->exceptions.end()
+                    && exception->first == front + i) {
+                ++exception;
+                continue;
+            }
+            func(i);
+        }
+    }
+
+    template <typename Type>
+    void Buffer<Type>::grow() {
+        auto new_capacity = std::max(this->capacity * 2, std::size_t{1});
+        auto new_slots = std::unique_ptr<Storage[]>{new Storage[new_capacity]};
+        auto old_value = [&](auto i) {
+            auto index = (this->head + i) % this->capacity;
+            return reinterpret_cast<Type*>(&this->slots[index]);
+        };
+        auto new_value = [&](auto i) {
+            return reinterpret_cast<Type*>(&new_slots[i]);
+        };
+
+        // move the values over in order so that the front of the queue ends
+        // up at the first slot, if a move throws then destroy the ones that
+        // have been moved and leave the queue as it was
+        auto moved = std::size_t{0};
+        try {
+            this->for_each_value(this->count, [&](auto i) {
+                new (new_value(i)) Type(std::move_if_noexcept(*old_value(i)));
+                moved = i + 1;
+            });
+        } catch (...) {
+            this->for_each_value(moved, [&](auto i) { new_value(i)->~Type(); });
+            throw;
+        }
+
+        this->for_each_value(this->count, [&](auto i) {
+            old_value(i)->~Type();
+        });
+        this->slots = std::move(new_slots);
+        this->capacity = new_capacity;
+        this->head = 0;
+    }
+
+} // namespace channel_detail
+} // namespace sharp
@@ -0,0 +1,138 @@
+/**
+ * @file Channel-pre.hpp
+ * @author Aaryaman Sagar
+ *
+ * Contains the declarations that are shared by the public channel interface
+ * and the different internal queue implementations that a channel can be
+ * backed by
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+
+namespace sharp {
+
+/**
+ * Policies that determine the internal queue used to back a channel.  The
+ * policy is passed as the last template parameter to sharp::Channel, for
+ * example
+ *
+ *      auto channel = sharp::Channel<int, std::mutex, std::condition_variable,
+ *                                    sharp::channel_policy::Mpmc>{1024};
+ *
+ * Locked is the default, all state is kept under a single mutex via
+ * sharp::Concurrent.  This supports unbuffered channels, and is the right
+ * choice when the channel is not heavily contended
+ *
+ * Mpmc backs the channel with a preallocated lock free ring buffer of
+ * buffer_size slots, senders and readers only touch the mutex and condition
+ * variable when the buffer is full or empty respectively.  Since there is no
+ * buffer to rendezvous through, channels with this policy must be
+ * constructed with a buffer size of at least 1
+ *
+ * Spsc is a cheaper version of Mpmc for channels that connect exactly one
+ * sender thread to exactly one reader thread, sends and reads do not do any
+ * read-modify-write atomic operations unless they have to block.  Using a
+ * channel with this policy from more than one sender or reader thread at a
+ * time is undefined behavior.  This also requires a buffer size of at least 1
+ *
+ * Unbounded works like Locked, but the values are kept in a queue that grows
+ * and shrinks in segments as needed.  The argument to the constructor is a
+ * soft capacity in bytes instead of a number of values, sends only block
+ * once the values in the channel take up more than that.  With a capacity of
+ * 0 sends never block, for example
+ *
+ *      // sends block once there are about 1MB worth of values queued up
+ *      using Policy = sharp::channel_policy::Unbounded;
+ *      auto channel = sharp::Channel<Event, std::mutex,
+ *                                    std::condition_variable, Policy>{1 << 20};
+ *
+ * The capacity is compared against sizeof(Type) for each value, memory that
+ * the values own on the heap is not counted
+ */
+namespace channel_policy {
+    struct Locked {};
+    struct Mpmc {};
+    struct Spsc {};
+    struct Unbounded {};
+} // namespace channel_policy
+
+/**
+ * @class ChannelStats
+ *
+ * A snapshot of how full a channel is, returned by Channel::stats().  depth
+ * is the number of values (and exceptions) in the channel, peak_depth the
+ * largest that has been since the channel was created, and bytes_retained
+ * the memory the channel is holding on to for them
+ *
+ * These are meant for sizing buffers from real workloads, the numbers can be
+ * out of date as soon as they are returned
+ */
+struct ChannelStats {
+    std::size_t depth;
+    std::size_t peak_depth;
+    std::size_t bytes_retained;
+};
+
+/**
+ * @class ChannelClosedError
+ *
+ * The exception that is thrown when a value is sent on a closed channel or
+ * when a value is read from a channel that has been closed and has no more
+ * values left in it
+ */
+class ChannelClosedError : public std::logic_error {
+public:
+    using std::logic_error::logic_error;
+};
+
+namespace channel_detail {
+
+    /**
+     * The internal queue implementations, one for each policy above
+     */
+    template <typename Type>
+    class Buffer;
+    template <typename Type>
+    class SegmentedQueue;
+    template <typename Type, typename Mutex, typename Cv,
+              typename Queue = Buffer<Type>>
+    class LockedChannel;
+    template <typename Type, typename Mutex, typename Cv>
+    class MpmcChannel;
+    template <typename Type, typename Mutex, typename Cv>
+    class SpscChannel;
+
+    /**
+     * Maps a channel policy to the implementation that backs it
+     */
+    template <typename Policy>
+    struct ChannelImpl;
+    template <>
+    struct ChannelImpl<channel_policy::Locked> {
+        template <typename Type, typename Mutex, typename Cv>
+        using type = LockedChannel<Type, Mutex, Cv>;
+    };
+    template <>
+    struct ChannelImpl<channel_policy::Mpmc> {
+        template <typename Type, typename Mutex, typename Cv>
+        using type = MpmcChannel<Type, Mutex, Cv>;
+    };
+    template <>
+    struct ChannelImpl<channel_policy::Spsc> {
+        template <typename Type, typename Mutex, typename Cv>
+        using type = SpscChannel<Type, Mutex, Cv>;
+    };
+    template <>
+    struct ChannelImpl<channel_policy::Unbounded> {
+        template <typename Type, typename Mutex, typename Cv>
+        using type = LockedChannel<Type, Mutex, Cv, SegmentedQueue<Type>>;
+    };
+    template <typename Policy, typename Type, typename Mutex, typename Cv>
+    using ChannelImpl_t
+        = typename ChannelImpl<Policy>::template type<Type, Mutex, Cv>;
+
+} // namespace channel_detail
+} // namespace sharp
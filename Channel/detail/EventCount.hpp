@@ -0,0 +1,156 @@
+/**
+ * @file EventCount.hpp
+ * @author Aaryaman Sagar
+ *
+ * A condition variable for lock free data structures.  The threads that
+ * change the data structure don't touch the mutex unless there is someone
+ * sleeping, and the threads that wait on it only go to sleep when the
+ * condition they are waiting on is false
+ */
+
+#pragma once
+
+#include <sharp/Channel/detail/Waiter.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class EventCount
+     *
+     * The usual two sided protocol, the waiter announces itself by bumping
+     * the count of waiters and then rechecks the condition under the mutex,
+     * the notifier first publishes its change to the data structure and then
+     * checks the number of waiters.  Because both sides use sequentially
+     * consistent operations between their write and their read, either the
+     * waiter sees the change or the notifier sees the waiter, so there are no
+     * lost wakeups
+     *
+     * The notifier therefore pays one fence and one load when nobody is
+     * waiting, which is the common case for a channel that is neither full
+     * nor empty
+     *
+     * Threads in select() do not sleep on the condition variable here, they
+     * register a Waiter instead.  A registered waiter counts as a waiting
+     * thread for as long as it is registered, but unlike the sleeping
+     * threads only as many of them are notified as the change lets through
+     */
+    template <typename Mutex, typename Cv>
+    class EventCount {
+    public:
+
+        /**
+         * Block until the predicate returns true, the predicate is called
+         * with the internal mutex held so it should be cheap
+         */
+        template <typename Predicate>
+        void wait(Predicate predicate) {
+            this->waiters.fetch_add(1);
+            {
+                auto lck = std::unique_lock<Mutex>{this->mtx};
+                while (!predicate()) {
+                    this->cv.wait(lck);
+                }
+            }
+            this->waiters.fetch_sub(1);
+        }
+
+        /**
+         * Same as wait() but gives up at the deadline, returns the value of
+         * the predicate on return
+         */
+        template <typename Predicate, typename Clock, typename Duration>
+        bool wait_until(
+                Predicate predicate,
+                const std::chrono::time_point<Clock, Duration>& deadline) {
+            this->waiters.fetch_add(1);
+            auto deferred = sharp::defer([this]() {
+                this->waiters.fetch_sub(1);
+            });
+
+            auto lck = std::unique_lock<Mutex>{this->mtx};
+            while (!predicate()) {
+                if (this->cv.wait_until(lck, deadline)
+                        == std::cv_status::timeout) {
+                    return predicate();
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Wake up all the threads that are waiting and all the registered
+         * waiters, this must be called after the change that might make the
+         * predicates of waiters true has been made visible
+         */
+        void notify_all() {
+            this->notify_registered([this]() {
+                notify_waiters(this->registered);
+            });
+        }
+
+        /**
+         * Same as notify_all() but only wakes up to n of the registered
+         * waiters, for a change that lets n operations through.  Threads
+         * sleeping on the condition variable are all woken up as before
+         */
+        void notify(std::size_t n) {
+            this->notify_registered([this, n]() {
+                notify_waiters(this->registered, n);
+            });
+        }
+
+        /**
+         * Register and unregister a waiter from a select, the node must stay
+         * alive till it has been removed
+         */
+        void add_waiter(WaiterNode* node) {
+            auto lck = std::unique_lock<Mutex>{this->mtx};
+            this->registered.push_back(node);
+            this->waiters.fetch_add(1);
+        }
+        void remove_waiter(WaiterNode* node) {
+            auto lck = std::unique_lock<Mutex>{this->mtx};
+            this->registered.erase(node);
+            this->waiters.fetch_sub(1);
+        }
+
+    private:
+        /**
+         * Does the notifying for notify_all() and notify(), the function is
+         * called to notify the registered waiters with the mutex held
+         */
+        template <typename NotifyFunc>
+        void notify_registered(NotifyFunc notify) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!this->waiters.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            // acquire and release the mutex so that a waiter that has
+            // checked its predicate but has not yet gone to sleep does not
+            // miss the notification, registered waiters that deferred work
+            // run it after the mutex has been released
+            UnlockedNotifications unlocked;
+            {
+                auto lck = std::unique_lock<Mutex>{this->mtx};
+                notify();
+            }
+            this->cv.notify_all();
+        }
+
+        std::atomic<int> waiters{0};
+        WaiterList registered;
+        Mutex mtx;
+        Cv cv;
+    };
+
+} // namespace channel_detail
+} // namespace sharp
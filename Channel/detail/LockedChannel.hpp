@@ -0,0 +1,213 @@
+/**
+ * @file LockedChannel.hpp
+ * @author Aaryaman Sagar
+ *
+ * The default implementation backing sharp::Channel, all the state of the
+ * channel is stored in a sharp::Concurrent object and every operation is
+ * done while holding the lock on that
+ */
+
+#pragma once
+
+#include <sharp/Channel/detail/Buffer.hpp>
+#include <sharp/Channel/detail/Channel-pre.hpp>
+#include <sharp/Channel/detail/SegmentedQueue.hpp>
+#include <sharp/Channel/detail/Waiter.hpp>
+#include <sharp/Concurrent/Concurrent.hpp>
+#include <sharp/Portability/cpp17.hpp>
+#include <sharp/Try/Try.hpp>
+
+#include <chrono>
+#include <cstddef>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class LockedChannel
+     *
+     * A bounded queue protected by a mutex, with the bound being the number
+     * of slots in the channel's buffer plus the number of readers currently
+     * waiting for a value.  The latter is what allows unbuffered channels to
+     * work, a send on an unbuffered channel goes through only when there is a
+     * reader on the other end waiting for it
+     *
+     * Every implementation of a channel has the same interface as this one,
+     * see the other files in this folder.  Reads return an empty Try when the
+     * channel has been closed and there are no more elements left in it,
+     * sharp::Channel converts that into the appropriate exception or end
+     * iterator
+     *
+     * A select that is waiting to read from the channel counts as a waiting
+     * reader for as long as it is registered, otherwise a select could never
+     * read from an unbuffered channel.  If the select then goes with another
+     * case, a value that was sent to it stays in the queue for the next
+     * reader, so the number of open slots can drop below zero till that
+     * value is read
+     *
+     * The queue holding the values is a parameter, a preallocated Buffer by
+     * default or a SegmentedQueue for unbounded channels.  The queue decides
+     * how many open slots the channel starts with from the argument the
+     * channel was constructed with
+     */
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    class LockedChannel {
+    public:
+
+        explicit LockedChannel(int buffer_length);
+
+        /**
+         * Send a value through the channel, the enqueue function is passed a
+         * container with an emplace() method that should be called with the
+         * arguments to construct the value with, or a set_exception() method
+         * to send an exception instead
+         *
+         * These throw a ChannelClosedError if the channel is closed
+         */
+        template <typename EnqueueFunc>
+        void send(EnqueueFunc enqueue);
+        template <typename EnqueueFunc>
+        bool try_send(EnqueueFunc enqueue);
+
+        /**
+         * Same as try_send() but the enqueue function is called without the
+         * internal lock held, a slot is reserved under the lock and the value
+         * is constructed after that.  This is used by select(), where the
+         * value comes from a user callback that might do anything
+         */
+        template <typename EnqueueFunc>
+        bool try_send_unlocked(EnqueueFunc enqueue);
+
+        /**
+         * Read a value from the channel, read() blocks until there is a
+         * value and try_read() returns an empty Try if there is none
+         */
+        sharp::Try<Type> read();
+        sharp::Try<Type> try_read();
+
+        /**
+         * Timed versions of send() and read(), send_until() returns false if
+         * the value could not be sent by the deadline, in which case the
+         * enqueue function is never called.  read_until() returns an empty
+         * optional if nothing could be read by the deadline, otherwise the
+         * Try read, which is empty if the channel was closed
+         *
+         * A reader that times out stops counting as a waiting reader, so it
+         * leaves the number of open slots as it was
+         */
+        template <typename EnqueueFunc, typename Clock, typename Duration>
+        bool send_until(
+                EnqueueFunc enqueue,
+                const std::chrono::time_point<Clock, Duration>& deadline);
+        template <typename Clock, typename Duration>
+        std::optional<sharp::Try<Type>> read_until(
+                const std::chrono::time_point<Clock, Duration>& deadline);
+
+        /**
+         * Batched versions of send() and read()
+         *
+         * send_many() blocks till every value in the range has been sent,
+         * each time it wakes up it sends as many values as there are open
+         * slots
+         *
+         * read_many() blocks till there is at least one value and then reads
+         * up to max values, read_up_to() keeps reading till it has n values
+         * or the deadline passes.  Each value is passed to the consume
+         * function as a Try, and the number of values read is returned.
+         * While these wait they count as max (or n) waiting readers, so on an
+         * unbuffered channel a whole batch can be handed over in one go
+         */
+        template <typename InputIt>
+        void send_many(InputIt first, InputIt last);
+        template <typename ConsumeFunc>
+        std::size_t read_many(std::size_t max, ConsumeFunc consume);
+        template <typename ConsumeFunc, typename Clock, typename Duration>
+        std::size_t read_up_to(
+                std::size_t n,
+                const std::chrono::time_point<Clock, Duration>& deadline,
+                ConsumeFunc consume);
+
+        /**
+         * Close the channel and wake up everyone that is waiting on it
+         */
+        void close();
+        bool is_closed();
+
+        /**
+         * A snapshot of the number of values in the queue and the memory it
+         * holds, see ChannelStats
+         */
+        ChannelStats stats();
+
+        /**
+         * Register and unregister a waiter from a select, till it is removed
+         * the waiter gets notified when the channel might let its operation
+         * through.  A waiter that is removed after it was notified without
+         * taking a value (or slot) passes the notification on to the next
+         * waiter
+         */
+        void add_waiter(WaiterNode* node, SelectOperation operation);
+        void remove_waiter(WaiterNode* node, SelectOperation operation);
+
+    private:
+
+        struct State {
+            /**
+             * The number of open slots in the current buffer, this
+             * corresponds to the number of readers waiting + the buffer
+             * length
+             */
+            State(int buffer_length)
+                : open_slots{Queue::open_slots(buffer_length)},
+                  elements{buffer_length} {}
+            int open_slots;
+
+            /**
+             * Whether close() has been called on the channel
+             */
+            bool closed{false};
+
+            /**
+             * The queue of objects or exceptions, with the default Buffer
+             * this has room for the whole buffer from the start so sends and
+             * reads do not allocate.  Reads get the elements back as a
+             * sharp::Try, see sharp/Try/README.md for documentation and usage
+             * examples of Try
+             *
+             * Represented by a concurrent object so protected by a mutex
+             */
+            Queue elements;
+
+            /**
+             * The selects and coroutines waiting on this channel, by the
+             * operation they are waiting to do.  A change to the channel
+             * only wakes up as many of the matching waiters as there are
+             * values or slots for them, see notify_waiters()
+             */
+            WaiterList readers;
+            WaiterList senders;
+        };
+
+        /**
+         * The list of waiters for the operation
+         */
+        static WaiterList& waiters(State& state, SelectOperation operation);
+
+        /**
+         * Pops up to max values off the queue and passes them to consume,
+         * the announced readers are used up before any new slots are opened,
+         * see read_many().  If stop_at_exception is set an exception after
+         * the first value is left in the queue, and this returns true
+         */
+        template <typename ConsumeFunc>
+        static bool drain(State& state, std::size_t max, int& announced,
+                          std::size_t& count, ConsumeFunc& consume,
+                          bool stop_at_exception = false);
+
+        sharp::Concurrent<State, Mutex, Cv> state;
+    };
+
+} // namespace channel_detail
+} // namespace sharp
+
+#include <sharp/Channel/detail/LockedChannel.ipp>
@@ -0,0 +1,478 @@
+#pragma once
+
+#include <sharp/Channel/detail/LockedChannel.hpp>
+#include <sharp/Defer/Defer.hpp>
+#include <sharp/Portability/cpp17.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <utility>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * The object passed to the enqueue function in try_send_unlocked(), this
+     * holds the value or exception till the lock is reacquired to put it in
+     * the queue
+     */
+    template <typename Type>
+    class UnlockedSlot {
+    public:
+        template <typename... Args>
+        void emplace(Args&&... args) {
+            this->element.emplace(std::in_place, std::forward<Args>(args)...);
+        }
+        void set_exception(std::exception_ptr exception) {
+            this->element.emplace(std::move(exception));
+        }
+
+        /**
+         * Moves the value or exception into the queue
+         */
+        template <typename Queue>
+        void push(Queue& elements) {
+            if (this->element->has_exception()) {
+                elements.set_exception(this->element->exception());
+            } else {
+                elements.emplace(std::move(*this->element).value());
+            }
+        }
+
+        std::optional<sharp::Try<Type>> element;
+    };
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    LockedChannel<Type, Mutex, Cv, Queue>::LockedChannel(int b)
+            : state{std::in_place, b} {}
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    sharp::Try<Type> LockedChannel<Type, Mutex, Cv, Queue>::read() {
+        // increment the number of open slots before going to bed because
+        // there is now a read which is possibly waiting for a write to go
+        // through on the other end, a select might be waiting to send.  The
+        // lock is let go of in between so the waiters can be notified
+        {
+            UnlockedNotifications unlocked;
+            this->state.synchronized([](auto& state) {
+                ++(state.open_slots);
+                notify_waiters(state.senders, 1);
+            });
+        }
+
+        // wait for the elements to have an element and then read it, sleep
+        // af if the elements queue is empty
+        auto state = this->state.lock();
+        state.wait([](auto& state) {
+            return !state.elements.empty() || state.closed;
+        });
+
+        // if the channel was closed and there is nothing left to read then
+        // this reader is not waiting anymore, give the slot back
+        if (state->elements.empty()) {
+            --(state->open_slots);
+            return nullptr;
+        }
+
+        return state->elements.pop();
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    sharp::Try<Type> LockedChannel<Type, Mutex, Cv, Queue>::try_read() {
+        UnlockedNotifications unlocked;
+        return this->state.synchronized([](auto& state) -> sharp::Try<Type> {
+            if (!state.elements.empty()) {
+                // the element that was popped frees up a slot for another
+                // send
+                auto element = state.elements.pop();
+                ++state.open_slots;
+                notify_waiters(state.senders, 1);
+                return element;
+            } else {
+                return nullptr;
+            }
+        });
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename Func>
+    bool LockedChannel<Type, Mutex, Cv, Queue>::try_send(Func enqueue) {
+        UnlockedNotifications unlocked;
+        return this->state.synchronized([&enqueue](auto& state) {
+            if (state.closed) {
+                throw ChannelClosedError{"sharp::Channel: send on closed "
+                                         "channel"};
+            }
+
+            if (state.open_slots > 0) {
+                // if there is space then enqueue the element and decrement
+                // the number of open slots for sends
+                enqueue(state.elements);
+                --(state.open_slots);
+                notify_waiters(state.readers, 1);
+                return true;
+            }
+
+            return false;
+        });
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename Func>
+    bool LockedChannel<Type, Mutex, Cv, Queue>::try_send_unlocked(
+            Func enqueue) {
+        // reserve a slot, after this no other send can take it
+        auto reserved = this->state.synchronized([](auto& state) {
+            if (state.closed) {
+                throw ChannelClosedError{"sharp::Channel: send on closed "
+                                         "channel"};
+            }
+            if (state.open_slots > 0) {
+                --(state.open_slots);
+                return true;
+            }
+            return false;
+        });
+        if (!reserved) {
+            return false;
+        }
+
+        // construct the value without the lock, if that throws then give the
+        // slot back
+        auto slot = UnlockedSlot<Type>{};
+        try {
+            enqueue(slot);
+        } catch (...) {
+            UnlockedNotifications unlocked;
+            this->state.synchronized([](auto& state) {
+                ++(state.open_slots);
+                notify_waiters(state.senders, 1);
+            });
+            throw;
+        }
+
+        // the send went through when the slot was reserved, so the value
+        // goes in even if the channel has been closed since then
+        UnlockedNotifications unlocked;
+        this->state.synchronized([&slot](auto& state) {
+            slot.push(state.elements);
+            notify_waiters(state.readers, 1);
+        });
+        return true;
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename Func>
+    void LockedChannel<Type, Mutex, Cv, Queue>::send(Func enqueue) {
+        UnlockedNotifications unlocked;
+        auto state = this->state.lock();
+
+        // wait for there to be an open slot
+        state.wait([](auto& state) {
+            return state.open_slots > 0 || state.closed;
+        });
+        if (state->closed) {
+            throw ChannelClosedError{"sharp::Channel: send on closed channel"};
+        }
+
+        // then decrement the open slots and write to the queue af
+        enqueue(state->elements);
+        --(state->open_slots);
+        notify_waiters(state->readers, 1);
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename Func, typename Clock, typename Duration>
+    bool LockedChannel<Type, Mutex, Cv, Queue>::send_until(
+            Func enqueue,
+            const std::chrono::time_point<Clock, Duration>& deadline) {
+        UnlockedNotifications unlocked;
+        auto state = this->state.lock();
+        if (!state.wait_until([](auto& state) {
+            return state.open_slots > 0 || state.closed;
+        }, deadline)) {
+            return false;
+        }
+        if (state->closed) {
+            throw ChannelClosedError{"sharp::Channel: send on closed channel"};
+        }
+
+        enqueue(state->elements);
+        --(state->open_slots);
+        notify_waiters(state->readers, 1);
+        return true;
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename Clock, typename Duration>
+    std::optional<sharp::Try<Type>>
+    LockedChannel<Type, Mutex, Cv, Queue>::read_until(
+            const std::chrono::time_point<Clock, Duration>& deadline) {
+        // same as read(), this is a waiting reader till it either gets a
+        // value or gives up
+        {
+            UnlockedNotifications unlocked;
+            this->state.synchronized([](auto& state) {
+                ++(state.open_slots);
+                notify_waiters(state.senders, 1);
+            });
+        }
+
+        auto state = this->state.lock();
+        auto ready = state.wait_until([](auto& state) {
+            return !state.elements.empty() || state.closed;
+        }, deadline);
+
+        // on a timeout or a close this reader is not waiting anymore, the
+        // lock has been held since the condition was checked so no send can
+        // have used the slot in the meantime
+        if (state->elements.empty()) {
+            --(state->open_slots);
+            if (!ready) {
+                return std::nullopt;
+            }
+            return sharp::Try<Type>{nullptr};
+        }
+
+        return state->elements.pop();
+    }
+
+    /**
+     * The number of waiting readers a batched read counts as, called with the
+     * lock held.  Batched reads only announce readers while the open slots
+     * are below half of what an int can hold, so any number of them reading
+     * at once cannot overflow the count.  The other half is headroom for the
+     * readers that count as one each, there is at most one of those per
+     * thread
+     *
+     * A batched read that finds no room left announces no readers and just
+     * waits, there are so many open slots at that point that senders do not
+     * wait for readers anyway
+     */
+    inline int announced_readers(int open_slots, std::size_t max) {
+        constexpr auto ceiling = std::numeric_limits<int>::max() / 2;
+        if (open_slots >= ceiling) {
+            return 0;
+        }
+        auto room = static_cast<std::size_t>(ceiling - std::max(open_slots, 0));
+        return static_cast<int>(std::min(max, room));
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename InputIt>
+    void LockedChannel<Type, Mutex, Cv, Queue>::send_many(InputIt first,
+                                                   InputIt last) {
+        // the lock is taken afresh for every batch, so the waiters notified
+        // about one batch can go ahead before this waits for the next
+        while (first != last) {
+            UnlockedNotifications unlocked;
+            auto state = this->state.lock();
+            state.wait([](auto& state) {
+                return state.open_slots > 0 || state.closed;
+            });
+            if (state->closed) {
+                throw ChannelClosedError{"sharp::Channel: send on closed "
+                                         "channel"};
+            }
+
+            // fill every open slot before letting go of the lock, then wake
+            // up one waiting reader for every value sent
+            auto sent = std::size_t{0};
+            while (state->open_slots > 0 && first != last) {
+                state->elements.emplace(*first);
+                --(state->open_slots);
+                ++first;
+                ++sent;
+            }
+            notify_waiters(state->readers, sent);
+        }
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename ConsumeFunc>
+    bool LockedChannel<Type, Mutex, Cv, Queue>::drain(State& state,
+                                               std::size_t max,
+                                               int& announced,
+                                               std::size_t& count,
+                                               ConsumeFunc& consume,
+                                               bool stop_at_exception) {
+        while (count < max && !state.elements.empty()) {
+            if (stop_at_exception && count
+                    && state.elements.front_is_exception()) {
+                return true;
+            }
+            auto element = state.elements.pop();
+            ++count;
+
+            // a value that was sent to an announced reader was already
+            // accounted for, anything else frees up a slot
+            if (announced > 0) {
+                --announced;
+            } else {
+                ++(state.open_slots);
+            }
+            consume(std::move(element));
+        }
+        return false;
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename ConsumeFunc>
+    std::size_t LockedChannel<Type, Mutex, Cv, Queue>::read_many(
+            std::size_t max, ConsumeFunc consume) {
+        auto count = std::size_t{0};
+        if (!max) {
+            return count;
+        }
+
+        // announce the readers and notify the waiters about them before
+        // going to sleep, the lock is let go of in between
+        auto announced = 0;
+        {
+            UnlockedNotifications unlocked;
+            this->state.synchronized([&](auto& state) {
+                if (state.elements.empty() && !state.closed) {
+                    announced = announced_readers(state.open_slots, max);
+                    state.open_slots += announced;
+                    notify_waiters(state.senders, announced);
+                }
+            });
+        }
+
+        // the readers that have not been used up stop waiting when this
+        // returns, even if consume throws
+        UnlockedNotifications unlocked;
+        auto state = this->state.lock();
+        auto deferred = sharp::defer([&]() {
+            state->open_slots -= announced;
+            notify_waiters(state->senders, count);
+        });
+
+        state.wait([](auto& state) {
+            return !state.elements.empty() || state.closed;
+        });
+        drain(*state, max, announced, count, consume);
+        return count;
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    template <typename ConsumeFunc, typename Clock, typename Duration>
+    std::size_t LockedChannel<Type, Mutex, Cv, Queue>::read_up_to(
+            std::size_t n,
+            const std::chrono::time_point<Clock, Duration>& deadline,
+            ConsumeFunc consume) {
+        auto count = std::size_t{0};
+        if (!n) {
+            return count;
+        }
+
+        auto announced = 0;
+        {
+            UnlockedNotifications unlocked;
+            this->state.synchronized([&](auto& state) {
+                announced = announced_readers(state.open_slots, n);
+                state.open_slots += announced;
+                notify_waiters(state.senders, announced);
+            });
+        }
+
+        UnlockedNotifications unlocked;
+        auto state = this->state.lock();
+        auto deferred = sharp::defer([&]() {
+            state->open_slots -= announced;
+            notify_waiters(state->senders, count);
+        });
+
+        // an exception after the first value ends the batch and is left for
+        // the next read, so the values before it are not lost
+        while (true) {
+            auto stopped = drain(*state, n, announced, count, consume, true);
+            if (count == n || state->closed || stopped) {
+                return count;
+            }
+            if (!state.wait_until([](auto& state) {
+                return !state.elements.empty() || state.closed;
+            }, deadline)) {
+                return count;
+            }
+        }
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    void LockedChannel<Type, Mutex, Cv, Queue>::close() {
+        // the unlock at the end of this wakes everyone up
+        UnlockedNotifications unlocked;
+        this->state.synchronized([](auto& state) {
+            state.closed = true;
+            notify_waiters(state.readers);
+            notify_waiters(state.senders);
+        });
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    WaiterList& LockedChannel<Type, Mutex, Cv, Queue>::waiters(
+            State& state, SelectOperation operation) {
+        if (operation == SelectOperation::READ) {
+            return state.readers;
+        }
+        return state.senders;
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    ChannelStats LockedChannel<Type, Mutex, Cv, Queue>::stats() {
+        return this->state.synchronized([](auto& state) {
+            return ChannelStats{state.elements.size(), state.elements.peak(),
+                                state.elements.bytes_retained()};
+        });
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    bool LockedChannel<Type, Mutex, Cv, Queue>::is_closed() {
+        return this->state.synchronized([](auto& state) {
+            return state.closed;
+        });
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    void LockedChannel<Type, Mutex, Cv, Queue>::add_waiter(
+            WaiterNode* node, SelectOperation operation) {
+        UnlockedNotifications unlocked;
+        this->state.synchronized([&](auto& state) {
+            waiters(state, operation).push_back(node);
+
+            // a select waiting to read is a waiting reader as far as senders
+            // are concerned, see the class documentation
+            if (operation == SelectOperation::READ) {
+                ++(state.open_slots);
+                notify_waiters(state.senders, 1);
+            }
+        });
+    }
+
+    template <typename Type, typename Mutex, typename Cv, typename Queue>
+    void LockedChannel<Type, Mutex, Cv, Queue>::remove_waiter(
+            WaiterNode* node, SelectOperation operation) {
+        UnlockedNotifications unlocked;
+        this->state.synchronized([&](auto& state) {
+            waiters(state, operation).erase(node);
+            if (operation == SelectOperation::READ) {
+                --(state.open_slots);
+            }
+
+            // the waiter might have been woken up for a value or a slot that
+            // it did not take, in which case the next waiter gets a turn
+            if (operation == SelectOperation::READ) {
+                if (!state.elements.empty()) {
+                    notify_waiters(state.readers, 1);
+                }
+            } else if (state.open_slots > 0 && !state.closed) {
+                notify_waiters(state.senders, 1);
+            }
+        });
+    }
+
+} // namespace channel_detail
+} // namespace sharp
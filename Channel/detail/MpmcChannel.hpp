@@ -0,0 +1,141 @@
+/**
+ * @file MpmcChannel.hpp
+ * @author Aaryaman Sagar
+ *
+ * The implementation backing sharp::Channel with the Mpmc policy, this is a
+ * bounded lock free queue based on Dmitry Vyukov's ring buffer with sequence
+ * numbered cells, see
+ * http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ */
+
+#pragma once
+
+#include <sharp/Channel/detail/Channel-pre.hpp>
+#include <sharp/Channel/detail/RingChannel.hpp>
+#include <sharp/Portability/cpp17.hpp>
+#include <sharp/Try/Try.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class MpmcChannel
+     *
+     * Each slot in the ring has a sequence number that tells senders and
+     * readers whose turn it is to use the slot.  On lap n around the ring
+     * (i.e. position / capacity == n), the sender that gets the position
+     * waits for the sequence number to be 2n, constructs the value in the
+     * slot and sets the sequence number to 2n + 1.  That hands the slot to
+     * the reader at the same position, which moves the value out and sets
+     * the sequence number to 2n + 2, giving it to the sender on the next lap.
+     * Keeping the send and read turns apart like this is what lets the ring
+     * work with a single slot
+     *
+     * So senders and readers only contend with each other on the two position
+     * counters and never on a lock.  The mutex and condition variable are only
+     * touched when a sender finds the ring full or a reader finds it empty,
+     * see RingChannel and EventCount
+     *
+     * Each slot is padded to a cache line so that a sender writing into one
+     * slot does not slow down a reader reading the slot next to it
+     */
+    template <typename Type, typename Mutex, typename Cv>
+    class MpmcChannel : public RingChannel<MpmcChannel<Type, Mutex, Cv>,
+                                           Type, Mutex, Cv> {
+    public:
+
+        /**
+         * Allocates all the slots up front, throws std::invalid_argument if
+         * the buffer length is not at least 1
+         */
+        explicit MpmcChannel(int buffer_length);
+        ~MpmcChannel();
+
+        /**
+         * The rest of the channel interface is implemented in terms of the
+         * ring operations below
+         */
+        template <typename, typename, typename, typename>
+        friend class RingChannel;
+
+        /**
+         * See RingChannel
+         */
+        static constexpr bool single_sender = false;
+
+    private:
+
+        /**
+         * A slot in the ring buffer
+         */
+        struct alignas(hardware_destructive_interference_size) Cell {
+            std::atomic<std::size_t> sequence;
+            std::atomic<bool> exception;
+            std::aligned_storage_t<sizeof(sharp::Try<Type>),
+                                   alignof(sharp::Try<Type>)> storage;
+        };
+
+        /**
+         * The object passed to enqueue functions, constructs the value
+         * directly in the cell that has been claimed
+         */
+        class Slot;
+
+        /**
+         * Non blocking push and pop on the ring.  try_push() only calls the
+         * enqueue function after it has claimed a slot, so the value is never
+         * moved out of the caller if the ring is full.  try_pop() sets popped
+         * to true when it consumed a slot
+         *
+         * A sender marks the cell when it holds an exception, so a reader
+         * can leave an exception in the ring without claiming its cell, see
+         * RingChannel
+         */
+        template <typename EnqueueFunc>
+        bool try_push(EnqueueFunc& enqueue);
+        sharp::Try<Type> try_pop(bool& popped, bool* stopped = nullptr);
+
+        /**
+         * The cell a position maps to and the sequence numbers the cell must
+         * have for a sender or a reader at that position to use it
+         */
+        Cell& cell_for(std::size_t position) const;
+        std::size_t send_turn(std::size_t position) const;
+        std::size_t read_turn(std::size_t position) const;
+
+        /**
+         * Snapshots of whether the ring is full or empty, used as predicates
+         * for sleeping
+         */
+        bool is_full() const;
+        bool is_empty() const;
+
+        /**
+         * The number of slots and the slots themselves, allocated once and
+         * aligned by hand to a cache line boundary
+         */
+        const std::size_t capacity;
+        std::unique_ptr<unsigned char[]> memory;
+        Cell* cells;
+
+        /**
+         * The positions senders and readers claim slots at, padded so that
+         * they do not share a cache line with each other or with the read
+         * mostly fields above
+         */
+        char padding_one[hardware_destructive_interference_size];
+        std::atomic<std::size_t> enqueue_position{0};
+        char padding_two[hardware_destructive_interference_size];
+        std::atomic<std::size_t> dequeue_position{0};
+        char padding_three[hardware_destructive_interference_size];
+    };
+
+} // namespace channel_detail
+} // namespace sharp
+
+#include <sharp/Channel/detail/MpmcChannel.ipp>
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <sharp/Channel/detail/MpmcChannel.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace sharp {
+namespace channel_detail {
+
+    template <typename Type, typename Mutex, typename Cv>
+    class MpmcChannel<Type, Mutex, Cv>::Slot {
+    public:
+        explicit Slot(void* storage_in) : storage{storage_in} {}
+
+        template <typename... Args>
+        void emplace(Args&&... args) {
+            new (this->storage) sharp::Try<Type>(std::in_place,
+                                                 std::forward<Args>(args)...);
+        }
+        void set_exception(std::exception_ptr exception) {
+            new (this->storage) sharp::Try<Type>(std::move(exception));
+        }
+
+    private:
+        void* storage;
+    };
+
+    template <typename Type, typename Mutex, typename Cv>
+    MpmcChannel<Type, Mutex, Cv>::MpmcChannel(int buffer_length)
+            : capacity{static_cast<std::size_t>(buffer_length)} {
+        if (buffer_length < 1) {
+            throw std::invalid_argument{"sharp::Channel: the Mpmc policy "
+                                        "requires a buffer of at least 1"};
+        }
+
+        // over allocate by an alignment's worth and then align the cells by
+        // hand, this does not rely on the allocator supporting over aligned
+        // types
+        auto bytes = sizeof(Cell) * this->capacity + alignof(Cell);
+        this->memory.reset(new unsigned char[bytes]);
+        auto* pointer = static_cast<void*>(this->memory.get());
+        pointer = std::align(alignof(Cell), sizeof(Cell) * this->capacity,
+                             pointer, bytes);
+        this->cells = static_cast<Cell*>(pointer);
+
+        // each slot starts out ready to be claimed by the sender on the
+        // first lap
+        for (auto i = std::size_t{0}; i < this->capacity; ++i) {
+            auto* cell = new (&this->cells[i]) Cell;
+            cell->sequence.store(0, std::memory_order_relaxed);
+            cell->exception.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    MpmcChannel<Type, Mutex, Cv>::~MpmcChannel() {
+        // destroy whatever is left in the ring
+        auto popped = true;
+        while (popped) {
+            this->try_pop(popped);
+        }
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    typename MpmcChannel<Type, Mutex, Cv>::Cell&
+    MpmcChannel<Type, Mutex, Cv>::cell_for(std::size_t position) const {
+        return this->cells[position % this->capacity];
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    std::size_t MpmcChannel<Type, Mutex, Cv>::send_turn(std::size_t position)
+            const {
+        return 2 * (position / this->capacity);
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    std::size_t MpmcChannel<Type, Mutex, Cv>::read_turn(std::size_t position)
+            const {
+        return 2 * (position / this->capacity) + 1;
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    template <typename EnqueueFunc>
+    bool MpmcChannel<Type, Mutex, Cv>::try_push(EnqueueFunc& enqueue) {
+        auto position = this->enqueue_position.load(std::memory_order_relaxed);
+        auto cell = static_cast<Cell*>(nullptr);
+
+        while (true) {
+            cell = &this->cell_for(position);
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::intptr_t>(sequence)
+                - static_cast<std::intptr_t>(this->send_turn(position));
+
+            // the slot is free for this lap, try and claim it, if the CAS
+            // fails then position has been updated with the new value
+            if (difference == 0) {
+                if (this->enqueue_position.compare_exchange_weak(
+                            position, position + 1,
+                            std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // the reader from the previous lap has not consumed the slot
+                // yet, so the ring is full
+                return false;
+            } else {
+                position = this->enqueue_position.load(
+                        std::memory_order_relaxed);
+            }
+        }
+
+        // hand the slot over to the reader regardless of whether the
+        // construction succeeded, if it threw then leave an empty Try that
+        // readers skip, otherwise the ring would be stuck on this slot
+        auto deferred = sharp::defer([&]() {
+            auto& element = *reinterpret_cast<sharp::Try<Type>*>(
+                    &cell->storage);
+            cell->exception.store(element.has_exception(),
+                                  std::memory_order_release);
+            cell->sequence.store(this->read_turn(position),
+                                 std::memory_order_release);
+        });
+        try {
+            auto slot = Slot{&cell->storage};
+            enqueue(slot);
+        } catch (...) {
+            new (&cell->storage) sharp::Try<Type>{nullptr};
+            throw;
+        }
+
+        return true;
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    sharp::Try<Type> MpmcChannel<Type, Mutex, Cv>::try_pop(bool& popped,
+                                                           bool* stopped) {
+        auto position = this->dequeue_position.load(std::memory_order_relaxed);
+        auto cell = static_cast<Cell*>(nullptr);
+        popped = false;
+
+        while (true) {
+            cell = &this->cell_for(position);
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::intptr_t>(sequence)
+                - static_cast<std::intptr_t>(this->read_turn(position));
+
+            // an exception is left where it is when asked to stop at one.
+            // The mark is only trusted if the cell still holds the same lap
+            // after reading it, the mark of a sender on a later lap is
+            // ordered after the reader that moved the sequence on
+            if (difference == 0 && stopped
+                    && cell->exception.load(std::memory_order_acquire)) {
+                if (cell->sequence.load(std::memory_order_relaxed)
+                        == sequence) {
+                    *stopped = true;
+                    return nullptr;
+                }
+                position = this->dequeue_position.load(
+                        std::memory_order_relaxed);
+            } else if (difference == 0) {
+                if (this->dequeue_position.compare_exchange_weak(
+                            position, position + 1,
+                            std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return nullptr;
+            } else {
+                position = this->dequeue_position.load(
+                        std::memory_order_relaxed);
+            }
+        }
+
+        // move the value out and then give the slot to the sender on the
+        // next lap
+        using TryType = sharp::Try<Type>;
+        auto& element = *reinterpret_cast<TryType*>(&cell->storage);
+        auto deferred = sharp::defer([&]() {
+            element.~TryType();
+            cell->sequence.store(this->read_turn(position) + 1,
+                                 std::memory_order_release);
+        });
+        popped = true;
+        return std::move(element);
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    bool MpmcChannel<Type, Mutex, Cv>::is_full() const {
+        while (true) {
+            auto position = this->enqueue_position.load();
+            auto& cell = this->cell_for(position);
+            auto difference = static_cast<std::intptr_t>(cell.sequence.load())
+                - static_cast<std::intptr_t>(this->send_turn(position));
+
+            // if the difference is positive then the position was stale
+            if (difference <= 0) {
+                return difference < 0;
+            }
+        }
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    bool MpmcChannel<Type, Mutex, Cv>::is_empty() const {
+        while (true) {
+            auto position = this->dequeue_position.load();
+            auto& cell = this->cell_for(position);
+            auto difference = static_cast<std::intptr_t>(cell.sequence.load())
+                - static_cast<std::intptr_t>(this->read_turn(position));
+
+            if (difference <= 0) {
+                return difference < 0;
+            }
+        }
+    }
+
+} // namespace channel_detail
+} // namespace sharp
@@ -0,0 +1,140 @@
+/**
+ * @file RingChannel.hpp
+ * @author Aaryaman Sagar
+ *
+ * The parts of a channel implementation that are common to all the lock free
+ * ring buffers backing sharp::Channel.  Everything here is written in terms
+ * of non blocking pushes and pops on the ring, and blocking is done on an
+ * EventCount when those fail
+ */
+
+#pragma once
+
+#include <sharp/Channel/detail/Channel-pre.hpp>
+#include <sharp/Channel/detail/EventCount.hpp>
+#include <sharp/Channel/detail/Waiter.hpp>
+#include <sharp/Portability/cpp17.hpp>
+#include <sharp/Try/Try.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class RingChannel
+     *
+     * A CRTP base class that implements the channel interface (see
+     * LockedChannel) on top of the following methods in the derived class
+     *
+     *      // call enqueue with a slot that has an emplace() method once
+     *      // there is space in the ring, without holding any locks, and
+     *      // return false without calling it if the ring is full
+     *      template <typename EnqueueFunc>
+     *      bool try_push(EnqueueFunc& enqueue);
+     *
+     *      // pop a value off the ring, setting popped to true if a slot was
+     *      // consumed.  A slot can hold an empty Try if the send that wrote
+     *      // it threw, those are skipped.  If stopped is not null and the
+     *      // front of the ring is an exception, it is left there and
+     *      // stopped is set to true
+     *      sharp::Try<Type> try_pop(bool& popped, bool* stopped = nullptr);
+     *
+     *      // snapshots of the state of the ring, used as predicates for
+     *      // sleeping
+     *      bool is_full() const;
+     *      bool is_empty() const;
+     *
+     *      // whether only one thread sends at a time, in which case the
+     *      // sender does not need a read-modify-write to announce a push
+     *      static constexpr bool single_sender;
+     *
+     * Senders sleep on one EventCount when the ring is full and readers on
+     * the other when it is empty, so as long as the ring is neither, sends
+     * and reads never touch a mutex
+     */
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    class RingChannel {
+    public:
+
+        /**
+         * Same interface as LockedChannel
+         */
+        template <typename EnqueueFunc>
+        void send(EnqueueFunc enqueue);
+        template <typename EnqueueFunc>
+        bool try_send(EnqueueFunc enqueue);
+        template <typename EnqueueFunc>
+        bool try_send_unlocked(EnqueueFunc enqueue);
+        sharp::Try<Type> read();
+        sharp::Try<Type> try_read();
+        template <typename EnqueueFunc, typename Clock, typename Duration>
+        bool send_until(
+                EnqueueFunc enqueue,
+                const std::chrono::time_point<Clock, Duration>& deadline);
+        template <typename Clock, typename Duration>
+        std::optional<sharp::Try<Type>> read_until(
+                const std::chrono::time_point<Clock, Duration>& deadline);
+        template <typename InputIt>
+        void send_many(InputIt first, InputIt last);
+        template <typename ConsumeFunc>
+        std::size_t read_many(std::size_t max, ConsumeFunc consume);
+        template <typename ConsumeFunc, typename Clock, typename Duration>
+        std::size_t read_up_to(
+                std::size_t n,
+                const std::chrono::time_point<Clock, Duration>& deadline,
+                ConsumeFunc consume);
+        void close();
+        bool is_closed();
+        void add_waiter(WaiterNode* node, SelectOperation operation);
+        void remove_waiter(WaiterNode* node, SelectOperation operation);
+
+    private:
+
+        /**
+         * Returns the derived object
+         */
+        Derived& instance();
+
+        /**
+         * Pushes onto the ring unless the channel is closing, in which case
+         * this throws a ChannelClosedError.  close() waits for the pushes
+         * that are in progress to finish, so a value that made it into the
+         * ring is always seen by readers before they see the channel closed
+         */
+        template <typename EnqueueFunc>
+        bool push(EnqueueFunc& enqueue);
+
+        /**
+         * Pops values off the ring till there are max of them or the ring is
+         * empty, returns the number of slots freed up.  Slots left behind
+         * by failed sends are freed up but not counted as values read.  If
+         * stopped is not null an exception after the first value is left in
+         * the ring, and stopped is set to true
+         */
+        template <typename ConsumeFunc>
+        std::size_t drain(std::size_t max, std::size_t& count, ConsumeFunc& consume,
+                   bool* stopped = nullptr);
+
+        /**
+         * closing is set first by close() and stops new pushes, closed is
+         * set once the pushes in progress (counted by pushing) are done
+         */
+        std::atomic<bool> closing{false};
+        std::atomic<int> pushing{0};
+        std::atomic<bool> closed{false};
+
+        /**
+         * Readers sleep on this when the ring is empty and senders sleep on
+         * the other when the ring is full
+         */
+        EventCount<Mutex, Cv> readers;
+        EventCount<Mutex, Cv> senders;
+    };
+
+} // namespace channel_detail
+} // namespace sharp
+
+#include <sharp/Channel/detail/RingChannel.ipp>
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <sharp/Channel/detail/RingChannel.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+namespace sharp {
+namespace channel_detail {
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    Derived& RingChannel<Derived, Type, Mutex, Cv>::instance() {
+        return static_cast<Derived&>(*this);
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename EnqueueFunc>
+    void RingChannel<Derived, Type, Mutex, Cv>::send(EnqueueFunc enqueue) {
+        while (true) {
+            if (this->push(enqueue)) {
+                this->readers.notify(1);
+                return;
+            }
+
+            // the ring was full, sleep till a reader makes space
+            this->senders.wait([this]() {
+                return !this->instance().is_full() || this->closed.load();
+            });
+        }
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename EnqueueFunc>
+    bool RingChannel<Derived, Type, Mutex, Cv>::try_send(EnqueueFunc enqueue) {
+        if (this->push(enqueue)) {
+            this->readers.notify(1);
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename EnqueueFunc>
+    bool RingChannel<Derived, Type, Mutex, Cv>::try_send_unlocked(
+            EnqueueFunc enqueue) {
+        // there are no locks to begin with, and the enqueue function is only
+        // called once a slot has been claimed
+        return this->try_send(std::move(enqueue));
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    sharp::Try<Type> RingChannel<Derived, Type, Mutex, Cv>::read() {
+        while (true) {
+            // load the closed flag before trying to pop so that if the
+            // channel was closed, everything sent before the close is
+            // visible to the pop below
+            auto closed = this->closed.load(std::memory_order_acquire);
+            auto popped = false;
+            auto element = this->instance().try_pop(popped);
+
+            if (popped) {
+                this->senders.notify(1);
+                if (element.valid()) {
+                    return element;
+                }
+                continue;
+            } else if (closed) {
+                return nullptr;
+            }
+
+            // the ring was empty, sleep till a sender puts something in it
+            this->readers.wait([this]() {
+                return !this->instance().is_empty() || this->closed.load();
+            });
+        }
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    sharp::Try<Type> RingChannel<Derived, Type, Mutex, Cv>::try_read() {
+        auto popped = true;
+        while (popped) {
+            auto element = this->instance().try_pop(popped);
+            if (popped) {
+                this->senders.notify(1);
+                if (element.valid()) {
+                    return element;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename EnqueueFunc, typename Clock, typename Duration>
+    bool RingChannel<Derived, Type, Mutex, Cv>::send_until(
+            EnqueueFunc enqueue,
+            const std::chrono::time_point<Clock, Duration>& deadline) {
+        while (true) {
+            if (this->push(enqueue)) {
+                this->readers.notify(1);
+                return true;
+            }
+            if (!this->senders.wait_until([this]() {
+                return !this->instance().is_full() || this->closed.load();
+            }, deadline)) {
+                return false;
+            }
+        }
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename Clock, typename Duration>
+    std::optional<sharp::Try<Type>>
+    RingChannel<Derived, Type, Mutex, Cv>::read_until(
+            const std::chrono::time_point<Clock, Duration>& deadline) {
+        while (true) {
+            auto closed = this->closed.load(std::memory_order_acquire);
+            auto popped = false;
+            auto element = this->instance().try_pop(popped);
+
+            if (popped) {
+                this->senders.notify(1);
+                if (element.valid()) {
+                    return element;
+                }
+                continue;
+            } else if (closed) {
+                return sharp::Try<Type>{nullptr};
+            }
+
+            if (!this->readers.wait_until([this]() {
+                return !this->instance().is_empty() || this->closed.load();
+            }, deadline)) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename InputIt>
+    void RingChannel<Derived, Type, Mutex, Cv>::send_many(InputIt first,
+                                                 InputIt last) {
+        // readers are woken up once for every run of values that made it
+        // into the ring, rather than once per value
+        auto pushed = std::size_t{0};
+        auto deferred = sharp::defer([&]() {
+            if (pushed) {
+                this->readers.notify(pushed);
+            }
+        });
+
+        while (first != last) {
+            auto enqueue = [&first](auto& slot) { slot.emplace(*first); };
+            if (this->push(enqueue)) {
+                ++pushed;
+                ++first;
+                continue;
+            }
+
+            // the ring is full, let the readers know about everything so far
+            // and then sleep till they make space
+            if (pushed) {
+                this->readers.notify(pushed);
+                pushed = 0;
+            }
+            this->senders.wait([this]() {
+                return !this->instance().is_full() || this->closed.load();
+            });
+        }
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename ConsumeFunc>
+    std::size_t RingChannel<Derived, Type, Mutex, Cv>::drain(std::size_t max,
+                                             std::size_t& count,
+                                             ConsumeFunc& consume,
+                                             bool* stopped) {
+        auto freed = std::size_t{0};
+        while (count < max) {
+            auto popped = false;
+            auto element = this->instance().try_pop(
+                    popped, count ? stopped : nullptr);
+            if (!popped) {
+                break;
+            }
+            ++freed;
+            if (element.valid()) {
+                ++count;
+                consume(std::move(element));
+            }
+        }
+        return freed;
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename ConsumeFunc>
+    std::size_t RingChannel<Derived, Type, Mutex, Cv>::read_many(
+            std::size_t max, ConsumeFunc consume) {
+        // the slots that were freed up are handed to senders on the way
+        // out, even if consume throws
+        auto count = std::size_t{0};
+        auto freed = std::size_t{0};
+        auto deferred = sharp::defer([this, &freed]() {
+            this->senders.notify(std::max(freed, std::size_t{1}));
+        });
+
+        while (count == 0 && max) {
+            auto closed = this->closed.load(std::memory_order_acquire);
+            freed += this->drain(max, count, consume);
+            if (count || closed) {
+                break;
+            }
+            this->readers.wait([this]() {
+                return !this->instance().is_empty() || this->closed.load();
+            });
+        }
+        return count;
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename ConsumeFunc, typename Clock, typename Duration>
+    std::size_t RingChannel<Derived, Type, Mutex, Cv>::read_up_to(
+            std::size_t n,
+            const std::chrono::time_point<Clock, Duration>& deadline,
+            ConsumeFunc consume) {
+        auto count = std::size_t{0};
+        auto stopped = false;
+        auto deferred = sharp::defer([this]() {
+            this->senders.notify(1);
+        });
+
+        // an exception after the first value ends the batch and is left for
+        // the next read, so the values before it are not lost
+        while (count < n) {
+            auto closed = this->closed.load(std::memory_order_acquire);
+            auto freed = this->drain(n, count, consume, &stopped);
+            if (freed) {
+                // let blocked senders refill the ring while this waits for
+                // the rest
+                this->senders.notify(freed);
+            }
+            if (count == n || closed || stopped) {
+                break;
+            }
+            if (!this->readers.wait_until([this]() {
+                return !this->instance().is_empty() || this->closed.load();
+            }, deadline)) {
+                break;
+            }
+        }
+        return count;
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    template <typename EnqueueFunc>
+    bool RingChannel<Derived, Type, Mutex, Cv>::push(EnqueueFunc& enqueue) {
+        // announce the push before checking whether the channel is closing,
+        // either close() sees the push and waits for it or the push sees
+        // that the channel is closing, the fences on both sides make sure it
+        // cannot be neither.  A lone sender can announce itself with a plain
+        // store
+        if (Derived::single_sender) {
+            this->pushing.store(1, std::memory_order_relaxed);
+        } else {
+            this->pushing.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto deferred = sharp::defer([this]() {
+            if (Derived::single_sender) {
+                this->pushing.store(0, std::memory_order_release);
+            } else {
+                this->pushing.fetch_sub(1, std::memory_order_release);
+            }
+        });
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (this->closing.load(std::memory_order_relaxed)) {
+            throw ChannelClosedError{"sharp::Channel: send on closed channel"};
+        }
+        return this->instance().try_push(enqueue);
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    void RingChannel<Derived, Type, Mutex, Cv>::close() {
+        // stop new pushes and wait out the ones that got in before that, only
+        // then can readers take an empty ring to mean the channel is done.
+        // Pushes never block, so this does not wait for long
+        this->closing.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (this->pushing.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        this->closed.store(true, std::memory_order_release);
+        this->readers.notify_all();
+        this->senders.notify_all();
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    bool RingChannel<Derived, Type, Mutex, Cv>::is_closed() {
+        return this->closed.load(std::memory_order_acquire);
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    void RingChannel<Derived, Type, Mutex, Cv>::add_waiter(WaiterNode* node,
+                                                  SelectOperation operation) {
+        if (operation == SelectOperation::READ) {
+            this->readers.add_waiter(node);
+        } else {
+            this->senders.add_waiter(node);
+        }
+    }
+
+    template <typename Derived, typename Type, typename Mutex, typename Cv>
+    void RingChannel<Derived, Type, Mutex, Cv>::remove_waiter(
+            WaiterNode* node, SelectOperation operation) {
+        // the waiter might have been woken up for a value or a slot that it
+        // did not take, in which case the next waiter gets a turn
+        if (operation == SelectOperation::READ) {
+            this->readers.remove_waiter(node);
+            if (!this->instance().is_empty()) {
+                this->readers.notify(1);
+            }
+        } else {
+            this->senders.remove_waiter(node);
+            if (!this->instance().is_full()) {
+                this->senders.notify(1);
+            }
+        }
+    }
+
+} // namespace channel_detail
+} // namespace sharp
@@ -0,0 +1,130 @@
+/**
+ * @file SegmentedQueue.hpp
+ * @author Aaryaman Sagar
+ *
+ * The queue of values that LockedChannel keeps under its lock with the
+ * Unbounded policy, a linked list of fixed size segments that grows and
+ * shrinks a segment at a time
+ */
+
+#pragma once
+
+#include <sharp/Try/Try.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <exception>
+#include <type_traits>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class SegmentedQueue
+     *
+     * A FIFO queue with no bound on its size.  Values live in segments of
+     * about a page each, a segment is allocated when the last one fills up
+     * and freed once every value in it has been read, so the memory held
+     * follows the number of values in the queue instead of staying at the
+     * largest it has ever been
+     *
+     * One emptied segment is kept around instead of being freed, so a queue
+     * that hovers around a segment boundary does not allocate and free a
+     * segment on every other operation
+     *
+     * Same interface as Buffer, and not thread safe either
+     */
+    template <typename Type>
+    class SegmentedQueue {
+    public:
+
+        /**
+         * The argument is the soft capacity of the queue in bytes, see
+         * open_slots().  Nothing is allocated till the first value is sent
+         */
+        explicit SegmentedQueue(int high_watermark);
+        ~SegmentedQueue();
+
+        SegmentedQueue(const SegmentedQueue&) = delete;
+        SegmentedQueue(SegmentedQueue&&) = delete;
+        SegmentedQueue& operator=(const SegmentedQueue&) = delete;
+        SegmentedQueue& operator=(SegmentedQueue&&) = delete;
+
+        /**
+         * The number of slots the channel starts out with, the high
+         * watermark divided by the number of bytes a value takes up in the
+         * queue.  Sends block once the values in the queue take up more than
+         * that.  A high watermark of 0 means sends never block
+         */
+        static int open_slots(int high_watermark);
+
+        /**
+         * Same as Buffer
+         */
+        template <typename... Args>
+        void emplace(Args&&... args);
+        void set_exception(std::exception_ptr exception);
+        sharp::Try<Type> pop();
+        bool front_is_exception() const noexcept;
+        bool empty() const noexcept;
+        std::size_t size() const noexcept;
+
+        /**
+         * The largest number of values that have been in the queue at once,
+         * and the number of bytes held by the segments, including the one
+         * kept around for reuse
+         */
+        std::size_t peak() const noexcept;
+        std::size_t bytes_retained() const noexcept;
+
+    private:
+        using Element = sharp::Try<Type>;
+        using Storage = std::aligned_storage_t<sizeof(Element),
+                                               alignof(Element)>;
+
+        /**
+         * The number of values in a segment, enough to fill about a page but
+         * never too few to be worth the link
+         */
+        static constexpr std::size_t segment_length
+            = std::max(std::size_t{16}, std::size_t{4096} / sizeof(Element));
+
+        struct Segment {
+            std::array<Storage, segment_length> slots;
+            Segment* next{nullptr};
+        };
+
+        /**
+         * Returns a slot at the back of the queue to construct a value in,
+         * linking in a new segment if the last one is full
+         */
+        void* back();
+        void pushed() noexcept;
+
+        /**
+         * Get a segment from the spare or allocate one, and free one or keep
+         * it as the spare
+         */
+        Segment* acquire();
+        void release(Segment* segment) noexcept;
+
+        /**
+         * The segments values are read from and written to, and the indices
+         * of the next slot to read and write in those
+         */
+        Segment* head{nullptr};
+        Segment* tail{nullptr};
+        std::size_t head_index{0};
+        std::size_t tail_index{0};
+        Segment* spare{nullptr};
+
+        std::size_t count{0};
+        std::size_t peak_count{0};
+        std::size_t segments{0};
+    };
+
+} // namespace channel_detail
+} // namespace sharp
+
+#include <sharp/Channel/detail/SegmentedQueue.ipp>
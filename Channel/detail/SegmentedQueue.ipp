@@ -0,0 +1,166 @@
+#pragma once
+
+#include <sharp/Channel/detail/SegmentedQueue.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <new>
+#include <utility>
+
+namespace sharp {
+namespace channel_detail {
+
+    template <typename Type>
+    constexpr std::size_t SegmentedQueue<Type>::segment_length;
+
+    template <typename Type>
+    SegmentedQueue<Type>::SegmentedQueue(int) {}
+
+    template <typename Type>
+    SegmentedQueue<Type>::~SegmentedQueue() {
+        while (!this->empty()) {
+            this->pop();
+        }
+        while (this->head) {
+            delete std::exchange(this->head, this->head->next);
+        }
+        delete this->spare;
+    }
+
+    template <typename Type>
+    int SegmentedQueue<Type>::open_slots(int high_watermark) {
+        // leave headroom for the readers that get added to the open slots,
+        // see announced_readers()
+        constexpr auto unbounded = std::numeric_limits<int>::max() / 4;
+        if (high_watermark <= 0) {
+            return unbounded;
+        }
+        auto slots = static_cast<std::size_t>(high_watermark) / sizeof(Element);
+        return static_cast<int>(std::max(slots, std::size_t{1}));
+    }
+
+    template <typename Type>
+    bool SegmentedQueue<Type>::front_is_exception() const noexcept {
+        assert(!this->empty());
+
+        // the head segment might be used up, see pop()
+        auto segment = this->head;
+        auto index = this->head_index;
+        if (index == segment_length) {
+            segment = segment->next;
+            index = 0;
+        }
+        return reinterpret_cast<const Element*>(&segment->slots[index])
+            ->has_exception();
+    }
+
+    template <typename Type>
+    bool SegmentedQueue<Type>::empty() const noexcept {
+        return !this->count;
+    }
+
+    template <typename Type>
+    std::size_t SegmentedQueue<Type>::size() const noexcept {
+        return this->count;
+    }
+
+    template <typename Type>
+    std::size_t SegmentedQueue<Type>::peak() const noexcept {
+        return this->peak_count;
+    }
+
+    template <typename Type>
+    std::size_t SegmentedQueue<Type>::bytes_retained() const noexcept {
+        return this->segments * sizeof(Segment);
+    }
+
+    template <typename Type>
+    typename SegmentedQueue<Type>::Segment* SegmentedQueue<Type>::acquire() {
+        if (this->spare) {
+            return std::exchange(this->spare, nullptr);
+        }
+        auto segment = new Segment{};
+        ++this->segments;
+        return segment;
+    }
+
+    template <typename Type>
+    void SegmentedQueue<Type>::release(Segment* segment) noexcept {
+        if (!this->spare) {
+            segment->next = nullptr;
+            this->spare = segment;
+        } else {
+            delete segment;
+            --this->segments;
+        }
+    }
+
+    template <typename Type>
+    void* SegmentedQueue<Type>::back() {
+        if (!this->tail) {
+            this->head = this->tail = this->acquire();
+        } else if (this->tail_index == segment_length) {
+            this->tail->next = this->acquire();
+            this->tail = this->tail->next;
+            this->tail_index = 0;
+        }
+        return &this->tail->slots[this->tail_index];
+    }
+
+    template <typename Type>
+    void SegmentedQueue<Type>::pushed() noexcept {
+        ++this->tail_index;
+        ++this->count;
+        this->peak_count = std::max(this->peak_count, this->count);
+    }
+
+    template <typename Type>
+    template <typename... Args>
+    void SegmentedQueue<Type>::emplace(Args&&... args) {
+        new (this->back()) Element(std::in_place, std::forward<Args>(args)...);
+        this->pushed();
+    }
+
+    template <typename Type>
+    void SegmentedQueue<Type>::set_exception(std::exception_ptr exception) {
+        new (this->back()) Element(std::move(exception));
+        this->pushed();
+    }
+
+    template <typename Type>
+    sharp::Try<Type> SegmentedQueue<Type>::pop() {
+        assert(!this->empty());
+
+        // a segment can only have been linked in after the head segment
+        // filled up, so if the head is used up the next value is in the
+        // segment after it
+        if (this->head_index == segment_length) {
+            auto used = this->head;
+            this->head = this->head->next;
+            this->head_index = 0;
+            this->release(used);
+        }
+
+        auto& element = *reinterpret_cast<Element*>(
+                &this->head->slots[this->head_index]);
+        auto deferred = sharp::defer([&]() {
+            element.~Element();
+            ++this->head_index;
+            --this->count;
+
+            // once the queue is empty start over at the beginning of the
+            // segment, so a queue that never holds more than a segment's
+            // worth of values never links in another one
+            if (!this->count && this->head == this->tail) {
+                this->head_index = this->tail_index = 0;
+            }
+        });
+        return std::move(element);
+    }
+
+} // namespace channel_detail
+} // namespace sharp
@@ -0,0 +1,135 @@
+/**
+ * @file SpscChannel.hpp
+ * @author Aaryaman Sagar
+ *
+ * The implementation backing sharp::Channel with the Spsc policy, this is a
+ * Lamport ring buffer for exactly one sender thread and one reader thread
+ */
+
+#pragma once
+
+#include <sharp/Channel/detail/Channel-pre.hpp>
+#include <sharp/Channel/detail/RingChannel.hpp>
+#include <sharp/Portability/cpp17.hpp>
+#include <sharp/Try/Try.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class SpscChannel
+     *
+     * The sender owns the tail index and the reader owns the head index,
+     * each only ever writes its own index and reads the other's.  So a send
+     * or a read is a plain store with release ordering to publish the slot
+     * and at most one load with acquire ordering of the other side's index,
+     * there are no read-modify-write operations on the hot path
+     *
+     * Each side also keeps a cached copy of the other side's index, and only
+     * loads the real one when the cached copy says that the ring is full (or
+     * empty).  So in the steady state the sender and reader do not touch
+     * each other's cache lines at all except for the slots themselves
+     *
+     * The ring has one more slot than the buffer length so that a full ring
+     * can be told apart from an empty one without a counter
+     *
+     * Blocking is done by RingChannel, when the ring is neither full nor
+     * empty the only extra cost of a send or a read is one fence and one load
+     * to check whether anyone is sleeping on the other end.  A send pays one
+     * more fence to announce itself to close(), see RingChannel::push()
+     *
+     * Using this from more than one sender or more than one reader thread at
+     * a time is undefined behavior
+     */
+    template <typename Type, typename Mutex, typename Cv>
+    class SpscChannel : public RingChannel<SpscChannel<Type, Mutex, Cv>,
+                                           Type, Mutex, Cv> {
+    public:
+
+        /**
+         * Allocates all the slots up front, throws std::invalid_argument if
+         * the buffer length is not at least 1
+         */
+        explicit SpscChannel(int buffer_length);
+        ~SpscChannel();
+
+        /**
+         * The rest of the channel interface is implemented in terms of the
+         * ring operations below
+         */
+        template <typename, typename, typename, typename>
+        friend class RingChannel;
+
+        /**
+         * See RingChannel
+         */
+        static constexpr bool single_sender = true;
+
+    private:
+
+        /**
+         * Storage for one element in the ring
+         */
+        using Storage = std::aligned_storage_t<sizeof(sharp::Try<Type>),
+                                               alignof(sharp::Try<Type>)>;
+
+        /**
+         * The object passed to enqueue functions, constructs the value
+         * directly in the slot at the tail
+         */
+        class Slot;
+
+        /**
+         * Non blocking push and pop on the ring, see RingChannel.  If the
+         * enqueue function throws then the tail is not moved, so the ring is
+         * left as it was
+         */
+        template <typename EnqueueFunc>
+        bool try_push(EnqueueFunc& enqueue);
+        sharp::Try<Type> try_pop(bool& popped, bool* stopped = nullptr);
+
+        /**
+         * Snapshots of whether the ring is full or empty, used as predicates
+         * for sleeping
+         */
+        bool is_full() const;
+        bool is_empty() const;
+
+        /**
+         * The index that comes after the given one in the ring
+         */
+        std::size_t next(std::size_t index) const;
+
+        /**
+         * The number of slots in the ring and the slots themselves
+         */
+        const std::size_t size;
+        std::unique_ptr<Storage[]> slots;
+
+        /**
+         * The reader's side, the index of the next slot to read and the last
+         * tail index the reader saw
+         */
+        char padding_one[hardware_destructive_interference_size];
+        std::atomic<std::size_t> head{0};
+        std::size_t cached_tail{0};
+
+        /**
+         * The sender's side, the index of the next slot to write and the last
+         * head index the sender saw
+         */
+        char padding_two[hardware_destructive_interference_size];
+        std::atomic<std::size_t> tail{0};
+        std::size_t cached_head{0};
+        char padding_three[hardware_destructive_interference_size];
+    };
+
+} // namespace channel_detail
+} // namespace sharp
+
+#include <sharp/Channel/detail/SpscChannel.ipp>
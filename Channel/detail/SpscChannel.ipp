@@ -0,0 +1,123 @@
+#pragma once
+
+#include <sharp/Channel/detail/SpscChannel.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace sharp {
+namespace channel_detail {
+
+    template <typename Type, typename Mutex, typename Cv>
+    class SpscChannel<Type, Mutex, Cv>::Slot {
+    public:
+        explicit Slot(void* storage_in) : storage{storage_in} {}
+
+        template <typename... Args>
+        void emplace(Args&&... args) {
+            new (this->storage) sharp::Try<Type>(std::in_place,
+                                                 std::forward<Args>(args)...);
+        }
+        void set_exception(std::exception_ptr exception) {
+            new (this->storage) sharp::Try<Type>(std::move(exception));
+        }
+
+    private:
+        void* storage;
+    };
+
+    template <typename Type, typename Mutex, typename Cv>
+    SpscChannel<Type, Mutex, Cv>::SpscChannel(int buffer_length)
+            : size{static_cast<std::size_t>(buffer_length) + 1} {
+        if (buffer_length < 1) {
+            throw std::invalid_argument{"sharp::Channel: the Spsc policy "
+                                        "requires a buffer of at least 1"};
+        }
+        this->slots.reset(new Storage[this->size]);
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    SpscChannel<Type, Mutex, Cv>::~SpscChannel() {
+        // destroy whatever is left in the ring
+        auto popped = true;
+        while (popped) {
+            this->try_pop(popped);
+        }
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    std::size_t SpscChannel<Type, Mutex, Cv>::next(std::size_t index) const {
+        // a branch is cheaper than the division for a modulo
+        ++index;
+        return (index == this->size) ? 0 : index;
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    template <typename EnqueueFunc>
+    bool SpscChannel<Type, Mutex, Cv>::try_push(EnqueueFunc& enqueue) {
+        // only the sender writes the tail, so this can be relaxed
+        auto position = this->tail.load(std::memory_order_relaxed);
+        auto next_position = this->next(position);
+
+        // go to the reader's cache line only if the ring looks full, the
+        // head only ever moves forward so a stale cached copy can only make
+        // the ring look fuller than it is
+        if (next_position == this->cached_head) {
+            this->cached_head = this->head.load(std::memory_order_acquire);
+            if (next_position == this->cached_head) {
+                return false;
+            }
+        }
+
+        auto slot = Slot{&this->slots[position]};
+        enqueue(slot);
+        this->tail.store(next_position, std::memory_order_release);
+        return true;
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    sharp::Try<Type> SpscChannel<Type, Mutex, Cv>::try_pop(bool& popped,
+                                                           bool* stopped) {
+        auto position = this->head.load(std::memory_order_relaxed);
+        popped = false;
+
+        if (position == this->cached_tail) {
+            this->cached_tail = this->tail.load(std::memory_order_acquire);
+            if (position == this->cached_tail) {
+                return nullptr;
+            }
+        }
+
+        // move the value out and then give the slot back to the sender, this
+        // is the only reader so an exception can be left in the slot
+        using TryType = sharp::Try<Type>;
+        auto& element = *reinterpret_cast<TryType*>(&this->slots[position]);
+        if (stopped && element.has_exception()) {
+            *stopped = true;
+            return nullptr;
+        }
+        auto deferred = sharp::defer([&]() {
+            element.~TryType();
+            this->head.store(this->next(position), std::memory_order_release);
+        });
+        popped = true;
+        return std::move(element);
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    bool SpscChannel<Type, Mutex, Cv>::is_full() const {
+        return this->next(this->tail.load()) == this->head.load();
+    }
+
+    template <typename Type, typename Mutex, typename Cv>
+    bool SpscChannel<Type, Mutex, Cv>::is_empty() const {
+        return this->head.load() == this->tail.load();
+    }
+
+} // namespace channel_detail
+} // namespace sharp
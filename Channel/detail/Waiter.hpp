@@ -0,0 +1,235 @@
+/**
+ * @file Waiter.hpp
+ * @author Aaryaman Sagar
+ *
+ * The objects that are notified when a channel changes in a way that might
+ * let a blocked operation through.  A select registers one waiter with every
+ * channel in its cases, and a coroutine waiting on a channel registers one
+ * with that channel, the channels poke every registered waiter whenever they
+ * change
+ */
+
+#pragma once
+
+#include <sharp/Portability/cpp17.hpp>
+#include <sharp/TransparentList/TransparentList.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+
+namespace sharp {
+namespace channel_detail {
+
+    /**
+     * @class Waiter
+     *
+     * The interface channels see, notify() is called with the channel's
+     * internal lock held so it must not call back into the channel.  A
+     * waiter that needs to do more than that can pass itself to
+     * UnlockedNotifications::defer(), notify_unlocked() is then called once
+     * the channel has released its lock
+     */
+    class Waiter {
+    public:
+        virtual ~Waiter() {}
+        virtual void notify() = 0;
+        virtual void notify_unlocked() {}
+
+    private:
+        friend class UnlockedNotifications;
+        Waiter* next_unlocked{nullptr};
+    };
+
+    /**
+     * @class UnlockedNotifications
+     *
+     * The waiters that deferred work till the channel's lock is released, in
+     * a per thread list.  Channels construct one of these before taking
+     * their lock in every operation that notifies waiters, and the outermost
+     * one on the thread runs the deferred work when it is destroyed, which
+     * is after the lock has been released.  So a waiter can hand itself to
+     * an executor that runs closures inline without that closure finding the
+     * channel locked
+     *
+     * An operation that notifies and then blocks must let go of the lock
+     * and destroy its UnlockedNotifications before going to sleep, otherwise
+     * the waiters it deferred would not be run till it wakes up
+     *
+     * If the deferred work throws, the rest of it still runs and the first
+     * exception is rethrown, unless the destructor is being run because of
+     * another exception
+     */
+    class UnlockedNotifications {
+    public:
+        UnlockedNotifications() : exceptions{sharp::uncaught_exceptions()} {
+            ++list().depth;
+        }
+        ~UnlockedNotifications() noexcept(false) {
+            auto& deferred = list();
+            if (--deferred.depth) {
+                return;
+            }
+
+            auto exception = std::exception_ptr{};
+            while (deferred.head) {
+                auto waiter = deferred.head;
+                deferred.head = waiter->next_unlocked;
+                if (!deferred.head) {
+                    deferred.tail = nullptr;
+                }
+                waiter->next_unlocked = nullptr;
+
+                // once the waiter has been notified it might be deferred on
+                // another thread, so it is off the list before this
+                try {
+                    waiter->notify_unlocked();
+                } catch (...) {
+                    if (!exception) {
+                        exception = std::current_exception();
+                    }
+                }
+            }
+
+            if (exception && sharp::uncaught_exceptions() == this->exceptions) {
+                std::rethrow_exception(exception);
+            }
+        }
+
+        UnlockedNotifications(const UnlockedNotifications&) = delete;
+        UnlockedNotifications& operator=(const UnlockedNotifications&)
+            = delete;
+
+        /**
+         * Call notify_unlocked() on the waiter once the lock has been
+         * released, this must be called from notify()
+         */
+        static void defer(Waiter* waiter) {
+            auto& deferred = list();
+            if (deferred.tail) {
+                deferred.tail->next_unlocked = waiter;
+            } else {
+                deferred.head = waiter;
+            }
+            deferred.tail = waiter;
+        }
+
+    private:
+        struct List {
+            int depth{0};
+            Waiter* head{nullptr};
+            Waiter* tail{nullptr};
+        };
+        static List& list() {
+            static thread_local List deferred;
+            return deferred;
+        }
+
+        const int exceptions;
+    };
+
+    /**
+     * @class BlockingWaiter
+     *
+     * The waiter a thread in select() sleeps on.  This is a one bit event,
+     * notify() sets it and wakes up the thread sleeping in wait(), reset()
+     * clears it.  The selecting thread clears the event
+     * before checking its cases, so a notification that comes in anytime
+     * after that is not lost
+     *
+     * Channels can have arbitrary mutex and condition variable types, and a
+     * single select can span channels with different types, so the waiter
+     * always uses the standard ones
+     */
+    class BlockingWaiter : public Waiter {
+    public:
+
+        /**
+         * Set the event and wake the waiting thread up.  The condition
+         * variable is signalled with the mutex held so that the waiting
+         * thread cannot return and destroy the waiter before this is done
+         * with it
+         */
+        void notify() override {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            this->notified = true;
+            this->cv.notify_one();
+        }
+
+        /**
+         * Clear the event
+         */
+        void reset() {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            this->notified = false;
+        }
+
+        /**
+         * Block until the event is set
+         */
+        void wait() {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            while (!this->notified) {
+                this->cv.wait(lck);
+            }
+        }
+
+    private:
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool notified{false};
+    };
+
+    /**
+     * Channels keep track of the waiters registered with them in an
+     * intrusive list, the nodes for which live on the stack of the thread in
+     * select() or in the frame of the waiting coroutine, so registering does
+     * not allocate
+     */
+    using WaiterNode = sharp::TransparentNode<Waiter*>;
+    using WaiterList = sharp::TransparentList<Waiter*>;
+
+    /**
+     * Notify every waiter in the list, this is for changes that every waiter
+     * has to see, like the channel being closed.  This and the overload
+     * below must be called with whatever protects the list held and with an
+     * UnlockedNotifications alive on the thread
+     */
+    inline void notify_waiters(WaiterList& waiters) {
+        for (auto node : waiters) {
+            node->datum->notify();
+        }
+    }
+
+    /**
+     * Notify up to n waiters from the front of the list, for a change that
+     * lets n operations through.  The waiters notified are moved to the
+     * back of the list so the next change goes to the ones that have been
+     * waiting the longest
+     */
+    inline void notify_waiters(WaiterList& waiters, std::size_t n) {
+        WaiterList notified;
+        for (auto iter = waiters.begin(); n && iter != waiters.end(); --n) {
+            auto node = *iter;
+            iter = waiters.erase(iter);
+            notified.push_back(node);
+            node->datum->notify();
+        }
+        for (auto iter = notified.begin(); iter != notified.end();) {
+            auto node = *iter;
+            iter = notified.erase(iter);
+            waiters.push_back(node);
+        }
+    }
+
+    /**
+     * Whether a select case wants to read from a channel or send to it
+     */
+    enum class SelectOperation {
+        READ,
+        SEND,
+    };
+
+} // namespace channel_detail
+} // namespace sharp
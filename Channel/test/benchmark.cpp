@@ -0,0 +1,425 @@
+/**
+ * @file benchmark.cpp
+ * @author Aaryaman Sagar
+ *
+ * Throughput and latency benchmarks for sharp::Channel, run with
+ *
+ *      buck run //Channel/test:benchmark -- --messages=100000
+ *
+ * Every configuration sends a fixed number of messages from the producers to
+ * the consumers.  Each message carries the time it was sent at, and the
+ * consumer that reads it records how long it took to get there.  The results
+ * are printed to stdout as one JSON object so that runs on different commits
+ * can be compared by a script
+ *
+ * A configuration can be picked out with --filter=<substring>, which is
+ * matched against the name of the configuration, for example
+ *
+ *      buck run //Channel/test:benchmark -- --filter=mpsc/locked/64/
+ */
+
+#include <sharp/Channel/Channel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/**
+ * The options read from the command line
+ */
+struct Options {
+    int messages{100000};
+    std::string filter;
+};
+
+/**
+ * The message sent through the channel, the first 8 bytes are the time it
+ * was sent at and the rest is padding to make it the right size
+ */
+template <std::size_t Bytes>
+struct Message {
+    std::int64_t sent;
+    std::array<char, Bytes - sizeof(std::int64_t)> payload;
+};
+
+std::int64_t now() {
+    using namespace std::chrono;
+    auto since_epoch = steady_clock::now().time_since_epoch();
+    return duration_cast<nanoseconds>(since_epoch).count();
+}
+
+template <std::size_t Bytes>
+Message<Bytes> make_message() {
+    auto message = Message<Bytes>{};
+    message.sent = now();
+    return message;
+}
+
+/**
+ * The results of one configuration
+ */
+struct Result {
+    std::string name;
+    std::string scenario;
+    std::string policy;
+    int buffer;
+    std::size_t message_bytes;
+    int producers;
+    int consumers;
+    std::string read_path;
+    int messages;
+    double seconds;
+    std::vector<std::int64_t> latencies;
+};
+
+std::int64_t percentile(std::vector<std::int64_t>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto index = static_cast<std::size_t>(fraction * (sorted.size() - 1));
+    return sorted[index];
+}
+
+void print_json(std::vector<Result>& results) {
+    std::cout << "{\n  \"benchmarks\": [";
+    auto first = true;
+    for (auto& result : results) {
+        std::sort(result.latencies.begin(), result.latencies.end());
+        auto throughput = result.messages / result.seconds;
+
+        std::cout << (first ? "\n" : ",\n");
+        first = false;
+        std::cout << "    {"
+            << "\"name\": \"" << result.name << "\", "
+            << "\"scenario\": \"" << result.scenario << "\", "
+            << "\"policy\": \"" << result.policy << "\", "
+            << "\"buffer\": " << result.buffer << ", "
+            << "\"message_bytes\": " << result.message_bytes << ", "
+            << "\"producers\": " << result.producers << ", "
+            << "\"consumers\": " << result.consumers << ", "
+            << "\"read_path\": \"" << result.read_path << "\", "
+            << "\"messages\": " << result.messages << ", "
+            << "\"seconds\": " << std::fixed << std::setprecision(6)
+                << result.seconds << ", "
+            << "\"messages_per_second\": " << std::setprecision(1)
+                << throughput << ", "
+            << "\"latency_ns\": {"
+                << "\"p50\": " << percentile(result.latencies, 0.50) << ", "
+                << "\"p99\": " << percentile(result.latencies, 0.99) << ", "
+                << "\"p999\": " << percentile(result.latencies, 0.999)
+            << "}}";
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+}
+
+/**
+ * The different ways of reading from a channel, each of these reads till
+ * the channel is closed and records the latency of every message read
+ */
+template <typename ChannelType>
+void consume_read(ChannelType& channel, std::vector<std::int64_t>& latencies) {
+    try {
+        while (true) {
+            auto message = channel.read();
+            latencies.push_back(now() - message.sent);
+        }
+    } catch (sharp::ChannelClosedError&) {}
+}
+
+template <typename ChannelType>
+void consume_read_try(ChannelType& channel,
+                      std::vector<std::int64_t>& latencies) {
+    while (true) {
+        auto message = channel.read_try();
+        if (message.has_exception()) {
+            return;
+        }
+        latencies.push_back(now() - message.value().sent);
+    }
+}
+
+template <typename ChannelType>
+void consume_iterator(ChannelType& channel,
+                      std::vector<std::int64_t>& latencies) {
+    for (auto& message : channel) {
+        latencies.push_back(now() - message.sent);
+    }
+}
+
+/**
+ * Runs producers sending messages into one channel and consumers reading
+ * them out with the given read path
+ */
+template <std::size_t Bytes, typename ChannelType, typename ConsumeFunc>
+double run_channel(ChannelType& channel, int messages, int producers,
+                   int consumers, ConsumeFunc consume,
+                   std::vector<std::int64_t>& latencies) {
+    auto per_consumer = std::vector<std::vector<std::int64_t>>(consumers);
+    for (auto& consumer : per_consumer) {
+        consumer.reserve(messages);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i < consumers; ++i) {
+        threads.emplace_back([&, i]() { consume(channel, per_consumer[i]); });
+    }
+
+    // split the messages between the producers, the last one picks up the
+    // remainder
+    auto senders = std::vector<std::thread>{};
+    for (auto i = 0; i < producers; ++i) {
+        auto count = messages / producers;
+        if (i == producers - 1) {
+            count += messages % producers;
+        }
+        senders.emplace_back([&channel, count]() {
+            for (auto j = 0; j < count; ++j) {
+                channel.send(make_message<Bytes>());
+            }
+        });
+    }
+
+    for (auto& sender : senders) {
+        sender.join();
+    }
+    channel.close();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto& consumer : per_consumer) {
+        latencies.insert(latencies.end(), consumer.begin(), consumer.end());
+    }
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * Runs one producer per channel with a single consumer reading from all of
+ * them with a select
+ */
+template <std::size_t Bytes, typename ChannelType>
+double run_select(ChannelType& one, ChannelType& two, int messages,
+                  std::vector<std::int64_t>& latencies) {
+    latencies.reserve(messages);
+    auto start = std::chrono::steady_clock::now();
+
+    auto send = [](auto& channel, auto count) {
+        for (auto i = 0; i < count; ++i) {
+            channel.send(make_message<Bytes>());
+        }
+    };
+    auto th_one = std::thread{[&]() { send(one, messages / 2); }};
+    auto th_two = std::thread{[&]() {
+        send(two, messages - messages / 2);
+    }};
+
+    auto record = [&](auto message) {
+        latencies.push_back(now() - message.sent);
+    };
+    for (auto i = 0; i < messages; ++i) {
+        sharp::select(std::make_pair(std::ref(one), record),
+                      std::make_pair(std::ref(two), record));
+    }
+
+    th_one.join();
+    th_two.join();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * Names for the policies, used in the output
+ */
+template <typename Policy>
+struct PolicyName;
+template <>
+struct PolicyName<sharp::channel_policy::Locked> {
+    static constexpr auto value = "locked";
+};
+template <>
+struct PolicyName<sharp::channel_policy::Mpmc> {
+    static constexpr auto value = "mpmc";
+};
+template <>
+struct PolicyName<sharp::channel_policy::Spsc> {
+    static constexpr auto value = "spsc";
+};
+
+template <typename Policy, std::size_t Bytes>
+using ChannelFor = sharp::Channel<Message<Bytes>, std::mutex,
+                                  std::condition_variable, Policy>;
+
+/**
+ * The ring buffer policies do not support unbuffered channels, and the Spsc
+ * policy only supports one producer and one consumer
+ */
+template <typename Policy>
+bool supports(int buffer, int producers, int consumers) {
+    if (!std::is_same<Policy, sharp::channel_policy::Locked>{} && !buffer) {
+        return false;
+    }
+    if (std::is_same<Policy, sharp::channel_policy::Spsc>{}) {
+        return producers == 1 && consumers == 1;
+    }
+    return true;
+}
+
+class Benchmarks {
+public:
+    explicit Benchmarks(Options options_in) : options{options_in} {}
+
+    /**
+     * Runs every combination of buffer size and read path for the scenario
+     * with the given policy and message size
+     */
+    template <typename Policy, std::size_t Bytes>
+    void scenario(const std::string& scenario, int producers, int consumers) {
+        for (auto buffer : {0, 1, 64, 4096}) {
+            if (!supports<Policy>(buffer, producers, consumers)) {
+                continue;
+            }
+
+            using Channel = ChannelFor<Policy, Bytes>;
+            this->run<Policy, Bytes>(scenario, buffer, producers, consumers,
+                    "read", [&](auto& latencies) {
+                Channel channel{buffer};
+                return run_channel<Bytes>(
+                        channel, this->options.messages, producers,
+                        consumers, [](auto& c, auto& l) { consume_read(c, l); },
+                        latencies);
+            });
+            this->run<Policy, Bytes>(scenario, buffer, producers, consumers,
+                    "read_try", [&](auto& latencies) {
+                Channel channel{buffer};
+                return run_channel<Bytes>(
+                        channel, this->options.messages, producers,
+                        consumers,
+                        [](auto& c, auto& l) { consume_read_try(c, l); },
+                        latencies);
+            });
+            this->run<Policy, Bytes>(scenario, buffer, producers, consumers,
+                    "iterator", [&](auto& latencies) {
+                Channel channel{buffer};
+                return run_channel<Bytes>(
+                        channel, this->options.messages, producers,
+                        consumers,
+                        [](auto& c, auto& l) { consume_iterator(c, l); },
+                        latencies);
+            });
+        }
+    }
+
+    /**
+     * Two producers on two channels and one consumer selecting on both
+     */
+    template <typename Policy, std::size_t Bytes>
+    void select() {
+        for (auto buffer : {0, 1, 64, 4096}) {
+            if (!supports<Policy>(buffer, 1, 1)) {
+                continue;
+            }
+
+            this->run<Policy, Bytes>("select", buffer, 2, 1, "select",
+                                     [&](auto& latencies) {
+                ChannelFor<Policy, Bytes> one{buffer};
+                ChannelFor<Policy, Bytes> two{buffer};
+                return run_select<Bytes>(one, two, this->options.messages,
+                                         latencies);
+            });
+        }
+    }
+
+    void print() {
+        print_json(this->results);
+    }
+
+private:
+    template <typename Policy, std::size_t Bytes, typename Func>
+    void run(const std::string& scenario, int buffer, int producers,
+             int consumers, const std::string& read_path, Func func) {
+        auto name = std::ostringstream{};
+        name << scenario << "/" << PolicyName<Policy>::value << "/" << buffer
+             << "/" << Bytes << "/" << read_path;
+        if (name.str().find(this->options.filter) == std::string::npos) {
+            return;
+        }
+
+        auto result = Result{};
+        result.name = name.str();
+        result.scenario = scenario;
+        result.policy = PolicyName<Policy>::value;
+        result.buffer = buffer;
+        result.message_bytes = Bytes;
+        result.producers = producers;
+        result.consumers = consumers;
+        result.read_path = read_path;
+        result.messages = this->options.messages;
+        result.seconds = func(result.latencies);
+        this->results.push_back(std::move(result));
+    }
+
+    Options options;
+    std::vector<Result> results;
+};
+
+template <typename Policy, std::size_t Bytes>
+void run_all(Benchmarks& benchmarks) {
+    benchmarks.scenario<Policy, Bytes>("spsc", 1, 1);
+    benchmarks.scenario<Policy, Bytes>("mpsc", 4, 1);
+    benchmarks.scenario<Policy, Bytes>("mpmc", 4, 4);
+    benchmarks.select<Policy, Bytes>();
+}
+
+template <typename Policy>
+void run_all_sizes(Benchmarks& benchmarks) {
+    run_all<Policy, 8>(benchmarks);
+    run_all<Policy, 64>(benchmarks);
+    run_all<Policy, 1024>(benchmarks);
+}
+
+Options parse_options(int argc, char** argv) {
+    auto options = Options{};
+    for (auto i = 1; i < argc; ++i) {
+        auto argument = std::string{argv[i]};
+        auto messages = std::string{"--messages="};
+        auto filter = std::string{"--filter="};
+        if (argument.compare(0, messages.size(), messages) == 0) {
+            options.messages = std::atoi(argument.c_str() + messages.size());
+        } else if (argument.compare(0, filter.size(), filter) == 0) {
+            options.filter = argument.substr(filter.size());
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--messages=<count>] [--filter=<substring>]"
+                      << std::endl;
+            std::exit(1);
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    auto benchmarks = Benchmarks{parse_options(argc, argv)};
+    run_all_sizes<sharp::channel_policy::Locked>(benchmarks);
+    run_all_sizes<sharp::channel_policy::Mpmc>(benchmarks);
+    run_all_sizes<sharp::channel_policy::Spsc>(benchmarks);
+    benchmarks.print();
+}
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <sharp/Channel/Channel.hpp>
+#include <sharp/Channel/BroadcastChannel.hpp>
+#include <sharp/Executor/InlineExecutor.hpp>
 
 #include <gtest/gtest.h>
 
@@ -7,6 +9,17 @@
 #include <vector>
 #include <random>
 #include <iostream>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <iterator>
+#include <string>
 
 constexpr auto number_iterations = 1e3;
 
@@ -89,39 +102,39 @@ TEST(Channel, UnbufferedThreadedSend) {
     th_two.join();
 }
 
-// TEST(Channel, SelectBasicRead) {
-    // sharp::Channel<int> c{1};
-    // c.send(1);
-    // int val = 0;
-    // sharp::select(
-        // std::make_pair(std::ref(c), [&val](auto value) {
-            // ++val;
-            // EXPECT_EQ(value, 1);
-        // }),
-        // std::make_pair(std::ref(c), []() -> int {
-            // EXPECT_TRUE(false);
-            // return 0;
-        // })
-    // );
-    // EXPECT_EQ(val, 1);
-// }
-
-// TEST(Channel, SelectBasicWrite) {
-    // sharp::Channel<int> c{1};
-    // int val = 0;
-    // sharp::select(
-        // std::make_pair(std::ref(c), [](auto) {
-            // EXPECT_TRUE(false);
-        // }),
-        // std::make_pair(std::ref(c), [&val]() -> int {
-            // ++val;
-            // return 2;
-        // })
-    // );
-    // auto value = c.try_read();
-    // EXPECT_TRUE(value);
-    // EXPECT_EQ(value.value(), 2);
-// }
+TEST(Channel, SelectBasicRead) {
+    sharp::Channel<int> c{1};
+    c.send(1);
+    int val = 0;
+    sharp::select(
+        std::make_pair(std::ref(c), [&val](auto value) {
+            ++val;
+            EXPECT_EQ(value, 1);
+        }),
+        std::make_pair(std::ref(c), []() -> int {
+            EXPECT_TRUE(false);
+            return 0;
+        })
+    );
+    EXPECT_EQ(val, 1);
+}
+
+TEST(Channel, SelectBasicWrite) {
+    sharp::Channel<int> c{1};
+    int val = 0;
+    sharp::select(
+        std::make_pair(std::ref(c), [](auto) {
+            EXPECT_TRUE(false);
+        }),
+        std::make_pair(std::ref(c), [&val]() -> int {
+            ++val;
+            return 2;
+        })
+    );
+    auto value = c.try_read();
+    EXPECT_TRUE(value);
+    EXPECT_EQ(value.value(), 2);
+}
 
 template <typename InputIt>
 void sum(InputIt begin, InputIt end, sharp::Channel<int>& c) {
@@ -145,73 +158,1194 @@ TEST(Channel, ExampleOneTest) {
 }
 
 
-// void fibonacci(sharp::Channel<int>& c, sharp::Channel<int>& quit) {
-    // auto x = 0, y = 1;
+void fibonacci(sharp::Channel<int>& c, sharp::Channel<int>& quit) {
+    auto x = 0, y = 1;
 
-    // auto should_continue = true;
-    // while (should_continue) {
+    auto should_continue = true;
+    while (should_continue) {
 
-        // sharp::select(
-            // std::make_pair(std::ref(c), [&] () -> int {
+        sharp::select(
+            std::make_pair(std::ref(c), [&] () -> int {
 
-                // auto to_send = x, new_y = x + y;
-                // x = y;
-                // y = new_y;
+                auto to_send = x, new_y = x + y;
+                x = y;
+                y = new_y;
 
-                // return to_send;
-            // }),
+                return to_send;
+            }),
+
+            std::make_pair(std::ref(quit), [&](auto) {
+                should_continue = false;
+            })
+        );
+    }
+}
 
-            // std::make_pair(std::ref(quit), [&](auto) {
-                // should_continue = false;
-            // })
-        // );
-    // }
-// }
+TEST(Channel, ExampleTwoTest) {
+
+    for (auto i = 0; i < number_iterations; ++i) {
+        sharp::Channel<int> c;
+        sharp::Channel<int> quit;
+        auto results = std::vector<int>{0, 1, 1, 2, 3, 5, 8, 13, 21, 34};
+
+        auto th = std::thread{[&]() {
+            for (auto i = 0; i < 10; ++i) {
+                auto val = c.read();
+                EXPECT_EQ(val, results[i]);
+            }
+            quit.send(0);
+        }};
+
+        fibonacci(c, quit);
+        th.join();
+    }
+}
 
-// TEST(Channel, ExampleTwoTest) {
+void fibonacci_range(sharp::Channel<int>& c) {
+    auto x = 0, y = 1;
 
-    // for (auto i = 0; i < number_iterations; ++i) {
-        // sharp::Channel<int> c;
-        // sharp::Channel<int> quit;
-        // auto results = std::vector<int>{0, 1, 1, 2, 3, 5, 8, 13, 21, 34};
+    for (auto i = 0; i < 10; ++i) {
 
-        // auto th = std::thread{[&]() {
-            // for (auto i = 0; i < 10; ++i) {
-                // auto val = c.read();
-                // EXPECT_EQ(val, results[i]);
-            // }
-            // quit.send(0);
-        // }};
+        auto to_send = x, new_y = x + y;
+        x = y;
+        y = new_y;
 
-        // fibonacci(c, quit);
-        // th.join();
-    // }
-// }
+        c.send(to_send);
+    }
 
-// void fibonacci_range(sharp::Channel<int>& c) {
-    // auto x = 0, y = 1;
+    c.close();
+}
 
-    // for (auto i = 0; i < 10; ++i) {
+TEST(Channel, RangeTest) {
+    sharp::Channel<int> c;
+    auto th = std::thread{[&]() {
+        fibonacci_range(c);
+    }};
+    auto results = std::vector<int>{0, 1, 1, 2, 3, 5, 8, 13, 21, 34};
 
-        // auto to_send = x, new_y = x + y;
-        // x = y;
-        // y = new_y;
+    auto counter = 0;
+    for (auto val : c) {
+        EXPECT_EQ(val, results[counter++]);
+    }
+    EXPECT_EQ(counter, 10);
+    th.join();
+}
 
-        // c.send(to_send);
-    // }
+TEST(Channel, ReadAfterClose) {
+    sharp::Channel<int> c{2};
+    c.send(1);
+    c.close();
+    EXPECT_TRUE(c.is_closed());
+    EXPECT_EQ(c.read(), 1);
+    EXPECT_THROW(c.read(), sharp::ChannelClosedError);
+    EXPECT_THROW(c.send(2), sharp::ChannelClosedError);
+}
 
-    // c.close();
-// }
+TEST(Channel, TryReadFreesSlot) {
+    sharp::Channel<int> c{1};
+    c.send(1);
+    EXPECT_FALSE(c.try_send(2));
+    EXPECT_EQ(c.try_read().value(), 1);
+    EXPECT_TRUE(c.try_send(2));
+    EXPECT_EQ(c.read(), 2);
+}
+
+template <typename Type>
+using MpmcChannel = sharp::Channel<Type, std::mutex, std::condition_variable,
+                                   sharp::channel_policy::Mpmc>;
+
+TEST(Channel, MpmcBasic) {
+    MpmcChannel<int> c{2};
+    EXPECT_FALSE(c.try_read());
+    c.send(1);
+    EXPECT_TRUE(c.try_send(2));
+    EXPECT_FALSE(c.try_send(3));
+    EXPECT_EQ(c.read(), 1);
+    EXPECT_EQ(c.try_read().value(), 2);
+    EXPECT_FALSE(c.try_read());
+}
+
+TEST(Channel, MpmcZeroBuffer) {
+    EXPECT_THROW(MpmcChannel<int>{0}, std::invalid_argument);
+}
+
+TEST(Channel, MpmcTrySendDoesNotMoveOnFailure) {
+    MpmcChannel<std::unique_ptr<int>> c{1};
+    c.send(std::make_unique<int>(1));
+    auto pointer = std::make_unique<int>(2);
+    EXPECT_FALSE(c.try_send(std::move(pointer)));
+    EXPECT_TRUE(pointer);
+    EXPECT_EQ(*c.read(), 1);
+    EXPECT_TRUE(c.try_send(std::move(pointer)));
+    EXPECT_FALSE(pointer);
+    EXPECT_EQ(*c.read(), 2);
+}
+
+TEST(Channel, MpmcRange) {
+    MpmcChannel<int> c{1};
+    auto th = std::thread{[&]() {
+        for (auto i = 0; i < number_iterations; ++i) {
+            c.send(i);
+        }
+        c.close();
+    }};
+
+    auto counter = 0;
+    for (auto val : c) {
+        EXPECT_EQ(val, counter++);
+    }
+    EXPECT_EQ(counter, number_iterations);
+    th.join();
+}
+
+TEST(Channel, MpmcManyProducersManyConsumers) {
+    MpmcChannel<int> c{8};
+    auto producers = std::vector<std::thread>{};
+    auto consumers = std::vector<std::thread>{};
+    auto sums = std::vector<long>(4);
+
+    for (auto i = 0; i < 4; ++i) {
+        producers.emplace_back([&]() {
+            for (auto j = 1; j <= number_iterations; ++j) {
+                c.send(j);
+            }
+        });
+    }
+    for (auto i = 0; i < 4; ++i) {
+        consumers.emplace_back([&, i]() {
+            for (auto value : c) {
+                sums[i] += value;
+            }
+        });
+    }
+
+    for (auto& th : producers) {
+        th.join();
+    }
+    c.close();
+    for (auto& th : consumers) {
+        th.join();
+    }
+
+    auto n = static_cast<long>(number_iterations);
+    EXPECT_EQ(std::accumulate(sums.begin(), sums.end(), 0l),
+              4 * (n * (n + 1) / 2));
+}
+
+TEST(Channel, SelectBlocksTillReady) {
+    sharp::Channel<int> one;
+    sharp::Channel<int> two;
+    auto th = std::thread{[&]() {
+        two.send(2);
+    }};
+
+    auto value = 0;
+    sharp::select(
+        std::make_pair(std::ref(one), [&](auto) {
+            EXPECT_TRUE(false);
+        }),
+        std::make_pair(std::ref(two), [&](auto v) {
+            value = v;
+        })
+    );
+    EXPECT_EQ(value, 2);
+    th.join();
+}
+
+TEST(Channel, SelectClosed) {
+    sharp::Channel<int> c;
+    c.close();
+    EXPECT_THROW(sharp::select(std::make_pair(std::ref(c), [](auto) {})),
+                 sharp::ChannelClosedError);
+    EXPECT_THROW(sharp::select(std::make_pair(std::ref(c), []() {
+        return 1;
+    })), sharp::ChannelClosedError);
+}
+
+TEST(Channel, SelectSendThrows) {
+    sharp::Channel<int> c{1};
+    EXPECT_THROW(sharp::select(std::make_pair(std::ref(c), []() -> int {
+        throw std::runtime_error{""};
+    })), std::runtime_error);
+
+    // the slot that was reserved for the failed send should be free again
+    EXPECT_TRUE(c.try_send(1));
+    EXPECT_EQ(c.read(), 1);
+}
+
+TEST(Channel, SelectMixedPolicies) {
+    for (auto i = 0; i < number_iterations; ++i) {
+        sharp::Channel<int> locked;
+        MpmcChannel<int> lock_free{1};
+        auto received = std::vector<int>{};
+
+        auto th = std::thread{[&]() {
+            locked.send(1);
+            lock_free.send(2);
+        }};
+
+        while (received.size() != 2) {
+            sharp::select(
+                std::make_pair(std::ref(locked), [&](auto v) {
+                    received.push_back(v);
+                }),
+                std::make_pair(std::ref(lock_free), [&](auto v) {
+                    received.push_back(v);
+                })
+            );
+        }
+        th.join();
+        std::sort(received.begin(), received.end());
+        EXPECT_EQ(received, (std::vector<int>{1, 2}));
+    }
+}
+
+TEST(Channel, SendManyReadMany) {
+    sharp::Channel<int> c{4};
+    auto values = std::vector<int>{1, 2, 3, 4};
+    c.send_many(values.begin(), values.end());
+
+    auto read = std::vector<int>{};
+    EXPECT_EQ(c.read_many(std::back_inserter(read), 3), 3);
+    EXPECT_EQ(read, (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(c.read_many(std::back_inserter(read), 3), 1);
+    EXPECT_EQ(read, (std::vector<int>{1, 2, 3, 4}));
+
+    // the batch freed up all the slots
+    EXPECT_TRUE(c.try_send(5));
+    c.close();
+    EXPECT_EQ(c.read_many(std::back_inserter(read), 3), 1);
+    EXPECT_EQ(c.read_many(std::back_inserter(read), 3), 0);
+}
+
+template <typename ChannelType>
+void test_batched_threaded(ChannelType& c) {
+    auto values = std::vector<int>(static_cast<int>(number_iterations));
+    std::iota(values.begin(), values.end(), 0);
+
+    auto th = std::thread{[&]() {
+        c.send_many(values.begin(), values.end());
+        c.close();
+    }};
+
+    auto read = std::vector<int>{};
+    while (c.read_many(std::back_inserter(read), 64)) {}
+    th.join();
+    EXPECT_EQ(read, values);
+}
+
+TEST(Channel, BatchedUnbuffered) {
+    sharp::Channel<int> c;
+    test_batched_threaded(c);
+}
+
+TEST(Channel, BatchedBuffered) {
+    sharp::Channel<int> c{16};
+    test_batched_threaded(c);
+}
+
+TEST(Channel, MpmcBatched) {
+    MpmcChannel<int> c{16};
+    test_batched_threaded(c);
+}
+
+TEST(Channel, ReadUpToTimeout) {
+    sharp::Channel<int> c{4};
+    EXPECT_TRUE(c.read_up_to(2, std::chrono::milliseconds{10}).empty());
+
+    c.send(1);
+    c.send(2);
+    c.send(3);
+    EXPECT_EQ(c.read_up_to(2, std::chrono::milliseconds{10}),
+              (std::vector<int>{1, 2}));
+    EXPECT_EQ(c.read_up_to(2, std::chrono::milliseconds{10}),
+              (std::vector<int>{3}));
+
+    // giving up should not leave any slots behind
+    for (auto i = 0; i < 4; ++i) {
+        EXPECT_TRUE(c.try_send(i));
+    }
+    EXPECT_FALSE(c.try_send(4));
+}
+
+TEST(Channel, ReadUpToThreaded) {
+    sharp::Channel<int> c;
+    auto th = std::thread{[&]() {
+        for (auto i = 0; i < 10; ++i) {
+            c.send(i);
+        }
+    }};
+
+    auto read = std::vector<int>{};
+    while (read.size() != 10) {
+        auto batch = c.read_up_to(10 - read.size(), std::chrono::seconds{10});
+        read.insert(read.end(), batch.begin(), batch.end());
+    }
+    th.join();
+    EXPECT_EQ(read, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(Channel, MpmcReadUpTo) {
+    MpmcChannel<int> c{4};
+    EXPECT_TRUE(c.read_up_to(2, std::chrono::milliseconds{10}).empty());
+    c.send(1);
+    EXPECT_EQ(c.read_up_to(2, std::chrono::milliseconds{10}),
+              (std::vector<int>{1}));
+}
+
+TEST(Channel, SendForTimeout) {
+    sharp::Channel<std::unique_ptr<int>> c;
+    auto value = std::make_unique<int>(1);
+    EXPECT_FALSE(c.send_for(std::move(value), std::chrono::milliseconds{10}));
+    EXPECT_TRUE(value);
+
+    sharp::Channel<int> d{1};
+    EXPECT_TRUE(d.send_until(1, std::chrono::steady_clock::now()));
+    EXPECT_FALSE(d.send_for(2, std::chrono::milliseconds{10}));
+    EXPECT_EQ(d.read(), 1);
+}
+
+TEST(Channel, ReadForTimeout) {
+    sharp::Channel<int> c;
+    EXPECT_FALSE(c.read_for(std::chrono::milliseconds{10}));
+
+    // the reader that gave up should not leave an open slot behind on the
+    // unbuffered channel
+    EXPECT_FALSE(c.try_send(1));
+
+    c.close();
+    EXPECT_THROW(c.read_for(std::chrono::milliseconds{10}),
+                 sharp::ChannelClosedError);
+    EXPECT_THROW(c.send_for(1, std::chrono::milliseconds{10}),
+                 sharp::ChannelClosedError);
+}
+
+TEST(Channel, TimedThreaded) {
+    for (auto i = 0; i < number_iterations; ++i) {
+        sharp::Channel<int> c;
+        auto th = std::thread{[&]() {
+            while (!c.send_for(1, std::chrono::milliseconds{1})) {}
+        }};
+
+        auto value = c.read_for(std::chrono::seconds{10});
+        EXPECT_TRUE(value);
+        EXPECT_EQ(value.value(), 1);
+        th.join();
+
+        // every reader and sender that timed out should have given their
+        // slots back
+        EXPECT_FALSE(c.try_send(1));
+        EXPECT_FALSE(c.try_read());
+    }
+}
+
+TEST(Channel, MpmcTimed) {
+    MpmcChannel<int> c{1};
+    EXPECT_FALSE(c.read_for(std::chrono::milliseconds{10}));
+    EXPECT_TRUE(c.send_for(1, std::chrono::milliseconds{10}));
+    EXPECT_FALSE(c.send_for(2, std::chrono::milliseconds{10}));
+    EXPECT_EQ(c.read_for(std::chrono::milliseconds{10}).value(), 1);
+    c.close();
+    EXPECT_THROW(c.read_for(std::chrono::milliseconds{10}),
+                 sharp::ChannelClosedError);
+}
+
+template <typename Type>
+using SpscChannel = sharp::Channel<Type, std::mutex, std::condition_variable,
+                                   sharp::channel_policy::Spsc>;
+
+TEST(Channel, SpscBasic) {
+    SpscChannel<int> c{2};
+    EXPECT_FALSE(c.try_read());
+    c.send(1);
+    EXPECT_TRUE(c.try_send(2));
+    EXPECT_FALSE(c.try_send(3));
+    EXPECT_EQ(c.read(), 1);
+    EXPECT_EQ(c.try_read().value(), 2);
+    EXPECT_FALSE(c.try_read());
+    EXPECT_THROW(SpscChannel<int>{0}, std::invalid_argument);
+}
+
+TEST(Channel, SpscTrySendDoesNotMoveOnFailure) {
+    SpscChannel<std::unique_ptr<int>> c{1};
+    c.send(std::make_unique<int>(1));
+    auto pointer = std::make_unique<int>(2);
+    EXPECT_FALSE(c.try_send(std::move(pointer)));
+    EXPECT_TRUE(pointer);
+    EXPECT_EQ(*c.read(), 1);
+    EXPECT_TRUE(c.try_send(std::move(pointer)));
+    EXPECT_EQ(*c.read(), 2);
+}
+
+TEST(Channel, SpscThreaded) {
+    for (auto buffer : {1, 2, 64}) {
+        SpscChannel<int> c{buffer};
+        auto th = std::thread{[&]() {
+            for (auto i = 0; i < 100 * number_iterations; ++i) {
+                c.send(i);
+            }
+            c.close();
+        }};
+
+        auto counter = 0;
+        for (auto val : c) {
+            EXPECT_EQ(val, counter++);
+        }
+        EXPECT_EQ(counter, 100 * number_iterations);
+        th.join();
+    }
+}
+
+TEST(Channel, SpscBatched) {
+    SpscChannel<int> c{16};
+    test_batched_threaded(c);
+}
+
+template <typename ChannelType>
+void test_close_with_sends(int senders) {
+    // every send that returns normally has to be read, even when it races
+    // with the close
+    for (auto i = 0; i < 100; ++i) {
+        ChannelType c{64};
+        std::atomic<int> sent{0};
+        auto threads = std::vector<std::thread>{};
+        for (auto j = 0; j < senders; ++j) {
+            threads.emplace_back([&]() {
+                try {
+                    while (true) {
+                        if (c.try_send(1)) {
+                            sent.fetch_add(1);
+                        }
+                    }
+                } catch (sharp::ChannelClosedError&) {}
+            });
+        }
+        threads.emplace_back([&]() { c.close(); });
+
+        auto read = 0;
+        for (auto value : c) {
+            read += value;
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(read, sent.load());
+    }
+}
+
+TEST(Channel, MpmcCloseDoesNotLoseSends) {
+    test_close_with_sends<MpmcChannel<int>>(3);
+}
+
+TEST(Channel, SpscCloseDoesNotLoseSends) {
+    test_close_with_sends<SpscChannel<int>>(1);
+}
+
+template <typename ChannelType>
+void test_send_exception(ChannelType& c) {
+    c.send(1);
+    c.send_exception(std::make_exception_ptr(std::runtime_error{"error"}));
+    c.send(2);
+
+    EXPECT_EQ(c.read(), 1);
+    auto element = c.read_try();
+    EXPECT_TRUE(element.has_exception());
+    EXPECT_THROW(element.get(), std::runtime_error);
+    EXPECT_EQ(c.read(), 2);
+
+    c.send_exception(std::make_exception_ptr(std::runtime_error{"error"}));
+    EXPECT_THROW(c.read(), std::runtime_error);
+}
+
+TEST(Channel, SendException) {
+    sharp::Channel<int> c{3};
+    test_send_exception(c);
+    MpmcChannel<int> mpmc{3};
+    test_send_exception(mpmc);
+    SpscChannel<int> spsc{3};
+    test_send_exception(spsc);
+}
 
-// TEST(Channel, RangeTest) {
-    // sharp::Channel<int> c;
-    // std::thread{[&]() {
-        // fibonacci_range(c);
-    // }}.detach();
-    // auto results = std::vector<int>{0, 1, 1, 2, 3, 5, 8, 13, 21, 34};
+template <typename ChannelType>
+void test_read_up_to_exception(ChannelType& c) {
+    // an exception ends the batch before it, then comes out on its own.
+    // Enough rounds go through that exceptions land on every slot
+    for (auto i = 0; i < 1000; ++i) {
+        c.send(2 * i);
+        c.send(2 * i + 1);
+        c.send_exception(std::make_exception_ptr(std::runtime_error{"error"}));
+        EXPECT_EQ(c.read_up_to(5, std::chrono::seconds{10}),
+                  (std::vector<int>{2 * i, 2 * i + 1}));
+        EXPECT_THROW(c.read_up_to(5, std::chrono::seconds{10}),
+                     std::runtime_error);
+    }
 
-    // auto counter = 0;
-    // for (auto val : c) {
-        // EXPECT_EQ(val, results[counter++]);
-    // }
-// }
+    c.send(1);
+    c.send_exception(std::make_exception_ptr(std::runtime_error{"error"}));
+    c.send(2);
+    EXPECT_EQ(c.read_up_to(3, std::chrono::milliseconds{10}),
+              (std::vector<int>{1}));
+    EXPECT_THROW(c.read(), std::runtime_error);
+    EXPECT_EQ(c.read_up_to(3, std::chrono::milliseconds{10}),
+              (std::vector<int>{2}));
+}
+
+TEST(Channel, ReadUpToStopsAtException) {
+    sharp::Channel<int> c{3};
+    test_read_up_to_exception(c);
+    MpmcChannel<int> mpmc{3};
+    test_read_up_to_exception(mpmc);
+    SpscChannel<int> spsc{3};
+    test_read_up_to_exception(spsc);
+}
+
+TEST(Channel, ManyQueuedExceptionsStayInOrder) {
+    // most of the queue is exceptions, and reads only take some of them
+    // before more are sent, so the exceptions read and the ones still queued
+    // are mixed together the whole time
+    sharp::Channel<int> c{64};
+    auto sent = 0;
+    auto read = 0;
+    auto send = [&]() {
+        if (sent % 4) {
+            c.send_exception(std::make_exception_ptr(
+                        std::runtime_error{std::to_string(sent)}));
+        } else {
+            c.send(sent);
+        }
+        ++sent;
+    };
+    auto check = [&]() {
+        auto element = c.read_try();
+        if (read % 4) {
+            ASSERT_TRUE(element.has_exception());
+            try {
+                element.get();
+            } catch (std::runtime_error& error) {
+                EXPECT_EQ(error.what(), std::to_string(read));
+            }
+        } else {
+            EXPECT_EQ(element.get(), read);
+        }
+        ++read;
+    };
+
+    for (auto round = 0; round < 100; ++round) {
+        while (sent - read < 64) {
+            send();
+        }
+        for (auto i = 0; i < 37; ++i) {
+            check();
+        }
+    }
+    while (read < sent) {
+        check();
+    }
+}
+
+TEST(Channel, ExceptionsWithWaitingReaders) {
+    // with a few readers waiting, sends on an unbuffered channel go through
+    // one after the other and the queue has to make room past the buffer
+    sharp::Channel<std::unique_ptr<int>> c{0};
+    auto total = static_cast<int>(10 * number_iterations);
+    std::mutex mtx;
+    auto values = std::vector<int>{};
+    auto exceptions = 0;
+    auto readers = std::vector<std::thread>{};
+    for (auto i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (true) {
+                auto element = c.read_try();
+                auto lck = std::unique_lock<std::mutex>{mtx};
+                try {
+                    values.push_back(*element.get());
+                } catch (sharp::ChannelClosedError&) {
+                    return;
+                } catch (std::runtime_error&) {
+                    ++exceptions;
+                }
+            }
+        });
+    }
+
+    for (auto i = 0; i < total; ++i) {
+        if (i % 3 == 1) {
+            c.send_exception(std::make_exception_ptr(
+                        std::runtime_error{"error"}));
+        } else {
+            c.send(std::make_unique<int>(i));
+        }
+    }
+    c.close();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    auto expected = std::vector<int>{};
+    for (auto i = 0; i < total; ++i) {
+        if (i % 3 != 1) {
+            expected.push_back(i);
+        }
+    }
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(values, expected);
+    EXPECT_EQ(exceptions, total - static_cast<int>(expected.size()));
+}
+
+TEST(Channel, BroadcastBasic) {
+    sharp::BroadcastChannel<int> c{2};
+    c.send(0);
+    auto one = c.subscribe();
+    auto two = c.subscribe();
+    EXPECT_FALSE(one.try_read());
+
+    c.send(1);
+    c.send_exception(std::make_exception_ptr(std::runtime_error{"error"}));
+    EXPECT_EQ(one.read(), 1);
+    EXPECT_THROW(one.read(), std::runtime_error);
+    EXPECT_EQ(two.try_read().value(), 1);
+    EXPECT_TRUE(two.read_try().has_exception());
+
+    c.send(2);
+    c.close();
+    EXPECT_THROW(c.send(3), sharp::ChannelClosedError);
+    EXPECT_EQ(one.read(), 2);
+    EXPECT_EQ(two.read(), 2);
+    EXPECT_THROW(one.read(), sharp::ChannelClosedError);
+    EXPECT_FALSE(two.try_read());
+    EXPECT_THROW((sharp::BroadcastChannel<int>{0}), std::invalid_argument);
+}
+
+TEST(Channel, BroadcastBlock) {
+    sharp::BroadcastChannel<int> c{4};
+    auto subscribers = std::vector<decltype(c.subscribe())>{};
+    for (auto i = 0; i < 4; ++i) {
+        subscribers.push_back(c.subscribe());
+    }
+
+    // every subscriber sees every value in order, however far behind the
+    // others it is
+    auto threads = std::vector<std::thread>{};
+    for (auto& subscriber : subscribers) {
+        threads.emplace_back([&subscriber]() {
+            auto expected = 0;
+            try {
+                while (true) {
+                    auto value = subscriber.read();
+                    EXPECT_EQ(value, expected++);
+                }
+            } catch (sharp::ChannelClosedError&) {}
+            EXPECT_EQ(expected, static_cast<int>(number_iterations));
+        });
+    }
+
+    for (auto i = 0; i < number_iterations; ++i) {
+        c.send(i);
+    }
+    c.close();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST(Channel, BroadcastDropOldest) {
+    sharp::BroadcastChannel<int> c{2, sharp::BroadcastOverflow::DROP_OLDEST};
+    auto slow = c.subscribe();
+    auto fast = c.subscribe();
+    for (auto i = 0; i < 5; ++i) {
+        c.send(i);
+        EXPECT_EQ(fast.read(), i);
+    }
+
+    EXPECT_EQ(slow.read(), 3);
+    EXPECT_EQ(slow.dropped(), 3);
+    EXPECT_EQ(slow.read(), 4);
+    EXPECT_FALSE(slow.try_read());
+    EXPECT_EQ(fast.dropped(), 0);
+}
+
+TEST(Channel, BroadcastDisconnect) {
+    sharp::BroadcastChannel<int> c{2, sharp::BroadcastOverflow::DISCONNECT};
+    auto slow = c.subscribe();
+    auto fast = c.subscribe();
+    for (auto i = 0; i < 5; ++i) {
+        c.send(i);
+        EXPECT_EQ(fast.read(), i);
+    }
+
+    EXPECT_THROW(slow.read(), sharp::SubscriberDisconnectedError);
+    EXPECT_THROW(slow.try_read(), sharp::SubscriberDisconnectedError);
+    c.send(5);
+    EXPECT_EQ(fast.read(), 5);
+}
+
+TEST(Channel, BroadcastDropOldestConcurrentReads) {
+    // the subscribers copy values out while the sender overwrites the slots
+    // under them, every value read must be whole and every value is either
+    // read or counted as dropped
+    sharp::BroadcastChannel<std::string> c{
+        4, sharp::BroadcastOverflow::DROP_OLDEST};
+    auto subscribers = std::vector<decltype(c.subscribe())>{};
+    for (auto i = 0; i < 4; ++i) {
+        subscribers.push_back(c.subscribe());
+    }
+
+    auto total = static_cast<int>(number_iterations) * 10;
+    auto value = [](int i) { return std::string(64, 'a' + i % 26); };
+    auto threads = std::vector<std::thread>{};
+    for (auto& subscriber : subscribers) {
+        threads.emplace_back([&subscriber, total]() {
+            auto read = 0;
+            try {
+                while (true) {
+                    auto element = subscriber.read();
+                    EXPECT_EQ(element.size(), 64u);
+                    EXPECT_EQ(element, std::string(64, element.front()));
+                    ++read;
+                }
+            } catch (sharp::ChannelClosedError&) {}
+            EXPECT_EQ(read + static_cast<int>(subscriber.dropped()), total);
+        });
+    }
+
+    for (auto i = 0; i < total; ++i) {
+        c.send(value(i));
+    }
+    c.close();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST(Channel, BroadcastUnsubscribeUnblocks) {
+    sharp::BroadcastChannel<int> c{1};
+    using Subscriber = decltype(c.subscribe());
+    auto subscriber = std::make_unique<Subscriber>(c.subscribe());
+    c.send(0);
+
+    auto th = std::thread{[&]() { c.send(1); }};
+    subscriber.reset();
+    th.join();
+
+    // with nobody subscribed the values are not kept around
+    c.send(2);
+    auto late = c.subscribe();
+    EXPECT_FALSE(late.try_read());
+}
+
+template <typename Type>
+using UnboundedChannel = sharp::Channel<Type, std::mutex,
+                                        std::condition_variable,
+                                        sharp::channel_policy::Unbounded>;
+
+TEST(Channel, UnboundedNeverBlocks) {
+    UnboundedChannel<int> c{0};
+    for (auto i = 0; i < number_iterations; ++i) {
+        EXPECT_TRUE(c.try_send(i));
+    }
+    auto stats = c.stats();
+    EXPECT_EQ(stats.depth, number_iterations);
+    EXPECT_EQ(stats.peak_depth, number_iterations);
+    EXPECT_GE(stats.bytes_retained, number_iterations * sizeof(int));
+    auto full = stats.bytes_retained;
+
+    for (auto i = 0; i < number_iterations; ++i) {
+        EXPECT_EQ(c.read(), i);
+    }
+    EXPECT_FALSE(c.try_read());
+
+    // the segments are given back as the queue drains
+    stats = c.stats();
+    EXPECT_EQ(stats.depth, 0u);
+    EXPECT_EQ(stats.peak_depth, number_iterations);
+    EXPECT_LT(stats.bytes_retained, full);
+}
+
+TEST(Channel, UnboundedHighWatermark) {
+    using Element = sharp::Try<std::unique_ptr<int>>;
+    UnboundedChannel<std::unique_ptr<int>> c{static_cast<int>(4 * sizeof(Element))};
+    for (auto i = 0; i < 4; ++i) {
+        EXPECT_TRUE(c.try_send(std::make_unique<int>(i)));
+    }
+    EXPECT_FALSE(c.try_send(std::make_unique<int>(4)));
+
+    EXPECT_EQ(*c.read(), 0);
+    EXPECT_TRUE(c.try_send(std::make_unique<int>(4)));
+    EXPECT_FALSE(c.try_send(std::make_unique<int>(5)));
+    EXPECT_EQ(c.stats().depth, 4u);
+}
+
+TEST(Channel, UnboundedThreaded) {
+    UnboundedChannel<int> c{0};
+    auto th = std::thread{[&]() {
+        for (auto i = 0; i < 100 * number_iterations; ++i) {
+            c.send(i);
+        }
+        c.close();
+    }};
+
+    auto counter = 0;
+    for (auto val : c) {
+        EXPECT_EQ(val, counter++);
+    }
+    EXPECT_EQ(counter, 100 * number_iterations);
+    th.join();
+}
+
+TEST(Channel, UnboundedBatched) {
+    UnboundedChannel<int> c{0};
+    test_batched_threaded(c);
+}
+
+TEST(Channel, UnboundedReadUpToStopsAtException) {
+    UnboundedChannel<int> c{0};
+    test_read_up_to_exception(c);
+}
+
+template <typename ChannelType>
+void test_concurrent_unlimited_batches(ChannelType& c) {
+    // both readers announce themselves as an unlimited number of readers,
+    // which must not overflow the count of open slots
+    auto read = std::vector<std::vector<int>>(2);
+    auto readers = std::vector<std::thread>{};
+    for (auto& batch : read) {
+        readers.push_back(std::thread{[&c, &batch]() {
+            auto max = std::numeric_limits<std::size_t>::max();
+            while (c.read_many(std::back_inserter(batch), max)) {}
+        }});
+    }
+
+    for (auto i = 0; i < number_iterations; ++i) {
+        c.send(i);
+    }
+    c.close();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    auto all = read[0];
+    all.insert(all.end(), read[1].begin(), read[1].end());
+    std::sort(all.begin(), all.end());
+    auto values = std::vector<int>(static_cast<int>(number_iterations));
+    std::iota(values.begin(), values.end(), 0);
+    EXPECT_EQ(all, values);
+}
+
+TEST(Channel, ConcurrentUnlimitedBatches) {
+    sharp::Channel<int> c{4};
+    test_concurrent_unlimited_batches(c);
+}
+
+TEST(Channel, UnboundedConcurrentUnlimitedBatches) {
+    UnboundedChannel<int> c{0};
+    test_concurrent_unlimited_batches(c);
+}
+
+TEST(Channel, LockedStats) {
+    sharp::Channel<int> c{2};
+    c.send(1);
+    c.send(2);
+    c.read();
+    auto stats = c.stats();
+    EXPECT_EQ(stats.depth, 1u);
+    EXPECT_EQ(stats.peak_depth, 2u);
+    EXPECT_GE(stats.bytes_retained, 2 * sizeof(int));
+}
+
+#if SHARP_HAS_COROUTINES
+namespace {
+
+/**
+ * An executor that runs closures on a fixed set of threads, the coroutines
+ * in the tests below are resumed on these
+ */
+class ThreadsExecutor : public sharp::Executor {
+public:
+    explicit ThreadsExecutor(int number_threads) {
+        for (auto i = 0; i < number_threads; ++i) {
+            this->threads.emplace_back([this]() { this->run(); });
+        }
+    }
+    ~ThreadsExecutor() override {
+        {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            this->stopped = true;
+            this->cv.notify_all();
+        }
+        for (auto& thread : this->threads) {
+            thread.join();
+        }
+    }
+
+    void add(sharp::Function<void()> closure) override {
+        auto lck = std::unique_lock<std::mutex>{this->mtx};
+        this->closures.push_back(std::move(closure));
+        this->cv.notify_one();
+    }
+
+private:
+    void run() {
+        while (true) {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            while (this->closures.empty() && !this->stopped) {
+                this->cv.wait(lck);
+            }
+            if (this->closures.empty()) {
+                return;
+            }
+            auto closure = std::move(this->closures.front());
+            this->closures.erase(this->closures.begin());
+            lck.unlock();
+            closure();
+        }
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<sharp::Function<void()>> closures;
+    bool stopped{false};
+    std::vector<std::thread> threads;
+};
+
+/**
+ * A coroutine that starts running right away and cleans up after itself
+ */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+template <typename ChannelType>
+Detached async_consumer(ChannelType& c, sharp::Executor& executor,
+                        std::atomic<int>& sum, std::atomic<int>& done) {
+    while (true) {
+        try {
+            sum.fetch_add(co_await c.async_read(executor));
+        } catch (sharp::ChannelClosedError&) {
+            break;
+        }
+    }
+    done.fetch_add(1);
+}
+
+template <typename ChannelType>
+Detached async_producer(ChannelType& c, sharp::Executor& executor, int count,
+                        std::atomic<int>& done) {
+    for (auto i = 0; i < count; ++i) {
+        co_await c.async_send(i, executor);
+    }
+    done.fetch_add(1);
+}
+
+template <typename ChannelType>
+void test_async(ChannelType& c) {
+    // many more coroutines than threads, each one is parked on the channel
+    // most of the time
+    ThreadsExecutor executor{2};
+    auto sum = std::atomic<int>{0};
+    auto consumers = std::atomic<int>{0};
+    auto producers = std::atomic<int>{0};
+    for (auto i = 0; i < 100; ++i) {
+        async_consumer(c, executor, sum, consumers);
+    }
+    for (auto i = 0; i < 10; ++i) {
+        async_producer(c, executor, 100, producers);
+    }
+
+    while (producers.load() != 10) {
+        std::this_thread::yield();
+    }
+    c.close();
+    while (consumers.load() != 100) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(sum.load(), 10 * (99 * 100 / 2));
+}
+
+} // namespace
+
+TEST(Channel, AsyncUnbuffered) {
+    sharp::Channel<int> c;
+    test_async(c);
+}
+
+TEST(Channel, AsyncBuffered) {
+    sharp::Channel<int> c{4};
+    test_async(c);
+}
+
+TEST(Channel, MpmcAsync) {
+    MpmcChannel<int> c{4};
+    test_async(c);
+}
+
+TEST(Channel, AsyncExceptions) {
+    ThreadsExecutor executor{1};
+    sharp::Channel<int> c{1};
+    auto caught = std::atomic<int>{0};
+    auto coroutine = [&]() -> Detached {
+        try {
+            co_await c.async_read(executor);
+        } catch (std::runtime_error&) {
+            caught.fetch_add(1);
+        }
+        try {
+            while (true) {
+                co_await c.async_send(1, executor);
+            }
+        } catch (sharp::ChannelClosedError&) {
+            caught.fetch_add(1);
+        }
+    };
+    coroutine();
+
+    c.send_exception(std::make_exception_ptr(std::runtime_error{"error"}));
+    while (caught.load() != 1) {
+        std::this_thread::yield();
+    }
+    for (auto i = 0; i < 10; ++i) {
+        EXPECT_EQ(c.read(), 1);
+    }
+    c.close();
+    while (caught.load() != 2) {
+        std::this_thread::yield();
+    }
+}
+
+namespace {
+
+/**
+ * An executor that keeps closures till they are run by hand, so the tests
+ * can count how many attempts the channel schedules
+ */
+class ManualExecutor : public sharp::Executor {
+public:
+    void add(sharp::Function<void()> closure) override {
+        this->closures.push_back(std::move(closure));
+    }
+    std::size_t run() {
+        auto closures = std::move(this->closures);
+        this->closures.clear();
+        for (auto& closure : closures) {
+            closure();
+        }
+        return closures.size();
+    }
+
+private:
+    std::vector<sharp::Function<void()>> closures;
+};
+
+template <typename ChannelType>
+void test_async_wake_one(ChannelType& c) {
+    // a value only wakes up one of the parked readers, the rest are woken
+    // up when the channel is closed
+    auto executor = ManualExecutor{};
+    auto read = 0;
+    auto closed = 0;
+    auto coroutine = [&]() -> Detached {
+        try {
+            co_await c.async_read(executor);
+            ++read;
+        } catch (sharp::ChannelClosedError&) {
+            ++closed;
+        }
+    };
+    for (auto i = 0; i < 100; ++i) {
+        coroutine();
+    }
+
+    c.send(1);
+    EXPECT_EQ(executor.run(), 1u);
+    EXPECT_EQ(read, 1);
+    c.send(2);
+    c.send(3);
+    EXPECT_EQ(executor.run(), 2u);
+    EXPECT_EQ(read, 3);
+    c.close();
+    EXPECT_EQ(executor.run(), 97u);
+    EXPECT_EQ(closed, 97);
+}
+
+} // namespace
+
+TEST(Channel, AsyncWakeOne) {
+    sharp::Channel<int> c{2};
+    test_async_wake_one(c);
+}
+
+TEST(Channel, MpmcAsyncWakeOne) {
+    MpmcChannel<int> c{2};
+    test_async_wake_one(c);
+}
+
+template <typename ChannelType>
+void test_async_inline(ChannelType& c) {
+    // the parked coroutine is resumed inline on the thread that changed the
+    // channel, which must have let go of the channel's lock by then
+    auto& executor = *sharp::InlineExecutor::get();
+    auto values = std::vector<int>{};
+    auto closed = false;
+    auto coroutine = [&]() -> Detached {
+        try {
+            while (true) {
+                values.push_back(co_await c.async_read(executor));
+            }
+        } catch (sharp::ChannelClosedError&) {
+            closed = true;
+        }
+    };
+    coroutine();
+
+    EXPECT_TRUE(values.empty());
+    c.send(1);
+    EXPECT_EQ(values, std::vector<int>{1});
+    c.send(2);
+    EXPECT_EQ(values, (std::vector<int>{1, 2}));
+    EXPECT_FALSE(closed);
+    c.close();
+    EXPECT_TRUE(closed);
+}
+
+TEST(Channel, AsyncInlineExecutor) {
+    sharp::Channel<int> c{1};
+    test_async_inline(c);
+}
+
+TEST(Channel, MpmcAsyncInlineExecutor) {
+    MpmcChannel<int> c{1};
+    test_async_inline(c);
+}
+
+TEST(Channel, AsyncSendInlineExecutor) {
+    // the read makes room for the parked send, which goes through inline
+    // before the read goes to sleep
+    auto& executor = *sharp::InlineExecutor::get();
+    sharp::Channel<int> c;
+    auto sent = 0;
+    auto closed = false;
+    auto coroutine = [&]() -> Detached {
+        try {
+            while (true) {
+                co_await c.async_send(sent, executor);
+                ++sent;
+            }
+        } catch (sharp::ChannelClosedError&) {
+            closed = true;
+        }
+    };
+    coroutine();
+
+    EXPECT_EQ(sent, 0);
+    EXPECT_EQ(c.read(), 0);
+    EXPECT_EQ(c.read(), 1);
+    EXPECT_EQ(sent, 2);
+    c.close();
+    EXPECT_TRUE(closed);
+}
+#endif
@@ -22,11 +22,11 @@
 #include <sharp/Tags/Tags.hpp>
 #include <sharp/Portability/cpp17.hpp>
 
+#include <chrono>
 #include <condition_variable>
 #include <utility>
 #include <type_traits>
 #include <mutex>
-#include <unordered_map>
 
 namespace sharp {
 
@@ -233,12 +233,12 @@ private:
          * non null state, when called from a null state, the program exhibits
          * undefined behavior
          *
-         * If multiple threads are waiting on the same condition it is useful
-         * to pass the same function pointer or lambda to this function.  In
-         * that case the concurrent object internally only allocates one
-         * condition variable for all those conditions.  Whereas if different
-         * threads want to wait on different conditions, different conditions
-         * should be passed
+         * Waiting does not allocate, the waiting thread links a node on its
+         * own stack into the concurrent object and only that thread is woken
+         * up when an unlock finds its condition to be true.  If multiple
+         * threads are waiting on the same condition it is useful to pass the
+         * same function pointer or lambda to this function, an unlock then
+         * evaluates the condition once for consecutive waiters on it
          *
          * If the wrapped class has a const is_ready() function, the condition
          * itself can be skipped enitrely and left empty, the lock proxy will
@@ -252,6 +252,24 @@ private:
          */
         void wait(Concurrent::Condition_t condition);
 
+        /**
+         * Timed versions of wait(), these return false if the timeout expired
+         * before the condition became true and true otherwise.  The lock is
+         * held on return either way, for example
+         *
+         *      auto lock = concurrent.lock();
+         *      if (!lock.wait_for([](auto& q) { return !q.empty(); }, 1s)) {
+         *          // timed out, the queue is still empty
+         *      }
+         */
+        template <typename Clock, typename Duration>
+        bool wait_until(
+                Concurrent::Condition_t condition,
+                const std::chrono::time_point<Clock, Duration>& deadline);
+        template <typename Rep, typename Period>
+        bool wait_for(Concurrent::Condition_t condition,
+                      const std::chrono::duration<Rep, Period>& timeout);
+
         /**
          * Friend the outer concurrent class, it is the only one that can
          * construct objects of type LockProxy
@@ -446,19 +464,17 @@ private:
     mutable Mutex mtx;
 
     /**
-     * The information for condition critical sections, each conditional
-     * critical section corresponds to a trivial to execute condition that the
-     * conditional critical section is dependent on and the condition variable
-     * associated with that condition.  If multiple threads are waiting on the
-     * same condition, they will share condition variables.  If however the
-     * condition is different then the condition variables will be different
-     * as well
+     * The information for condition critical sections, the threads waiting
+     * in conditional critical sections along with the conditions they are
+     * waiting on.  Every waiting thread has a condition variable of its own,
+     * so an unlock wakes up exactly the threads whose conditions are true
      *
      * Note that since this can only be accessed from within a locked proxy,
      * this does not need to be protected by a mutex itself, it is already
-     * protected by this->mtx
+     * protected by this->mtx.  It is mutable because threads waiting with a
+     * shared lock on a const object link themselves into it too
      */
-    concurrent_detail::Conditions<Mutex, Cv, Condition_t> conditions;
+    mutable concurrent_detail::Conditions<Mutex, Cv, Condition_t> conditions;
 
     /**
      * Friend for testing
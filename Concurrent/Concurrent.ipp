@@ -4,6 +4,7 @@
 #include <sharp/Traits/Traits.hpp>
 
 #include <cassert>
+#include <chrono>
 #include <iostream>
 #include <mutex>
 #include <condition_variable>
@@ -68,12 +69,9 @@ void Concurrent<Type, Mutex, Cv>::template LockProxy<C, LockTag>::unlock()
         noexcept {
     // unlock the mutex and go into a null state
     if (this->instance_ptr) {
-        // wake any sleeping threads if their conditions are met
-        auto raii = this->instance_ptr->conditions.notify_all(*this, LockTag{});
-        static_cast<void>(raii);
-
-        // unlock the mutex, the actual signalling will happen on destruction
-        // of the raii object
+        // wake any sleeping threads if their conditions are met, they get
+        // the mutex once it is unlocked here
+        this->instance_ptr->conditions.notify_all(*this, LockTag{});
         concurrent_detail::unlock_mutex(this->instance_ptr->mtx, LockTag{});
         this->instance_ptr = nullptr;
     }
@@ -107,6 +105,26 @@ void Concurrent<Type, Mutex, Cv>::template LockProxy<C, LockTag>::wait(
     this->instance_ptr->conditions.wait(condition, *this, LockTag{});
 }
 
+template <typename Type, typename Mutex, typename Cv>
+template <typename C, typename LockTag>
+template <typename Clock, typename Duration>
+bool Concurrent<Type, Mutex, Cv>::template LockProxy<C, LockTag>::wait_until(
+        Concurrent::Condition_t condition,
+        const std::chrono::time_point<Clock, Duration>& deadline) {
+    return this->instance_ptr->conditions.wait_until(condition, *this,
+                                                     deadline, LockTag{});
+}
+
+template <typename Type, typename Mutex, typename Cv>
+template <typename C, typename LockTag>
+template <typename Rep, typename Period>
+bool Concurrent<Type, Mutex, Cv>::template LockProxy<C, LockTag>::wait_for(
+        Concurrent::Condition_t condition,
+        const std::chrono::duration<Rep, Period>& timeout) {
+    return this->wait_until(condition,
+                            std::chrono::steady_clock::now() + timeout);
+}
+
 /**
  * Implementations for the Concurrent<> methods
  */
@@ -17,9 +17,9 @@
 #include <sharp/Threads/Threads.hpp>
 #include <sharp/Tags/Tags.hpp>
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
-#include <unordered_map>
 
 namespace sharp {
 namespace concurrent_detail {
@@ -95,70 +95,88 @@ namespace concurrent_detail {
     using EnableIfIsInvalidCv
         = std::enable_if_t<std::is_same<Cv, InvalidCv>::value>;
 
+    /**
+     * A thread waiting on a condition, these live on the stack of the
+     * waiting thread and are linked into the list of waiters of the
+     * Concurrent object it is waiting on.  Each one has a condition variable
+     * of its own, so a writer only wakes up the threads whose conditions
+     * have become true
+     */
+    template <typename Condition, typename Cv>
+    struct ConditionWaiter {
+        explicit ConditionWaiter(Condition condition_in)
+            : condition{condition_in} {}
+
+        Condition condition;
+        Cv cv;
+        bool signaled{false};
+        bool linked{false};
+        ConditionWaiter* next{nullptr};
+        ConditionWaiter* previous{nullptr};
+    };
+
     /**
      * @class ConditionsImpl
      *
      * This class offers the bookkeeping interface for the conditional
      * critical sections feature of the Concurrent class
      *
-     * It allocates one condition variable per condition, so that threads can
-     * now reuse conditions and work on the same condition variable
-     *
-     * This class protects the condition to condition variable mapping using a
-     * mutex since the conditions can be accessed concurrently if the
-     * concurrent class is operating on a reader writer lock
+     * Waiting threads are kept in an intrusive list of nodes that live on
+     * their stacks, so neither waiting nor unlocking allocates.  An unlock
+     * evaluates the condition of every waiter in the list and wakes up the
+     * ones whose conditions are true, and does nothing at all when nobody
+     * is waiting
      *
-     * If however the concurrent class was initialized with an exclusive mutex
-     * then the condition maps are by default protected by the mutex, so this
-     * class does not even contain a mutex for bookkeeping, saving size bloat
-     * on instances of the Concurrent class
+     * The list is protected by the mutex of the Concurrent object when that
+     * is held exclusively.  When the concurrent class is operating on a
+     * reader writer lock, readers can link themselves in concurrently, so
+     * they go through a lock on the bookkeeping, see Conditions below
      */
     template <typename Condition, typename Cv,
               typename = std::enable_if_t<true>>
     class ConditionsImpl {
     public:
 
+        using Waiter = ConditionWaiter<Condition, Cv>;
+
         /**
          * This function should always be called under a write lock before the
-         * unlock has been made so that an extra mutex can be avoided when
-         * notifying threads
+         * unlock has been made, so no thread can be linking itself into the
+         * list or evaluating its own condition concurrently
          *
-         * TODO test which is faster, an extra mutex before broadcasting or no
-         * mutex and piggybacking on the existing mutex (as the current
-         * implementation is)
+         * Woken threads are unlinked and signalled right here, with the
+         * mutex still held.  A waiter's node belongs to it again as soon as
+         * it can get the mutex back and see that it was signalled, so the
+         * nodes are not touched after the mutex has been released
          */
         template <typename LockProxy, typename C = Cv,
                   EnableIfIsValidCv<C>* = nullptr>
-        auto notify_all(LockProxy& proxy, WriteLockTag) {
-
-            // implement two phase signalling, in the first phase all the
-            // stale condition variables are removed from the bookkeeping and
-            // in the second phase when the Concurrent item lock has been
-            // released, loop through the cvs and call signal on them
-            auto cvs = std::vector<std::shared_ptr<Cv>>{};
-
-            for (auto i = this->conditions.begin();
-                    i != this->conditions.end();) {
-
-                // if the condition evaluates to true then broadcast and erase
-                // that entry from the bookkeeping map because it is not
-                // required anymore, the threads have their own reference
-                // counted pointer to the condition variable being erased
-                if (i->first(*proxy)) {
-                    cvs.push_back(i->second);
-                    i = this->conditions.erase(i);
-                } else {
-                    ++i;
-                }
+        void notify_all(LockProxy& proxy, WriteLockTag) {
+
+            // nobody is waiting, so there is no condition to evaluate
+            if (!this->head) {
+                return;
             }
 
-            // return a deferrable which will signal all the condition
-            // variables on destruction
-            return sharp::defer([cvs = std::move(cvs)] {
-                for (auto& cv : cvs) {
-                    cv->notify_all();
+            // threads waiting on the same condition usually wait one after
+            // the other, so a condition is not evaluated again for the next
+            // waiter if it has the same one
+            auto last = static_cast<Waiter*>(nullptr);
+            auto satisfied = false;
+            auto waiter = this->head;
+            while (waiter) {
+                auto next = waiter->next;
+                if (!last || last->condition != waiter->condition) {
+                    satisfied = waiter->condition(*proxy);
                 }
-            });
+                last = waiter;
+                if (satisfied) {
+                    this->unlink(*waiter);
+                    waiter->signaled = true;
+                    waiter->cv.notify_one();
+                }
+                waiter = next;
+            }
         }
 
         /**
@@ -167,7 +185,7 @@ namespace concurrent_detail {
          */
         template <typename LockProxy, typename C = Cv,
                   EnableIfIsValidCv<C>* = nullptr>
-        int notify_all(LockProxy&, ReadLockTag) { return int{}; }
+        void notify_all(LockProxy&, ReadLockTag) {}
 
     protected:
         /**
@@ -184,8 +202,8 @@ namespace concurrent_detail {
          * wait() concurrently
          *
          * A reference to the underlying mutex should also be passed so that
-         * wait() can be called on the condition variable for the condition by
-         * waiting on that mutex
+         * wait() can be called on the waiter's condition variable by waiting
+         * on that mutex
          */
         template <typename LockProxy, typename Mtx, typename Lock>
         void wait(Condition condition, LockProxy& proxy, Mtx& m, Lock lock) {
@@ -198,47 +216,108 @@ namespace concurrent_detail {
                 return;
             }
 
-            // possibly acquire a lock on the map of conditions and add an
-            // entry to it if one doesnt exist
-            auto cv = std::shared_ptr<Cv>{};
-            auto iter = this->conditions.begin();
-            {
-                // acquire the RAII object and then supress the unused
-                // variable warning for the case when this is a no-op
-                auto lck = lock();
-                static_cast<void>(lck);
+            Waiter waiter{condition};
+            auto deferred = sharp::defer([&]() { this->remove(waiter, lock); });
 
-                // find or insert the cv condition pair into the map
-                iter = this->conditions.find(condition);
-                if (iter == this->conditions.end()) {
-                    iter = this->conditions.emplace(condition,
-                            std::make_shared<Cv>()).first;
+            // a signalled waiter has been unlinked already, so link it again
+            // if the condition went back to being false before the thread
+            // got the mutex back
+            do {
+                this->add(waiter, lock);
+                while (!waiter.signaled) {
+                    waiter.cv.wait(m);
                 }
+            } while (!condition(*proxy));
+        }
 
-                // make a copy that is reference counted with respect to this
-                // thread
-                cv = iter->second;
+        /**
+         * Same as wait() but gives up once the deadline has passed, returns
+         * the value of the condition on return, so false means that the wait
+         * timed out
+         */
+        template <typename LockProxy, typename Mtx, typename Lock,
+                  typename Clock, typename Duration>
+        bool wait_until(
+                Condition condition, LockProxy& proxy, Mtx& m, Lock lock,
+                const std::chrono::time_point<Clock, Duration>& deadline) {
+            if (condition(*proxy)) {
+                return true;
             }
 
-            // wait in a loop monitor wait
-            iter->second->wait(m);
-            if (!condition(*proxy)) {
+            Waiter waiter{condition};
+            auto deferred = sharp::defer([&]() { this->remove(waiter, lock); });
+            do {
+                this->add(waiter, lock);
+                while (!waiter.signaled) {
+                    if (waiter.cv.wait_until(m, deadline)
+                            == std::cv_status::timeout) {
+                        return condition(*proxy);
+                    }
+                }
+            } while (!condition(*proxy));
+            return true;
+        }
 
-                // call wait recursively because this might need to do the
-                // stuff before again, like add condition variables to the map
-                this->wait(condition, proxy, m, lock);
+    private:
+        /**
+         * Possibly acquire a lock on the bookkeeping and link the waiter to
+         * the end of the list, or unlink it if it is still linked.  Only a
+         * writer can unlink other threads' waiters, and that cannot happen
+         * while a waiting thread holds the lock on the Concurrent object, so
+         * a thread can check its own waiter without the bookkeeping lock
+         */
+        template <typename Lock>
+        void add(Waiter& waiter, Lock& lock) {
+            auto lck = lock();
+            static_cast<void>(lck);
+
+            waiter.signaled = false;
+            waiter.linked = true;
+            waiter.next = nullptr;
+            waiter.previous = this->tail;
+            if (this->tail) {
+                this->tail->next = &waiter;
+            } else {
+                this->head = &waiter;
+            }
+            this->tail = &waiter;
+        }
+        template <typename Lock>
+        void remove(Waiter& waiter, Lock& lock) {
+            if (waiter.linked) {
+                auto lck = lock();
+                static_cast<void>(lck);
+                this->unlink(waiter);
             }
         }
+        void unlink(Waiter& waiter) {
+            if (waiter.previous) {
+                waiter.previous->next = waiter.next;
+            } else {
+                this->head = waiter.next;
+            }
+            if (waiter.next) {
+                waiter.next->previous = waiter.previous;
+            } else {
+                this->tail = waiter.previous;
+            }
+            waiter.linked = false;
+        }
 
-    private:
-        std::unordered_map<Condition, std::shared_ptr<Cv>> conditions;
+        Waiter* head{nullptr};
+        Waiter* tail{nullptr};
     };
 
     template <typename Condition, typename Cv>
     class ConditionsImpl<Condition, Cv, EnableIfIsInvalidCv<Cv>> {
     public:
         template <typename... Args>
-        int notify_all(Args&&...) const { return int{}; }
+        void notify_all(Args&&...) const {}
+        template <typename... Args>
+        bool wait_until(Args&&... args) const {
+            this->wait(std::forward<Args>(args)...);
+            return false;
+        }
         template <typename... Args>
         void wait(Args&&...) const {
             // this static assert stops compilation at this point with a
@@ -285,6 +364,18 @@ namespace concurrent_detail {
             // then go to sleep
             this->Super::wait(condition, proxy, lck, [&] { return int{}; });
         }
+        template <typename LockProxy, typename Clock, typename Duration>
+        bool wait_until(
+                Condition condition, LockProxy& proxy,
+                const std::chrono::time_point<Clock, Duration>& deadline,
+                WriteLockTag) {
+            auto lck = std::unique_lock<Mutex>{proxy.instance_ptr->mtx,
+                std::adopt_lock};
+            auto deferred = sharp::defer([&]() { lck.release(); });
+            this->Super::notify_all(proxy, WriteLockTag{});
+            return this->Super::wait_until(condition, proxy, lck,
+                                           [&] { return int{}; }, deadline);
+        }
     };
 
     /**
@@ -332,6 +423,34 @@ namespace concurrent_detail {
             this->Super::wait(condition, proxy, lck, [&] { return int{}; });
         }
 
+        /**
+         * Timed versions of the above
+         */
+        template <typename LockProxy, typename Clock, typename Duration>
+        bool wait_until(
+                Condition condition, LockProxy& proxy,
+                const std::chrono::time_point<Clock, Duration>& deadline,
+                ReadLockTag) {
+            auto lck = sharp::UniqueLock<Mutex, sharp::SharedLock>{
+                proxy.instance_ptr->mtx, std::adopt_lock};
+            auto deferred = sharp::defer([&]() { lck.release(); });
+            return this->Super::wait_until(condition, proxy, lck, [&]() {
+                return sharp::UniqueLock<Mutex>{this->mtx};
+            }, deadline);
+        }
+        template <typename LockProxy, typename Clock, typename Duration>
+        bool wait_until(
+                Condition condition, LockProxy& proxy,
+                const std::chrono::time_point<Clock, Duration>& deadline,
+                WriteLockTag) {
+            auto lck = sharp::UniqueLock<Mutex, sharp::DefaultLock>{
+                proxy.instance_ptr->mtx, std::adopt_lock};
+            auto deferred = sharp::defer([&]() { lck.release(); });
+            this->Super::notify_all(proxy, WriteLockTag{});
+            return this->Super::wait_until(condition, proxy, lck,
+                                           [&] { return int{}; }, deadline);
+        }
+
     private:
         Mutex mtx;
     };
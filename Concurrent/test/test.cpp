@@ -4,8 +4,13 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <cassert>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
 
 using namespace sharp;
 using std::cout;
@@ -347,3 +352,88 @@ TEST(Concurrent, WaitSignal) {
         th.join();
     }
 }
+
+TEST(Concurrent, WaitTimed) {
+    auto concurrent = sharp::Concurrent<int>{0};
+
+    // nobody changes the value so this should time out with the lock held
+    {
+        auto lock = concurrent.lock();
+        EXPECT_FALSE(lock.wait_for([](auto& integer) {
+            return integer == 1;
+        }, std::chrono::milliseconds{10}));
+        EXPECT_EQ(*lock, 0);
+    }
+
+    for (auto i = 0; i < STRESS; ++i) {
+        *concurrent.lock() = 0;
+        auto th = std::thread{[&]() {
+            ++(*concurrent.lock());
+        }};
+
+        auto lock = concurrent.lock();
+        EXPECT_TRUE(lock.wait_until([](auto& integer) {
+            return integer == 1;
+        }, std::chrono::steady_clock::now() + std::chrono::seconds{10}));
+        EXPECT_EQ(*lock, 1);
+        lock.unlock();
+        th.join();
+    }
+}
+
+TEST(Concurrent, WaitDifferentConditions) {
+    // every thread waits for its own value, and only wakes up once the
+    // value is set to it
+    for (auto i = 0; i < STRESS / 10; ++i) {
+        const auto THREADS = 8;
+        auto concurrent = sharp::Concurrent<int>{0};
+        auto woken = sharp::Concurrent<int>{0};
+
+        auto threads = std::vector<std::thread>{};
+        for (auto t = 1; t <= THREADS; ++t) {
+            threads.push_back(std::thread{[&, t]() {
+                auto lock = concurrent.lock();
+                lock.wait(t % 2 ? +[](const int& value) { return value >= 1; }
+                                : +[](const int& value) { return value >= 2; });
+                EXPECT_GE(*lock, 2 - t % 2);
+                lock.unlock();
+                ++(*woken.lock());
+            }});
+        }
+
+        *concurrent.lock() = 1;
+        woken.lock().wait([](auto& value) { return value >= THREADS / 2; });
+        *concurrent.lock() = 2;
+        woken.lock().wait([](auto& value) { return value == THREADS; });
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+}
+
+TEST(Concurrent, WaitShared) {
+    for (auto i = 0; i < STRESS / 10; ++i) {
+        const auto THREADS = 4;
+        auto concurrent = sharp::Concurrent<bool, std::shared_timed_mutex,
+                                            std::condition_variable_any>{};
+        auto signal = sharp::Concurrent<int>{0};
+
+        // readers wait with a shared lock held
+        auto threads = std::vector<std::thread>{};
+        for (auto t = 0; t < THREADS; ++t) {
+            threads.push_back(std::thread{[&]() {
+                auto lock = sharp::as_const(concurrent).lock();
+                lock.wait([](auto& go) { return go; });
+                EXPECT_TRUE(*lock);
+                lock.unlock();
+                ++(*signal.lock());
+            }});
+        }
+
+        concurrent.synchronized([](auto& go) { go = true; });
+        signal.lock().wait([](auto& value) { return value == THREADS; });
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+}
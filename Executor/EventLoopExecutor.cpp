@@ -0,0 +1,154 @@
+#include <sharp/Executor/EventLoopExecutor.hpp>
+#include <sharp/Executor/detail/ThreadName.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace sharp {
+
+EventLoopExecutor::EventLoopExecutor() : EventLoopExecutor{Options{}} {}
+
+EventLoopExecutor::EventLoopExecutor(Options options_in)
+        : options{std::move(options_in)} {
+#if defined(__linux__)
+    this->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (this->event_fd == -1) {
+        throw std::system_error{errno, std::system_category(),
+                                "sharp::EventLoopExecutor: eventfd"};
+    }
+    this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (this->epoll_fd == -1) {
+        auto error = errno;
+        close(this->event_fd);
+        throw std::system_error{error, std::system_category(),
+                                "sharp::EventLoopExecutor: epoll_create1"};
+    }
+    auto event = epoll_event{};
+    event.events = EPOLLIN;
+    event.data.fd = this->event_fd;
+    if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->event_fd, &event)) {
+        auto error = errno;
+        close(this->epoll_fd);
+        close(this->event_fd);
+        throw std::system_error{error, std::system_category(),
+                                "sharp::EventLoopExecutor: epoll_ctl"};
+    }
+#endif
+
+    this->thread = std::thread{[this]() { this->run(); }};
+}
+
+EventLoopExecutor::~EventLoopExecutor() {
+    this->stopping.store(true);
+    this->wake();
+    this->thread.join();
+
+#if defined(__linux__)
+    close(this->epoll_fd);
+    close(this->event_fd);
+#endif
+}
+
+void EventLoopExecutor::add(sharp::Function<void()> closure) {
+    this->pending.fetch_add(1, std::memory_order_relaxed);
+    this->queue.push(new Node{std::move(closure)});
+
+    // only the thread that finds the loop asleep wakes it up, everyone else
+    // adding closures while it is awake or already being woken skips that
+    if (this->sleeping.load() && this->sleeping.exchange(false)) {
+        this->wake();
+    }
+}
+
+std::size_t EventLoopExecutor::num_pending_closures() const {
+    return this->pending.load(std::memory_order_relaxed);
+}
+
+bool EventLoopExecutor::is_loop_thread() const noexcept {
+    return std::this_thread::get_id() == this->thread.get_id();
+}
+
+void EventLoopExecutor::run() {
+    detail::set_thread_name(this->options.name);
+
+    while (true) {
+
+        // run everything in the queue, a node that has been pushed but not
+        // linked yet will be reachable in a moment so wait for it
+        while (!this->queue.empty()) {
+            auto node = static_cast<Node*>(this->queue.pop());
+            if (!node) {
+                std::this_thread::yield();
+                continue;
+            }
+            this->pending.fetch_sub(1, std::memory_order_relaxed);
+            node->closure();
+            delete node;
+        }
+
+        if (this->stopping.load()) {
+            return;
+        }
+
+        // announce that the loop is going to sleep and then check the queue
+        // once more, a closure added before the announcement is seen here
+        // and one added after it wakes the loop up.  If a producer took the
+        // announcement back it is going to wake the loop up, so sleeping
+        // consumes that wakeup
+        this->sleeping.store(true);
+        if (this->queue.empty() && !this->stopping.load()) {
+            this->sleep();
+        } else if (!this->sleeping.exchange(false)) {
+            this->sleep();
+        }
+    }
+}
+
+void EventLoopExecutor::sleep() {
+#if defined(__linux__)
+    auto event = epoll_event{};
+    while (epoll_wait(this->epoll_fd, &event, 1, -1) == -1) {
+        if (errno != EINTR) {
+            throw std::system_error{errno, std::system_category(),
+                                    "sharp::EventLoopExecutor: epoll_wait"};
+        }
+    }
+    auto count = std::uint64_t{0};
+    auto bytes = read(this->event_fd, &count, sizeof(count));
+    static_cast<void>(bytes);
+#else
+    auto lck = std::unique_lock<std::mutex>{this->mtx};
+    while (!this->woken) {
+        this->cv.wait(lck);
+    }
+    this->woken = false;
+#endif
+    this->sleeping.store(false);
+}
+
+void EventLoopExecutor::wake() {
+#if defined(__linux__)
+    auto count = std::uint64_t{1};
+    auto bytes = write(this->event_fd, &count, sizeof(count));
+    static_cast<void>(bytes);
+#else
+    {
+        auto lck = std::unique_lock<std::mutex>{this->mtx};
+        this->woken = true;
+    }
+    this->cv.notify_one();
+#endif
+}
+
+} // namespace sharp
@@ -0,0 +1,139 @@
+/**
+ * @file EventLoopExecutor.hpp
+ * @author Aaryaman Sagar
+ *
+ * An executor that runs every closure on one thread of its own, so state
+ * that is only touched from closures run here needs no locking
+ */
+
+#pragma once
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Executor/detail/MpscQueue.hpp>
+#include <sharp/Functional/Functional.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sharp {
+
+/**
+ * @class EventLoopExecutor
+ *
+ * Closures run on the loop thread one after the other in the order they
+ * were added.  This is the executor for state owned by one thread, like the
+ * state of a connection handled by an IO thread, continuations sent back to
+ * that thread with via() can use the state without locks
+ *
+ *      auto loop = sharp::EventLoopExecutor{};
+ *      fetch(request).via(&loop).then([&connection](auto response) {
+ *          // runs on the loop thread, like everything else that touches
+ *          // connection
+ *          connection.write(response.get());
+ *      });
+ *
+ * Closures are handed to the loop through a lock free queue, so adding one
+ * does not take a lock and does not wait on other threads adding closures.
+ * The loop runs everything it finds in the queue before it goes to sleep,
+ * and it is only woken up (through an eventfd on Linux and a condition
+ * variable elsewhere) when a closure is added while it is asleep.  So a
+ * burst of closures costs at most one wakeup
+ *
+ * The destructor runs every closure that has been added before joining the
+ * loop thread, so it must not be called from the loop thread.  Closures must
+ * not throw, an exception escaping a closure terminates the program
+ */
+class EventLoopExecutor : public Executor {
+public:
+
+    /**
+     * The configuration for the loop, the thread is named name where the
+     * platform supports it
+     */
+    struct Options {
+        std::string name{"sharp-loop"};
+    };
+
+    /**
+     * Start the loop thread, this throws a std::system_error if the
+     * descriptors used to wake the loop up cannot be created
+     */
+    EventLoopExecutor();
+    explicit EventLoopExecutor(Options options);
+
+    /**
+     * Runs everything that has been added and joins the loop thread
+     */
+    ~EventLoopExecutor() override;
+
+    EventLoopExecutor(const EventLoopExecutor&) = delete;
+    EventLoopExecutor(EventLoopExecutor&&) = delete;
+    EventLoopExecutor& operator=(const EventLoopExecutor&) = delete;
+    EventLoopExecutor& operator=(EventLoopExecutor&&) = delete;
+
+    /**
+     * Schedule the closure to run on the loop thread, this can be called
+     * from any thread including the loop thread
+     */
+    void add(sharp::Function<void()> closure) override;
+
+    /**
+     * The number of closures that have been added but have not started
+     * running yet
+     */
+    std::size_t num_pending_closures() const override;
+
+    /**
+     * Returns true if called from the loop thread, handlers that rely on
+     * running there can assert on this
+     */
+    bool is_loop_thread() const noexcept;
+
+private:
+    using Closure = sharp::Function<void()>;
+
+    /**
+     * A closure in the queue
+     */
+    struct Node : detail::MpscNode {
+        explicit Node(Closure closure_in) : closure{std::move(closure_in)} {}
+        Closure closure;
+    };
+
+    /**
+     * The loop the thread runs, and what it does when the queue is empty.
+     * sleep() returns right away if a closure was added after the loop
+     * decided to sleep
+     */
+    void run();
+    void sleep();
+    void wake();
+
+    Options options;
+    detail::MpscQueue queue;
+    std::atomic<std::size_t> pending{0};
+
+    /**
+     * sleeping is set by the loop before it checks the queue one last time
+     * and goes to sleep, a thread that adds a closure and then sees it set
+     * is the one that wakes the loop up
+     */
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> stopping{false};
+#if defined(__linux__)
+    int event_fd{-1};
+    int epoll_fd{-1};
+#else
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool woken{false};
+#endif
+
+    std::thread thread;
+};
+
+} // namespace sharp
@@ -0,0 +1,102 @@
+#include <sharp/Executor/InlineExecutor.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace sharp {
+
+namespace {
+
+    /**
+     * The closures run by inline executors on the current thread, depth is
+     * how many of them are nested on the stack and queued holds the ones
+     * that were added too deep to run right away.  exception is the first
+     * exception thrown by a queued closure, the outermost add() rethrows it
+     */
+    struct Trampoline {
+        int depth{0};
+        std::deque<sharp::Function<void()>> queued;
+        std::exception_ptr exception;
+    };
+    Trampoline& trampoline() {
+        static thread_local Trampoline state;
+        return state;
+    }
+
+    /**
+     * Run the closure one level deeper, the level is given back even if the
+     * closure throws
+     */
+    void run_nested(Trampoline& state, sharp::Function<void()>& closure) {
+        ++state.depth;
+        try {
+            closure();
+        } catch (...) {
+            --state.depth;
+            throw;
+        }
+        --state.depth;
+    }
+
+    /**
+     * Run the queued closures in the order they were queued, each one level
+     * deeper than the caller.  A closure throwing does not stop the rest
+     * from running, the first exception is kept for the outermost add()
+     */
+    void drain(Trampoline& state) {
+        while (!state.queued.empty()) {
+            auto closure = std::move(state.queued.front());
+            state.queued.pop_front();
+            try {
+                run_nested(state, closure);
+            } catch (...) {
+                if (!state.exception) {
+                    state.exception = std::current_exception();
+                }
+            }
+        }
+    }
+
+} // namespace <anonymous>
+
+constexpr int InlineExecutor::default_max_depth;
+
+InlineExecutor::InlineExecutor(int max_depth_in) : max_depth{max_depth_in} {
+    if (this->max_depth < 1) {
+        throw std::invalid_argument{"sharp::InlineExecutor: the maximum "
+                                    "depth must be at least 1"};
+    }
+}
+
+void InlineExecutor::add(sharp::Function<void()> closure) {
+    auto& state = trampoline();
+    if (state.depth >= this->max_depth) {
+        state.queued.push_back(std::move(closure));
+        return;
+    }
+
+    // only the outermost closure on the stack drains the queue, so the
+    // queued closures do not get any deeper than the ones that queued them
+    if (state.depth) {
+        run_nested(state, closure);
+        return;
+    }
+    try {
+        run_nested(state, closure);
+    } catch (...) {
+        state.exception = std::current_exception();
+    }
+    drain(state);
+    if (state.exception) {
+        std::rethrow_exception(std::exchange(state.exception, nullptr));
+    }
+}
+
+std::size_t InlineExecutor::num_pending_closures() const {
+    return trampoline().queued.size();
+}
+
+} // namespace sharp
@@ -2,9 +2,9 @@
  * @file InlineExecutor.hpp
  * @author Aaryaman Sagar
  *
- * The simplest possible implementation of the Executor interface, all
- * callbacks are executed immediately on calling the .add() function on the
- * current thread
+ * The simplest possible implementation of the Executor interface, callbacks
+ * are executed on the current thread by the .add() function, right away
+ * unless they are nested too deep
  */
 
 #pragma once
@@ -16,29 +16,64 @@
 
 namespace sharp {
 
+/**
+ * @class InlineExecutor
+ *
+ * Closures run on the thread that adds them, before add() returns.  Except
+ * that a closure added from inside closures that are already nested
+ * max_depth deep on this thread is queued instead, and run as soon as the
+ * outermost add() on this thread has run its closure, before it returns.
+ * This keeps a long chain of continuations that fulfil each other from
+ * growing the stack with every link, it runs in rounds of bounded depth
+ * one after the other instead
+ *
+ * The queue is per thread, and shared by every inline executor on the
+ * thread.  If a closure throws the exception propagates out of the add()
+ * that ran it.  Closures queued under the outermost add() all run even if
+ * some of them throw, and the first exception thrown by any of them is
+ * rethrown from the outermost add() once the queue is empty
+ *
+ * So a closure nested max_depth deep must not block waiting on something
+ * that a closure it added has to do, like fulfilling a future through a
+ * continuation on an inline executor.  The closure it added only runs
+ * after it returns, so that deadlocks
+ */
 class InlineExecutor : public Executor {
 public:
 
     /**
-     * Destructor does nothing as there is no state to maintain here, all
-     * functions are executed immediately
+     * The depth past which closures are queued, by default and for the
+     * executor returned by get()
+     */
+    static constexpr int default_max_depth = 16;
+
+    /**
+     * Construct an executor that queues closures past max_depth nested
+     * closures, this throws a std::invalid_argument if max_depth is less
+     * than 1
+     */
+    explicit InlineExecutor(int max_depth = default_max_depth);
+
+    /**
+     * Destructor does nothing as there is no state to maintain here, the
+     * queue of closures that were nested too deep is per thread and not per
+     * executor
      */
     ~InlineExecutor() override {}
 
     /**
-     * Do the thing
+     * Run the closure, or queue it if this is max_depth closures deep.  A
+     * queued closure has not run yet when add() returns, so code that needs
+     * its effects right after add() only sees them when not nested this deep
      */
-    void add(sharp::Function<void()> closure) override {
-        closure();
-    }
+    void add(sharp::Function<void()> closure) override;
 
     /**
-     * At all times there are no pending closures in this executor, as all of
-     * them are executed immediately
+     * The number of closures queued on the calling thread, closures only
+     * wait on the thread that added them and have all run by the time the
+     * outermost add() returns.  So this is 0 except from inside a closure
      */
-    std::size_t num_pending_closures() const override {
-        return 0;
-    }
+    std::size_t num_pending_closures() const override;
 
     /**
      * Returns the thread singleton inline executor instance
@@ -48,6 +83,8 @@ public:
         return &executor;
     }
 
+private:
+    int max_depth;
 };
 
 } // namespace sharp
@@ -0,0 +1,143 @@
+#include <sharp/Executor/InstrumentedExecutor.hpp>
+#include <sharp/Defer/Defer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace sharp {
+
+namespace {
+
+    /**
+     * Returns the bucket a duration goes in, the number of bits needed to
+     * represent it
+     */
+    std::size_t bucket_for(std::uint64_t nanoseconds) noexcept {
+        if (!nanoseconds) {
+            return 0;
+        }
+#if defined(__GNUC__)
+        return 64 - static_cast<std::size_t>(__builtin_clzll(nanoseconds));
+#else
+        auto bits = std::size_t{0};
+        while (nanoseconds) {
+            ++bits;
+            nanoseconds >>= 1;
+        }
+        return bits;
+#endif
+    }
+
+} // namespace <anonymous>
+
+constexpr std::size_t InstrumentedExecutor::Histogram::number_buckets;
+
+std::chrono::nanoseconds
+InstrumentedExecutor::Histogram::percentile(double fraction) const {
+    if (!this->count) {
+        return std::chrono::nanoseconds{0};
+    }
+    fraction = std::min(std::max(fraction, 0.0), 1.0);
+
+    // find the bucket the duration of that rank is in, and return the
+    // largest duration that bucket can hold
+    auto rank = static_cast<std::uint64_t>(fraction * (this->count - 1)) + 1;
+    auto seen = std::uint64_t{0};
+    auto bucket = std::size_t{0};
+    for (; bucket < number_buckets; ++bucket) {
+        seen += this->buckets[bucket];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    bucket = std::min(bucket, number_buckets - 1);
+    auto limit = (std::uint64_t{1} << bucket) - 1;
+    return std::chrono::nanoseconds{
+        static_cast<std::chrono::nanoseconds::rep>(limit)};
+}
+
+std::chrono::nanoseconds InstrumentedExecutor::Histogram::mean() const {
+    if (!this->count) {
+        return std::chrono::nanoseconds{0};
+    }
+    return this->total / this->count;
+}
+
+void InstrumentedExecutor::AtomicHistogram::record(
+        std::chrono::nanoseconds duration) noexcept {
+    auto nanoseconds = static_cast<std::uint64_t>(
+        std::max(duration.count(), std::chrono::nanoseconds::rep{0}));
+    this->buckets[bucket_for(nanoseconds)].fetch_add(
+        1, std::memory_order_relaxed);
+    this->total.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+InstrumentedExecutor::Histogram
+InstrumentedExecutor::AtomicHistogram::load() const noexcept {
+    auto histogram = Histogram{};
+    for (auto i = std::size_t{0}; i < Histogram::number_buckets; ++i) {
+        auto count = this->buckets[i].load(std::memory_order_relaxed);
+        histogram.buckets[i] = count;
+        histogram.count += count;
+    }
+
+    // the count is the sum of the buckets that were read, so the count and
+    // the buckets always agree with each other
+    auto total = this->total.load(std::memory_order_relaxed);
+    histogram.total = std::chrono::nanoseconds{
+        static_cast<std::chrono::nanoseconds::rep>(total)};
+    return histogram;
+}
+
+InstrumentedExecutor::InstrumentedExecutor(Executor* executor_in)
+        : executor{executor_in} {
+    if (!this->executor) {
+        throw std::invalid_argument{
+            "sharp::InstrumentedExecutor needs an executor to wrap"};
+    }
+}
+
+void InstrumentedExecutor::add(sharp::Function<void()> closure) {
+    this->added.fetch_add(1, std::memory_order_release);
+    auto added_at = std::chrono::steady_clock::now();
+
+    auto timed = [this, added_at, closure = std::move(closure)]() mutable {
+        auto started_at = std::chrono::steady_clock::now();
+        this->queue_latency.record(started_at - added_at);
+        this->started.fetch_add(1, std::memory_order_release);
+
+        auto deferred = sharp::defer([&]() {
+            this->run_time.record(
+                std::chrono::steady_clock::now() - started_at);
+            this->finished.fetch_add(1, std::memory_order_release);
+        });
+        closure();
+    };
+    this->executor->add(std::move(timed));
+}
+
+std::size_t InstrumentedExecutor::num_pending_closures() const {
+    return this->executor->num_pending_closures();
+}
+
+InstrumentedExecutor::Snapshot InstrumentedExecutor::snapshot() const {
+    // read in the opposite order of the updates, so a snapshot never shows
+    // more closures finished than started or started than added
+    auto snapshot = Snapshot{};
+    snapshot.finished = this->finished.load(std::memory_order_acquire);
+    snapshot.run_time = this->run_time.load();
+    snapshot.started = this->started.load(std::memory_order_acquire);
+    snapshot.queue_latency = this->queue_latency.load();
+    snapshot.added = this->added.load(std::memory_order_acquire);
+    return snapshot;
+}
+
+Executor* InstrumentedExecutor::get_executor() const noexcept {
+    return this->executor;
+}
+
+} // namespace sharp
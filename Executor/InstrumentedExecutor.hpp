@@ -0,0 +1,150 @@
+/**
+ * @file InstrumentedExecutor.hpp
+ * @author Aaryaman Sagar
+ *
+ * An executor that forwards closures to another executor and measures how
+ * long they waited to be run and how long they took to run
+ */
+
+#pragma once
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Functional/Functional.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sharp {
+
+/**
+ * @class InstrumentedExecutor
+ *
+ * A decorator over any other executor, closures added here are added to the
+ * wrapped executor and timed when they run
+ *
+ *      sharp::ThreadPoolExecutor pool{4};
+ *      sharp::InstrumentedExecutor instrumented{&pool};
+ *      future.via(&instrumented).then([](auto f) { ... });
+ *
+ *      auto snapshot = instrumented.snapshot();
+ *      std::cout << snapshot.queue_latency.percentile(0.99).count() << ' '
+ *                << snapshot.run_time.percentile(0.99).count() << '\n';
+ *
+ * A high queue latency with short run times means the wrapped executor does
+ * not have enough threads for the load, and long run times mean the
+ * closures themselves are slow
+ *
+ * Recording a closure is a few atomic increments, and snapshot() can be
+ * called from any thread while closures are being added and run.  The
+ * counters in a snapshot are read one after the other without stopping the
+ * executor, so they might be off by the closures that ran while the
+ * snapshot was being taken
+ *
+ * The instrumented executor must outlive every closure added through it
+ */
+class InstrumentedExecutor : public Executor {
+public:
+
+    /**
+     * Durations bucketed by their order of magnitude, bucket i holds the
+     * durations that are at least 2^(i - 1) and less than 2^i nanoseconds,
+     * and bucket 0 holds the ones that were 0 nanoseconds
+     */
+    struct Histogram {
+        static constexpr std::size_t number_buckets = 64;
+
+        /**
+         * Returns an upper bound on the given fraction (between 0 and 1) of
+         * the durations, this is exact to within a factor of two.  Returns 0
+         * if nothing has been recorded
+         */
+        std::chrono::nanoseconds percentile(double fraction) const;
+
+        /**
+         * Returns the average of all the durations recorded, or 0 if nothing
+         * has been recorded
+         */
+        std::chrono::nanoseconds mean() const;
+
+        std::array<std::uint64_t, number_buckets> buckets{};
+        std::uint64_t count{0};
+        std::chrono::nanoseconds total{0};
+    };
+
+    /**
+     * The counters of the executor at some point in time.  added counts the
+     * closures that have been added, started the ones that have started
+     * running and finished the ones that have finished running
+     */
+    struct Snapshot {
+        std::uint64_t added{0};
+        std::uint64_t started{0};
+        std::uint64_t finished{0};
+
+        /**
+         * The time between a closure being added and it starting to run,
+         * and the time it took to run
+         */
+        Histogram queue_latency;
+        Histogram run_time;
+    };
+
+    /**
+     * Wrap the given executor, this throws a std::invalid_argument if the
+     * executor is null.  The wrapped executor is not owned, and must outlive
+     * the instrumented one
+     */
+    explicit InstrumentedExecutor(Executor* executor);
+
+    ~InstrumentedExecutor() override {}
+
+    InstrumentedExecutor(const InstrumentedExecutor&) = delete;
+    InstrumentedExecutor& operator=(const InstrumentedExecutor&) = delete;
+
+    /**
+     * Add the closure to the wrapped executor, timing it when it runs
+     */
+    void add(sharp::Function<void()> closure) override;
+
+    /**
+     * Returns the number of pending closures in the wrapped executor
+     */
+    std::size_t num_pending_closures() const override;
+
+    /**
+     * Read the counters, this can be called from any thread at any time
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * Returns the executor closures are forwarded to
+     */
+    Executor* get_executor() const noexcept;
+
+private:
+
+    /**
+     * The shared version of Histogram that closures record into, the count
+     * is not stored and is the sum of the buckets instead
+     */
+    struct alignas(64) AtomicHistogram {
+        void record(std::chrono::nanoseconds duration) noexcept;
+        Histogram load() const noexcept;
+
+        std::array<std::atomic<std::uint64_t>, Histogram::number_buckets>
+            buckets{};
+        std::atomic<std::uint64_t> total{0};
+    };
+
+    Executor* executor;
+    std::atomic<std::uint64_t> added{0};
+    std::atomic<std::uint64_t> started{0};
+    std::atomic<std::uint64_t> finished{0};
+    AtomicHistogram queue_latency;
+    AtomicHistogram run_time;
+};
+
+} // namespace sharp
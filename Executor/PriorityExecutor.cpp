@@ -0,0 +1,218 @@
+#include <sharp/Executor/PriorityExecutor.hpp>
+#include <sharp/Executor/detail/ThreadName.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace sharp {
+
+PriorityExecutor::PriorityExecutor(int threads)
+    : PriorityExecutor{Options{threads}} {}
+
+PriorityExecutor::PriorityExecutor(Options options_in)
+        : options{std::move(options_in)} {
+    if (this->options.threads < 1) {
+        throw std::invalid_argument{"sharp::PriorityExecutor: the number "
+                                    "of threads must be at least 1"};
+    }
+    if (this->options.priorities < 1) {
+        throw std::invalid_argument{"sharp::PriorityExecutor: the number "
+                                    "of priorities must be at least 1"};
+    }
+    if (this->options.default_priority >= this->options.priorities) {
+        throw std::invalid_argument{"sharp::PriorityExecutor: the default "
+                                    "priority must be one of the priorities"};
+    }
+    if (this->options.starvation_limit < 1) {
+        throw std::invalid_argument{"sharp::PriorityExecutor: the starvation "
+                                    "limit must be at least 1"};
+    }
+    if (this->options.queue_capacity < 1) {
+        throw std::invalid_argument{"sharp::PriorityExecutor: the queue "
+                                    "capacity must be at least 1"};
+    }
+
+    for (auto i = std::size_t{0}; i < this->options.priorities; ++i) {
+        this->levels.push_back(std::make_unique<Level>(
+                    this, i, this->options.queue_capacity));
+    }
+
+    try {
+        for (auto i = 0; i < this->options.threads; ++i) {
+            this->threads.emplace_back([this, i]() { this->work(i); });
+        }
+    } catch (...) {
+        // stop and join whatever workers did start
+        this->idle.stop();
+        for (auto& thread : this->threads) {
+            thread.join();
+        }
+        throw;
+    }
+}
+
+PriorityExecutor::~PriorityExecutor() {
+    this->idle.stop();
+    for (auto& thread : this->threads) {
+        thread.join();
+    }
+}
+
+void PriorityExecutor::add(sharp::Function<void()> closure) {
+    this->add(std::move(closure), this->options.default_priority);
+}
+
+void PriorityExecutor::add(sharp::Function<void()> closure,
+                           std::size_t priority) {
+    this->check_priority(priority);
+    auto& level = *this->levels[priority];
+    auto pointer = std::make_unique<Closure>(std::move(closure));
+    level.push(pointer.get());
+    pointer.release();
+
+    // the closure has to be visible to the workers before it is counted,
+    // see IdleWorkers
+    level.pending.fetch_add(1);
+    this->idle.add_pending();
+}
+
+Executor* PriorityExecutor::with_priority(std::size_t priority) {
+    this->check_priority(priority);
+    return this->levels[priority].get();
+}
+
+std::size_t PriorityExecutor::num_pending_closures() const {
+    return this->idle.num_pending();
+}
+
+std::size_t PriorityExecutor::num_pending_closures(std::size_t priority)
+        const {
+    this->check_priority(priority);
+    return this->levels[priority]->num_pending_closures();
+}
+
+std::size_t PriorityExecutor::num_priorities() const noexcept {
+    return this->options.priorities;
+}
+
+int PriorityExecutor::num_threads() const noexcept {
+    return this->options.threads;
+}
+
+PriorityExecutor::Level::Level(PriorityExecutor* executor_in,
+                               std::size_t priority_in,
+                               std::size_t capacity)
+    : executor{executor_in}, priority{priority_in}, queue{capacity} {}
+
+void PriorityExecutor::Level::add(sharp::Function<void()> closure) {
+    this->executor->add(std::move(closure), this->priority);
+}
+
+std::size_t PriorityExecutor::Level::num_pending_closures() const {
+    auto pending = this->pending.load();
+    return (pending > 0) ? static_cast<std::size_t>(pending) : 0;
+}
+
+void PriorityExecutor::Level::push(Closure* closure) {
+    // once closures have spilled over the ones after them follow, till the
+    // workers have drained the spill list, so they are taken in order
+    if (!this->spilled.load() && this->queue.try_push(closure)) {
+        return;
+    }
+    auto lck = std::unique_lock<std::mutex>{this->spill_mtx};
+    this->spill.push_back(closure);
+    this->spilled.fetch_add(1);
+}
+
+PriorityExecutor::Closure* PriorityExecutor::Level::pop() {
+    auto closure = static_cast<Closure*>(nullptr);
+    if (this->queue.try_pop(closure)) {
+        return closure;
+    }
+    if (!this->spilled.load()) {
+        return nullptr;
+    }
+    auto lck = std::unique_lock<std::mutex>{this->spill_mtx};
+    if (this->spill.empty()) {
+        return nullptr;
+    }
+    closure = this->spill.front();
+    this->spill.pop_front();
+    this->spilled.fetch_sub(1);
+    return closure;
+}
+
+void PriorityExecutor::check_priority(std::size_t priority) const {
+    if (priority >= this->options.priorities) {
+        throw std::out_of_range{"sharp::PriorityExecutor: priority "
+                                + std::to_string(priority)
+                                + " is not one of the priorities"};
+    }
+}
+
+void PriorityExecutor::work(int index) {
+    detail::set_thread_name(this->options.name + "-" + std::to_string(index));
+
+    while (true) {
+        if (auto closure = this->pick()) {
+            auto owned = std::unique_ptr<Closure>{closure};
+            (*owned)();
+            continue;
+        }
+        if (!this->idle.wait()) {
+            return;
+        }
+    }
+}
+
+PriorityExecutor::Closure* PriorityExecutor::pick() {
+    // the most urgent queue with work goes first, unless a less urgent one
+    // has been passed over too many times.  Every queue with work that is
+    // passed over this time around counts it
+    auto chosen = static_cast<Level*>(nullptr);
+    auto starving = static_cast<Level*>(nullptr);
+    for (auto& level : this->levels) {
+        if (level->pending.load() <= 0) {
+            level->passed_over.store(0);
+            continue;
+        }
+        if (!chosen) {
+            chosen = level.get();
+            continue;
+        }
+        auto limit = this->options.starvation_limit;
+        if (!starving && level->passed_over.load() >= limit) {
+            starving = level.get();
+        }
+    }
+    if (!chosen) {
+        return nullptr;
+    }
+    if (starving) {
+        chosen = starving;
+    }
+
+    // another worker might have taken the last closure in the queue since
+    // it was looked at, the caller looks again then
+    auto closure = chosen->pop();
+    if (!closure) {
+        return nullptr;
+    }
+    chosen->passed_over.store(0);
+    for (auto i = chosen->priority + 1; i < this->levels.size(); ++i) {
+        if (this->levels[i]->pending.load() > 0) {
+            this->levels[i]->passed_over.fetch_add(1);
+        }
+    }
+    chosen->pending.fetch_sub(1);
+    this->idle.remove_pending();
+    return closure;
+}
+
+} // namespace sharp
@@ -0,0 +1,195 @@
+/**
+ * @file PriorityExecutor.hpp
+ * @author Aaryaman Sagar
+ *
+ * An executor that runs closures on a fixed set of worker threads in order
+ * of their priority, so latency sensitive work does not wait behind bulk
+ * work sharing the same threads
+ */
+
+#pragma once
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Executor/detail/IdleWorkers.hpp>
+#include <sharp/Executor/detail/MpmcQueue.hpp>
+#include <sharp/Functional/Functional.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sharp {
+
+/**
+ * @class PriorityExecutor
+ *
+ * Closures are added with a priority, 0 is the most urgent and
+ * num_priorities() - 1 the least.  Every priority has a lock free queue of
+ * its own, and a worker that is free takes the oldest closure from the most
+ * urgent queue that has one
+ *
+ * Futures carry a priority through the executor they are given.
+ * with_priority() returns an executor that adds everything to this one at
+ * the given priority, so continuations scheduled with via() on it run at
+ * that priority, and so do the .then() calls chained after them
+ *
+ *      sharp::PriorityExecutor executor{4};
+ *      auto urgent = executor.with_priority(0);
+ *      auto bulk = executor.with_priority(2);
+ *
+ *      rpc(request).via(urgent).then(parse).then(reply);
+ *      read(file).via(bulk).then(compact);
+ *
+ * To keep a steady stream of urgent closures from starving the rest, a
+ * queue that has had work while starvation_limit closures were taken from
+ * more urgent queues goes first next time.  So every priority makes
+ * progress, and under load a less urgent one gets at least one closure in
+ * every starvation_limit + 1 taken from above it
+ *
+ * Neither adding nor taking a closure takes a lock.  The queue for each
+ * priority is a bounded lock free ring that every worker takes from, holding
+ * queue_capacity closures.  Closures added while a ring is full spill over
+ * into a list behind a lock, and the ones after them follow till the workers
+ * have caught up, so they still run in the order they were added.  Workers
+ * pick concurrently, so the starvation counts are approximate while several
+ * of them are picking at once
+ *
+ * The destructor runs every closure that has been added before joining the
+ * workers, so it must not be called from a worker thread.  Closures must not
+ * throw, an exception escaping a closure terminates the program
+ */
+class PriorityExecutor : public Executor {
+public:
+
+    /**
+     * The configuration for the executor
+     *
+     * priorities is the number of priorities, and closures added without a
+     * priority get default_priority.  queue_capacity is the size of the
+     * lock free ring for each priority.  Workers are named name + "-" + i,
+     * platforms cut thread names off at 15 characters
+     */
+    struct Options {
+        int threads{static_cast<int>(
+            std::max(1u, std::thread::hardware_concurrency()))};
+        std::size_t priorities{3};
+        std::size_t default_priority{1};
+        std::size_t starvation_limit{32};
+        std::string name{"sharp-priority"};
+        std::size_t queue_capacity{1024};
+    };
+
+    /**
+     * Start the workers, this throws a std::invalid_argument if the number
+     * of threads, the number of priorities, the starvation limit or the
+     * queue capacity is less than 1, or if the default priority is not one
+     * of the priorities
+     */
+    explicit PriorityExecutor(int threads);
+    explicit PriorityExecutor(Options options);
+
+    /**
+     * Runs everything that has been added and joins the workers
+     */
+    ~PriorityExecutor() override;
+
+    PriorityExecutor(const PriorityExecutor&) = delete;
+    PriorityExecutor(PriorityExecutor&&) = delete;
+    PriorityExecutor& operator=(const PriorityExecutor&) = delete;
+    PriorityExecutor& operator=(PriorityExecutor&&) = delete;
+
+    /**
+     * Schedule the closure to run at the default priority
+     */
+    void add(sharp::Function<void()> closure) override;
+
+    /**
+     * Schedule the closure to run at the given priority, this throws a
+     * std::out_of_range if the priority is not less than num_priorities()
+     */
+    void add(sharp::Function<void()> closure, std::size_t priority);
+
+    /**
+     * Returns an executor that adds closures here at the given priority, it
+     * lives as long as this one does.  This throws a std::out_of_range if
+     * the priority is not less than num_priorities()
+     */
+    Executor* with_priority(std::size_t priority);
+
+    /**
+     * The number of closures that have been added but have not started
+     * running yet, in total or at one priority
+     */
+    std::size_t num_pending_closures() const override;
+    std::size_t num_pending_closures(std::size_t priority) const;
+
+    /**
+     * The number of priorities and the number of worker threads
+     */
+    std::size_t num_priorities() const noexcept;
+    int num_threads() const noexcept;
+
+private:
+    using Closure = sharp::Function<void()>;
+
+    /**
+     * The queue for one priority, this is also the executor with_priority()
+     * returns for it.  Closures go into the ring unless it is full or
+     * closures have spilled over already, in which case they go into the
+     * spill list.  pending counts the closures in both, and passed_over is
+     * the number of closures that have been taken from more urgent queues
+     * while this one had work
+     */
+    class Level : public Executor {
+    public:
+        Level(PriorityExecutor* executor, std::size_t priority,
+              std::size_t capacity);
+
+        void add(sharp::Function<void()> closure) override;
+        std::size_t num_pending_closures() const override;
+
+        /**
+         * Add a closure to the queue and take the oldest one out, pop()
+         * returns nullptr if it comes up empty
+         */
+        void push(Closure* closure);
+        Closure* pop();
+
+        PriorityExecutor* const executor;
+        const std::size_t priority;
+        detail::MpmcQueue<Closure*> queue;
+        std::atomic<std::size_t> spilled{0};
+        std::mutex spill_mtx;
+        std::deque<Closure*> spill;
+        std::atomic<std::int64_t> pending{0};
+        std::atomic<std::size_t> passed_over{0};
+    };
+
+    /**
+     * The loop each worker runs, and the way it picks the next closure.
+     * pick() returns nullptr if it comes up empty, and a closure returned
+     * from there has been taken off the pending counts
+     */
+    void work(int index);
+    Closure* pick();
+    void check_priority(std::size_t priority) const;
+
+    Options options;
+    std::vector<std::unique_ptr<Level>> levels;
+    std::vector<std::thread> threads;
+
+    /**
+     * Closures added that have not been taken by a worker yet, and the state
+     * used to put workers to sleep
+     */
+    detail::IdleWorkers idle;
+};
+
+} // namespace sharp
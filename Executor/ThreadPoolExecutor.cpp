@@ -0,0 +1,182 @@
+#include <sharp/Executor/ThreadPoolExecutor.hpp>
+#include <sharp/Executor/detail/ThreadName.hpp>
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace sharp {
+
+namespace {
+
+    /**
+     * The pool the current thread is a worker of and its index in the pool,
+     * closures added from a worker go onto that worker's deque
+     */
+    thread_local ThreadPoolExecutor* current_pool{nullptr};
+    thread_local int current_index{-1};
+
+    /**
+     * Pin the current thread to a CPU, where the platform supports it
+     */
+    void set_thread_affinity(int cpu) {
+#if defined(__linux__)
+        auto cpus = cpu_set_t{};
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+        static_cast<void>(cpu);
+#endif
+    }
+
+    /**
+     * xorshift, picking a victim to steal from does not need anything better
+     */
+    std::uint64_t next_random(std::uint64_t& state) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+} // namespace <anonymous>
+
+ThreadPoolExecutor::ThreadPoolExecutor(int threads)
+    : ThreadPoolExecutor{Options{threads, {}, "sharp-pool"}} {}
+
+ThreadPoolExecutor::ThreadPoolExecutor(Options options_in)
+        : options{std::move(options_in)} {
+    if (this->options.threads < 1) {
+        throw std::invalid_argument{"sharp::ThreadPoolExecutor: the number "
+                                    "of threads must be at least 1"};
+    }
+
+    // every worker has to exist before any of them starts stealing
+    for (auto i = 0; i < this->options.threads; ++i) {
+        this->workers.push_back(std::make_unique<Worker>());
+        this->workers.back()->random_state
+            = 0x9e3779b97f4a7c15ull * static_cast<std::uint64_t>(i + 1);
+    }
+
+    try {
+        for (auto i = 0; i < this->options.threads; ++i) {
+            this->workers[i]->thread = std::thread{[this, i]() {
+                this->work(i);
+            }};
+        }
+    } catch (...) {
+        // stop and join whatever workers did start
+        this->idle.stop();
+        for (auto& worker : this->workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+        throw;
+    }
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() {
+    this->idle.stop();
+    for (auto& worker : this->workers) {
+        worker->thread.join();
+    }
+}
+
+void ThreadPoolExecutor::add(sharp::Function<void()> closure) {
+    auto pointer = std::make_unique<Closure>(std::move(closure));
+    if (current_pool == this) {
+        this->workers[current_index]->deque.push(pointer.get());
+    } else {
+        auto lck = std::unique_lock<std::mutex>{this->shared_mtx};
+        this->shared.push_back(pointer.get());
+    }
+    pointer.release();
+
+    // the closure has to be visible to the workers before it is counted,
+    // see IdleWorkers
+    this->idle.add_pending();
+}
+
+std::size_t ThreadPoolExecutor::num_pending_closures() const {
+    return this->idle.num_pending();
+}
+
+int ThreadPoolExecutor::num_threads() const noexcept {
+    return this->options.threads;
+}
+
+void ThreadPoolExecutor::work(int index) {
+    current_pool = this;
+    current_index = index;
+    detail::set_thread_name(this->options.name + "-" + std::to_string(index));
+    if (!this->options.cpus.empty()) {
+        auto cpus = this->options.cpus.size();
+        set_thread_affinity(this->options.cpus[index % cpus]);
+    }
+
+    auto& worker = *this->workers[index];
+    while (true) {
+        if (auto closure = this->find_work(worker)) {
+            auto owned = std::unique_ptr<Closure>{closure};
+            (*owned)();
+            continue;
+        }
+
+        if (!this->idle.wait()) {
+            return;
+        }
+    }
+}
+
+ThreadPoolExecutor::Closure* ThreadPoolExecutor::find_work(Worker& worker) {
+    auto closure = worker.deque.pop();
+    if (!closure) {
+        closure = this->pop_shared();
+    }
+    if (!closure) {
+        closure = this->steal(worker);
+    }
+    if (closure) {
+        this->idle.remove_pending();
+    }
+    return closure;
+}
+
+ThreadPoolExecutor::Closure* ThreadPoolExecutor::pop_shared() {
+    auto lck = std::unique_lock<std::mutex>{this->shared_mtx};
+    if (this->shared.empty()) {
+        return nullptr;
+    }
+    auto closure = this->shared.front();
+    this->shared.pop_front();
+    return closure;
+}
+
+ThreadPoolExecutor::Closure* ThreadPoolExecutor::steal(Worker& worker) {
+    auto size = this->workers.size();
+    auto start = next_random(worker.random_state) % size;
+    for (auto i = std::size_t{0}; i < size; ++i) {
+        auto& victim = *this->workers[(start + i) % size];
+        if (&victim == &worker) {
+            continue;
+        }
+        if (auto closure = victim.deque.steal()) {
+            return closure;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace sharp
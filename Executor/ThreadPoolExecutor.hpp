@@ -0,0 +1,143 @@
+/**
+ * @file ThreadPoolExecutor.hpp
+ * @author Aaryaman Sagar
+ *
+ * An executor that runs closures on a fixed set of worker threads, idle
+ * workers steal work from busy ones
+ */
+
+#pragma once
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Executor/detail/IdleWorkers.hpp>
+#include <sharp/Executor/detail/WorkStealingDeque.hpp>
+#include <sharp/Functional/Functional.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sharp {
+
+/**
+ * @class ThreadPoolExecutor
+ *
+ * Every worker thread has a Chase-Lev deque of its own.  Closures added from
+ * a worker thread (for example the continuations of futures that are
+ * fulfilled on that worker) are pushed onto that worker's deque and run by
+ * it next, while their data is still in its cache.  Closures added from
+ * other threads go into a queue shared by all the workers
+ *
+ * A worker looks for work in its own deque first, then in the shared queue,
+ * and then tries to steal the oldest closure from the other workers' deques,
+ * starting at a random one.  Workers that find nothing go to sleep till more
+ * closures are added
+ *
+ *      auto executor = sharp::ThreadPoolExecutor{4};
+ *      auto future = promise.get_future().via(&executor).then([](auto f) {
+ *          // runs on one of the 4 workers
+ *          return f.get() * 2;
+ *      });
+ *
+ * The destructor runs every closure that has been added before joining the
+ * workers, so it must not be called from a worker thread.  Closures must not
+ * throw, an exception escaping a closure terminates the program
+ */
+class ThreadPoolExecutor : public Executor {
+public:
+
+    /**
+     * The configuration for the pool
+     *
+     * cpus lists the CPUs to pin workers to, worker i is pinned to
+     * cpus[i % cpus.size()], and an empty list leaves the workers unpinned.
+     * Workers are named name + "-" + i, platforms cut thread names off at
+     * 15 characters.  Pinning is only supported on Linux, naming on Linux
+     * and macOS, both are silently skipped elsewhere
+     */
+    struct Options {
+        int threads{static_cast<int>(
+            std::max(1u, std::thread::hardware_concurrency()))};
+        std::vector<int> cpus{};
+        std::string name{"sharp-pool"};
+    };
+
+    /**
+     * Start the workers, this throws a std::invalid_argument if the number
+     * of threads is less than 1
+     */
+    explicit ThreadPoolExecutor(int threads);
+    explicit ThreadPoolExecutor(Options options);
+
+    /**
+     * Runs everything that has been added and joins the workers
+     */
+    ~ThreadPoolExecutor() override;
+
+    ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor(ThreadPoolExecutor&&) = delete;
+    ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor& operator=(ThreadPoolExecutor&&) = delete;
+
+    /**
+     * Schedule the closure to run on one of the workers
+     */
+    void add(sharp::Function<void()> closure) override;
+
+    /**
+     * The number of closures that have been added but have not started
+     * running yet
+     */
+    std::size_t num_pending_closures() const override;
+
+    /**
+     * The number of worker threads
+     */
+    int num_threads() const noexcept;
+
+private:
+    using Closure = sharp::Function<void()>;
+
+    /**
+     * The state of one worker, its deque is only pushed to and popped from
+     * by the worker itself
+     */
+    struct Worker {
+        detail::WorkStealingDeque<Closure> deque;
+        std::uint64_t random_state;
+        std::thread thread;
+    };
+
+    /**
+     * The loop each worker runs and the ways it finds work, these return
+     * nullptr if they come up empty.  A closure returned from here has been
+     * taken off the pending count
+     */
+    void work(int index);
+    Closure* find_work(Worker& worker);
+    Closure* steal(Worker& worker);
+    Closure* pop_shared();
+
+    Options options;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    /**
+     * The queue for closures added from threads outside the pool
+     */
+    std::mutex shared_mtx;
+    std::deque<Closure*> shared;
+
+    /**
+     * Closures added that have not been taken by a worker yet, and the state
+     * used to put workers to sleep
+     */
+    detail::IdleWorkers idle;
+};
+
+} // namespace sharp
@@ -0,0 +1,197 @@
+#include <sharp/Executor/TimerExecutor.hpp>
+#include <sharp/Executor/detail/ThreadName.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sharp {
+
+TimerExecutor::Timer::Timer(Timer&& other) noexcept
+    : executor{std::exchange(other.executor, nullptr)},
+      node{std::exchange(other.node, nullptr)} {}
+
+TimerExecutor::Timer& TimerExecutor::Timer::operator=(Timer&& other) noexcept {
+    auto moved = std::move(other);
+    std::swap(this->executor, moved.executor);
+    std::swap(this->node, moved.node);
+    return *this;
+}
+
+TimerExecutor::Timer::~Timer() {
+    if (this->node) {
+        this->node->release();
+    }
+}
+
+bool TimerExecutor::Timer::cancel() {
+    if (!this->node) {
+        return false;
+    }
+
+    // once the node is out of the wheel the timer thread will not run it, a
+    // node that is not in the wheel has already been taken by the timer
+    // thread or cancelled
+    {
+        auto lck = std::unique_lock<std::mutex>{this->executor->mtx};
+        if (!this->node->slot) {
+            return false;
+        }
+        this->executor->wheel.erase(this->node);
+    }
+    this->node->closure = Closure{};
+    this->node->release();
+    return true;
+}
+
+TimerExecutor::TimerExecutor() : TimerExecutor{Options{}} {}
+
+TimerExecutor::TimerExecutor(Options options_in)
+        : options{std::move(options_in)}, start{Clock::now()} {
+    if (this->options.tick.count() <= 0) {
+        throw std::invalid_argument{"sharp::TimerExecutor: the tick must be "
+                                    "positive"};
+    }
+    this->thread = std::thread{[this]() { this->run(); }};
+}
+
+TimerExecutor::~TimerExecutor() {
+    {
+        auto lck = std::unique_lock<std::mutex>{this->mtx};
+        this->stopping = true;
+    }
+    this->cv.notify_one();
+    this->thread.join();
+
+    // the timers that have not fired are dropped, outside the lock because
+    // destroying a closure can run arbitrary code
+    auto nodes = std::vector<detail::TimerNode*>{};
+    this->wheel.clear([&nodes](auto node) { nodes.push_back(node); });
+    for (auto node : nodes) {
+        node->closure = Closure{};
+        node->release();
+    }
+}
+
+void TimerExecutor::add(sharp::Function<void()> closure) {
+    auto lck = std::unique_lock<std::mutex>{this->mtx};
+    this->closures.push_back(std::move(closure));
+    auto sleeping = (this->wake_tick != 0);
+    lck.unlock();
+
+    if (sleeping) {
+        this->cv.notify_one();
+    }
+}
+
+TimerExecutor::Timer TimerExecutor::schedule(sharp::Function<void()> closure,
+                                             std::chrono::nanoseconds delay) {
+    auto node = new detail::TimerNode{std::move(closure)};
+    node->expiry = this->tick_of(Clock::now() + delay);
+
+    auto lck = std::unique_lock<std::mutex>{this->mtx};
+    this->wheel.insert(node);
+    auto earlier = (node->expiry < this->wake_tick);
+    lck.unlock();
+
+    // only wake the timer thread up if this timer is due before the thread
+    // was going to wake up anyway
+    if (earlier) {
+        this->cv.notify_one();
+    }
+    return Timer{this, node};
+}
+
+std::size_t TimerExecutor::num_pending_closures() const {
+    auto lck = std::unique_lock<std::mutex>{this->mtx};
+    return this->closures.size() + this->wheel.size();
+}
+
+TimerExecutor* TimerExecutor::get() {
+    static TimerExecutor executor;
+    return &executor;
+}
+
+TimerExecutor::Clock::time_point TimerExecutor::time_of(
+        std::uint64_t tick) const {
+    return this->start + this->options.tick * tick;
+}
+
+std::uint64_t TimerExecutor::tick_of(Clock::time_point time) const {
+    if (time <= this->start) {
+        return 0;
+    }
+    auto tick = this->options.tick.count();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            time - this->start).count();
+    return static_cast<std::uint64_t>((elapsed + tick - 1) / tick);
+}
+
+void TimerExecutor::run() {
+    detail::set_thread_name(this->options.name);
+
+    auto ready = std::vector<Closure>{};
+    auto expired = std::vector<detail::TimerNode*>{};
+    auto lck = std::unique_lock<std::mutex>{this->mtx};
+    while (true) {
+
+        // expire every tick that is due, skipping over the ones that have
+        // nothing to expire.  The ticks before due are the ones whose time
+        // has come
+        auto due = this->tick_of(Clock::now() + std::chrono::nanoseconds{1});
+        while (this->wheel.current() < due) {
+            auto ticks = due - this->wheel.current();
+            if (this->wheel.size()) {
+                ticks = std::min(ticks, this->wheel.idle_ticks());
+            }
+            if (ticks) {
+                this->wheel.skip(ticks);
+            } else {
+                this->wheel.advance([&expired](auto node) {
+                    expired.push_back(node);
+                });
+            }
+        }
+
+        std::swap(ready, this->closures);
+        if (ready.empty() && expired.empty()) {
+            if (this->stopping) {
+                return;
+            }
+
+            // sleep till the next tick that might have something to expire,
+            // or till there is something to run
+            if (!this->wheel.size()) {
+                this->wake_tick = std::numeric_limits<std::uint64_t>::max();
+                this->cv.wait(lck);
+            } else {
+                auto current = this->wheel.current();
+                this->wake_tick = current + this->wheel.idle_ticks();
+                this->cv.wait_until(lck, this->time_of(this->wake_tick));
+            }
+            this->wake_tick = 0;
+            continue;
+        }
+
+        lck.unlock();
+        for (auto& closure : ready) {
+            closure();
+        }
+        ready.clear();
+        for (auto node : expired) {
+            node->closure();
+            node->closure = Closure{};
+            node->release();
+        }
+        expired.clear();
+        lck.lock();
+    }
+}
+
+} // namespace sharp
@@ -0,0 +1,170 @@
+/**
+ * @file TimerExecutor.hpp
+ * @author Aaryaman Sagar
+ *
+ * An executor that runs closures on a thread of its own, either right away or
+ * after a delay.  Delayed closures wait in a hierarchical timing wheel so
+ * that millions of them can be pending at once
+ */
+
+#pragma once
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Executor/detail/TimingWheel.hpp>
+#include <sharp/Functional/Functional.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sharp {
+
+/**
+ * @class TimerExecutor
+ *
+ * Closures passed to add() are run on the timer thread as soon as it gets to
+ * them, closures passed to schedule() are run on the timer thread once the
+ * delay has passed.  Timers are never run early, and are run late by at most
+ * about a tick plus however long the closures ahead of them take, so
+ * closures run here should be short, they usually just fulfill a promise or
+ * hand work off to another executor
+ *
+ *      auto timers = sharp::TimerExecutor{};
+ *      auto timer = timers.schedule([]() {
+ *          std::cout << "a second later" << std::endl;
+ *      }, std::chrono::seconds{1});
+ *
+ *      // changed my mind
+ *      timer.cancel();
+ *
+ * Adding, cancelling and running a timer is O(1), and the timer thread only
+ * wakes up on ticks that have timers due, or once every 256 ticks to move
+ * timers due later down the wheel
+ *
+ * The destructor joins the timer thread, closures added with add() are run
+ * before that and timers that have not fired are destroyed without running.
+ * Closures must not throw, an exception escaping a closure terminates the
+ * program
+ */
+class TimerExecutor : public Executor {
+public:
+
+    /**
+     * The configuration for the timer executor, tick is the resolution of
+     * the timers and the thread is named name where the platform supports it
+     */
+    struct Options {
+        std::chrono::nanoseconds tick{std::chrono::milliseconds{1}};
+        std::string name{"sharp-timer"};
+    };
+
+    /**
+     * A handle to a scheduled closure, it can be used to cancel the closure
+     * before it runs.  Letting go of the handle does not cancel anything, and
+     * a handle must not be used after the executor is destroyed
+     */
+    class Timer {
+    public:
+        Timer() = default;
+        Timer(Timer&& other) noexcept;
+        Timer& operator=(Timer&& other) noexcept;
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer();
+
+        /**
+         * Take the closure out of the executor if it has not started running,
+         * returns true if it was taken out, the closure is destroyed on the
+         * calling thread in that case
+         */
+        bool cancel();
+
+    private:
+        friend class TimerExecutor;
+        Timer(TimerExecutor* executor_in, detail::TimerNode* node_in)
+            : executor{executor_in}, node{node_in} {}
+
+        TimerExecutor* executor{nullptr};
+        detail::TimerNode* node{nullptr};
+    };
+
+    /**
+     * Start the timer thread, this throws a std::invalid_argument if the
+     * tick is not positive
+     */
+    TimerExecutor();
+    explicit TimerExecutor(Options options);
+
+    /**
+     * Runs the closures passed to add() and joins the timer thread
+     */
+    ~TimerExecutor() override;
+
+    TimerExecutor(const TimerExecutor&) = delete;
+    TimerExecutor(TimerExecutor&&) = delete;
+    TimerExecutor& operator=(const TimerExecutor&) = delete;
+    TimerExecutor& operator=(TimerExecutor&&) = delete;
+
+    /**
+     * Run the closure on the timer thread
+     */
+    void add(sharp::Function<void()> closure) override;
+
+    /**
+     * Run the closure on the timer thread once the delay has passed
+     */
+    Timer schedule(sharp::Function<void()> closure,
+                   std::chrono::nanoseconds delay);
+
+    /**
+     * The number of closures that have not been run yet, pending timers
+     * included
+     */
+    std::size_t num_pending_closures() const override;
+
+    /**
+     * The process wide timer executor, used by sharp::sleep_for() and
+     * Future::within() when they are not given one
+     */
+    static TimerExecutor* get();
+
+private:
+    using Closure = sharp::Function<void()>;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * The loop the timer thread runs
+     */
+    void run();
+
+    /**
+     * The time a tick is due at, and the tick a time falls in rounded up so
+     * that timers are never run early
+     */
+    Clock::time_point time_of(std::uint64_t tick) const;
+    std::uint64_t tick_of(Clock::time_point time) const;
+
+    Options options;
+    Clock::time_point start;
+
+    /**
+     * wake_tick is the tick the timer thread is sleeping till, zero when it
+     * is awake and the largest tick when it is waiting for closures, so
+     * adding a timer only wakes the thread up if it is due before that
+     */
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<Closure> closures;
+    detail::TimingWheel wheel;
+    std::uint64_t wake_tick{0};
+    bool stopping{false};
+
+    std::thread thread;
+};
+
+} // namespace sharp
@@ -0,0 +1,56 @@
+#include <sharp/Executor/detail/IdleWorkers.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace sharp {
+
+namespace detail {
+
+    void IdleWorkers::add_pending() {
+        this->pending.fetch_add(1);
+        if (this->sleeping.load() > 0) {
+            // taking the lock makes sure that a worker that registered as a
+            // sleeper before the closure was counted is waiting on the
+            // condition variable by the time it is signalled
+            { auto lck = std::unique_lock<std::mutex>{this->mtx}; }
+            this->cv.notify_one();
+        }
+    }
+
+    void IdleWorkers::remove_pending() noexcept {
+        this->pending.fetch_sub(1);
+    }
+
+    std::size_t IdleWorkers::num_pending() const noexcept {
+        auto pending = this->pending.load();
+        return (pending > 0) ? static_cast<std::size_t>(pending) : 0;
+    }
+
+    bool IdleWorkers::wait() {
+        if (this->pending.load() > 0) {
+            std::this_thread::yield();
+            return true;
+        }
+
+        auto lck = std::unique_lock<std::mutex>{this->mtx};
+        this->sleeping.fetch_add(1);
+        while (this->pending.load() <= 0 && !this->stopping) {
+            this->cv.wait(lck);
+        }
+        this->sleeping.fetch_sub(1);
+        return !this->stopping || this->pending.load() > 0;
+    }
+
+    void IdleWorkers::stop() {
+        {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            this->stopping = true;
+        }
+        this->cv.notify_all();
+    }
+
+} // namespace detail
+
+} // namespace sharp
@@ -0,0 +1,79 @@
+/**
+ * @file IdleWorkers.hpp
+ * @author Aaryaman Sagar
+ *
+ * The count of closures waiting for a worker and the protocol workers use to
+ * go to sleep when there are none, shared by the executors that run closures
+ * on a fixed set of worker threads
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * @class IdleWorkers
+     *
+     * A worker only sleeps after registering as a sleeper and seeing no
+     * pending closures, and add_pending() only skips waking anyone after
+     * counting its closure and seeing no sleepers.  So a closure can never
+     * be left behind with every worker asleep
+     *
+     * The count can go below zero for a moment, when a worker takes a closure
+     * before the thread that added it has counted it.  So closures have to
+     * be visible to the workers before they are counted
+     */
+    class IdleWorkers {
+    public:
+
+        /**
+         * Count a closure that has just been made visible to the workers,
+         * and wake up a sleeping worker if there is one
+         */
+        void add_pending();
+
+        /**
+         * Take back the count for a closure a worker is about to run
+         */
+        void remove_pending() noexcept;
+
+        /**
+         * The number of closures that have been counted but not taken
+         */
+        std::size_t num_pending() const noexcept;
+
+        /**
+         * Called by a worker that looked for a closure and found none.  This
+         * returns right away if a closure is pending, since it is on its way
+         * into a queue or was just taken by another worker, and otherwise
+         * sleeps till one is added.  Returns false once stop() has been
+         * called and there is nothing left to run, the worker should exit
+         * then
+         */
+        bool wait();
+
+        /**
+         * Wake every worker up and make wait() return false from here on
+         * once the pending closures have run
+         */
+        void stop();
+
+    private:
+        std::atomic<std::int64_t> pending{0};
+        std::atomic<int> sleeping{0};
+        bool stopping{false};
+        std::mutex mtx;
+        std::condition_variable cv;
+    };
+
+} // namespace detail
+
+} // namespace sharp
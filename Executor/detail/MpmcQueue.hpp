@@ -0,0 +1,158 @@
+/**
+ * @file MpmcQueue.hpp
+ * @author Aaryaman Sagar
+ *
+ * A bounded lock free multiple producer multiple consumer queue, based on
+ * Dmitry Vyukov's ring buffer with sequence numbered cells, see
+ * http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ *
+ * This is the same algorithm as the Mpmc channel policy, cut down to hold
+ * trivially copyable values like pointers so executors can use it without
+ * depending on sharp::Channel
+ */
+
+#pragma once
+
+#include <sharp/Portability/cpp17.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * @class MpmcQueue
+     *
+     * Each cell in the ring has a sequence number that tells producers and
+     * consumers whose turn it is to use the cell.  The producer that claims
+     * position p waits for the sequence number to be p, stores its value and
+     * sets it to p + 1, which hands the cell to the consumer at position p.
+     * That consumer loads the value and sets the sequence number to
+     * p + capacity, handing the cell to the producer on the next lap
+     *
+     * So producers and consumers only contend on the two position counters
+     * and never on a lock.  try_push() fails when the ring is full and
+     * try_pop() when it is empty, neither ever waits
+     */
+    template <typename Type>
+    class MpmcQueue {
+    public:
+        static_assert(std::is_trivially_copyable<Type>::value,
+                      "MpmcQueue only holds trivially copyable values");
+
+        /**
+         * Allocates all the cells up front, throws std::invalid_argument if
+         * the capacity is not at least 1
+         */
+        explicit MpmcQueue(std::size_t capacity_in)
+                : capacity{capacity_in} {
+            if (this->capacity < 1) {
+                throw std::invalid_argument{"sharp::detail::MpmcQueue: the "
+                                            "capacity must be at least 1"};
+            }
+            this->cells = std::make_unique<Cell[]>(this->capacity);
+            for (auto i = std::size_t{0}; i < this->capacity; ++i) {
+                this->cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MpmcQueue(const MpmcQueue&) = delete;
+        MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+        /**
+         * Add a value to the back of the queue, returns false if the queue
+         * is full
+         */
+        bool try_push(Type value) noexcept {
+            auto position = this->enqueue_position.load(
+                    std::memory_order_relaxed);
+            while (true) {
+                auto& cell = this->cells[position % this->capacity];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::intptr_t>(sequence)
+                    - static_cast<std::intptr_t>(position);
+
+                // the cell is free for this lap, try and claim it, if the CAS
+                // fails then position has been updated with the new value
+                if (difference == 0) {
+                    if (this->enqueue_position.compare_exchange_weak(
+                                position, position + 1,
+                                std::memory_order_relaxed)) {
+                        cell.value = value;
+                        cell.sequence.store(position + 1,
+                                            std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    // the consumer from the previous lap has not taken the
+                    // value out yet, so the ring is full
+                    return false;
+                } else {
+                    position = this->enqueue_position.load(
+                            std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * Take the value at the front of the queue, returns false if the
+         * queue is empty.  A value whose producer has claimed a cell but not
+         * stored into it yet counts as not there
+         */
+        bool try_pop(Type& value) noexcept {
+            auto position = this->dequeue_position.load(
+                    std::memory_order_relaxed);
+            while (true) {
+                auto& cell = this->cells[position % this->capacity];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::intptr_t>(sequence)
+                    - static_cast<std::intptr_t>(position + 1);
+
+                if (difference == 0) {
+                    if (this->dequeue_position.compare_exchange_weak(
+                                position, position + 1,
+                                std::memory_order_relaxed)) {
+                        value = cell.value;
+                        cell.sequence.store(position + this->capacity,
+                                            std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = this->dequeue_position.load(
+                            std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            Type value;
+        };
+
+        const std::size_t capacity;
+        std::unique_ptr<Cell[]> cells;
+
+        /**
+         * The positions producers and consumers claim cells at, padded so
+         * that they do not share a cache line with each other or with the
+         * read mostly fields above
+         */
+        char padding_one[hardware_destructive_interference_size];
+        std::atomic<std::size_t> enqueue_position{0};
+        char padding_two[hardware_destructive_interference_size];
+        std::atomic<std::size_t> dequeue_position{0};
+        char padding_three[hardware_destructive_interference_size];
+    };
+
+} // namespace detail
+
+} // namespace sharp
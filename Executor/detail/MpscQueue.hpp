@@ -0,0 +1,115 @@
+/**
+ * @file MpscQueue.hpp
+ * @author Aaryaman Sagar
+ *
+ * An intrusive lock free multiple producer single consumer queue, as
+ * described by Dmitry Vyukov in "Intrusive MPSC node-based queue" on
+ * 1024cores.net
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * The link that elements of an MpscQueue carry, elements derive from
+     * this
+     */
+    struct MpscNode {
+        std::atomic<MpscNode*> next{nullptr};
+    };
+
+    /**
+     * @class MpscQueue
+     *
+     * Pushing is one atomic exchange and one store, and never waits on other
+     * producers or the consumer.  Popping touches no shared cache line that
+     * producers write to unless the queue is nearly empty, and is only done
+     * by the consumer thread
+     *
+     * A producer links its node in two steps, between which the node is in
+     * the queue but cannot be reached yet.  pop() returns nullptr in that
+     * case even though empty() returns false, the consumer should try again
+     * shortly
+     *
+     * The queue does not own the nodes, and they must stay alive till they
+     * have been popped
+     */
+    class MpscQueue {
+    public:
+        MpscQueue() = default;
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        /**
+         * Add a node to the back of the queue, this can be called from any
+         * thread
+         */
+        void push(MpscNode* node) noexcept {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            auto previous = this->head.exchange(node);
+            previous->next.store(node, std::memory_order_release);
+        }
+
+        /**
+         * Take the node at the front of the queue, or return nullptr if there
+         * is none that can be reached.  Only the consumer can call this
+         */
+        MpscNode* pop() noexcept {
+            auto front = this->tail;
+            auto next = front->next.load(std::memory_order_acquire);
+
+            // the stub is the node the queue keeps around so it is never
+            // without one, skip over it
+            if (front == &this->stub) {
+                if (!next) {
+                    return nullptr;
+                }
+                this->tail = next;
+                front = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                this->tail = next;
+                return front;
+            }
+
+            // front is the last node, it can only be taken out once there is
+            // a node behind it, so put the stub back in
+            if (front != this->head.load()) {
+                return nullptr;
+            }
+            this->push(&this->stub);
+            next = front->next.load(std::memory_order_acquire);
+            if (next) {
+                this->tail = next;
+                return front;
+            }
+            return nullptr;
+        }
+
+        /**
+         * Returns true if nothing has been pushed that has not been popped,
+         * only the consumer can call this.  This is sequentially consistent
+         * with push(), so a consumer that announces it is going to sleep and
+         * then sees an empty queue can rely on producers that push after
+         * that seeing the announcement
+         */
+        bool empty() const noexcept {
+            return this->tail == &this->stub
+                && this->head.load() == &this->stub;
+        }
+
+    private:
+        MpscNode stub;
+        std::atomic<MpscNode*> head{&stub};
+        MpscNode* tail{&stub};
+    };
+
+} // namespace detail
+
+} // namespace sharp
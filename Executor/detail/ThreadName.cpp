@@ -0,0 +1,27 @@
+#include <sharp/Executor/detail/ThreadName.hpp>
+
+#include <string>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+namespace sharp {
+
+namespace detail {
+
+    void set_thread_name(const std::string& name) {
+        // thread names are limited to 16 bytes including the null byte
+        auto truncated = name.substr(0, 15);
+#if defined(__linux__)
+        pthread_setname_np(pthread_self(), truncated.c_str());
+#elif defined(__APPLE__)
+        pthread_setname_np(truncated.c_str());
+#else
+        static_cast<void>(truncated);
+#endif
+    }
+
+} // namespace detail
+
+} // namespace sharp
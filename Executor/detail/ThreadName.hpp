@@ -0,0 +1,26 @@
+/**
+ * @file ThreadName.hpp
+ * @author Aaryaman Sagar
+ *
+ * Naming the threads executors start, so they can be told apart in a
+ * debugger or in top
+ */
+
+#pragma once
+
+#include <string>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * Name the current thread, platforms cut thread names off at 15
+     * characters.  This is supported on Linux and macOS and does nothing
+     * elsewhere
+     */
+    void set_thread_name(const std::string& name);
+
+} // namespace detail
+
+} // namespace sharp
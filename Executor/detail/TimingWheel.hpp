@@ -0,0 +1,250 @@
+/**
+ * @file TimingWheel.hpp
+ * @author Aaryaman Sagar
+ *
+ * A hierarchical timing wheel, as described in "Hashed and Hierarchical
+ * Timing Wheels" by George Varghese and Tony Lauck.  This is the structure
+ * behind TimerExecutor, it does no locking of its own
+ */
+
+#pragma once
+
+#include <sharp/Functional/Functional.hpp>
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace sharp {
+
+namespace detail {
+
+    class TimerNode;
+
+    /**
+     * A slot in the wheel, the head of a list of the timers waiting in it
+     */
+    struct TimerSlot {
+        TimerNode* head{nullptr};
+    };
+
+    /**
+     * A timer in the wheel, nodes are linked into the slot they are waiting
+     * in and slot is null when they are not in the wheel.  A node is
+     * referenced by the executor till it has run or been cancelled and by
+     * the handle returned for it, the last one to let go frees it
+     */
+    class TimerNode {
+    public:
+        explicit TimerNode(sharp::Function<void()> closure_in)
+            : closure{std::move(closure_in)} {}
+
+        void release() noexcept {
+            if (this->references.fetch_sub(1, std::memory_order_acq_rel)
+                    == 1) {
+                delete this;
+            }
+        }
+
+        sharp::Function<void()> closure;
+        std::uint64_t expiry{0};
+        TimerNode* next{nullptr};
+        TimerNode* previous{nullptr};
+        TimerSlot* slot{nullptr};
+        std::atomic<int> references{2};
+    };
+
+    /**
+     * @class TimingWheel
+     *
+     * Time is counted in ticks, and the wheel has 4 levels of 256 slots.  A
+     * timer due less than 256 ticks from now waits in the slot of the first
+     * level for its tick, one due less than 256 * 256 ticks from now waits in
+     * the slot of the second level for the 256 ticks it is due in, and so
+     * on.  When the first level wraps around, the next slot of the second
+     * level is emptied into the first level, and so on up the levels.  So
+     * adding, removing and expiring a timer is O(1) and every timer is moved
+     * down at most 3 times, no matter how many timers are in the wheel
+     *
+     * Timers further out than the wheel covers (2^32 ticks, about 49 days
+     * with 1ms ticks) are clamped to the furthest tick it covers
+     */
+    class TimingWheel {
+    public:
+        static constexpr int levels = 4;
+        static constexpr int bits = 8;
+        static constexpr std::uint64_t slots = std::uint64_t{1} << bits;
+        static constexpr std::uint64_t mask = slots - 1;
+
+        TimingWheel() = default;
+        TimingWheel(const TimingWheel&) = delete;
+        TimingWheel& operator=(const TimingWheel&) = delete;
+
+        /**
+         * The next tick to be expired, timers inserted for earlier ticks
+         * expire with this one
+         */
+        std::uint64_t current() const noexcept {
+            return this->now;
+        }
+
+        /**
+         * The number of timers in the wheel
+         */
+        std::size_t size() const noexcept {
+            return this->count;
+        }
+
+        /**
+         * Link the node into the wheel to expire at its expiry tick
+         */
+        void insert(TimerNode* node) {
+            assert(!node->slot);
+            if (node->expiry < this->now) {
+                node->expiry = this->now;
+            }
+            auto delta = node->expiry - this->now;
+            auto furthest = (std::uint64_t{1} << (bits * levels)) - 1;
+            if (delta > furthest) {
+                node->expiry = this->now + furthest;
+                delta = furthest;
+            }
+
+            auto level = 0;
+            while (delta >= (std::uint64_t{1} << (bits * (level + 1)))) {
+                ++level;
+            }
+            auto slot = (node->expiry >> (bits * level)) & mask;
+            this->push(this->wheel[level][slot], node);
+            ++this->count;
+        }
+
+        /**
+         * Unlink a node that is in the wheel
+         */
+        void erase(TimerNode* node) {
+            assert(node->slot);
+            this->unlink(node);
+            --this->count;
+        }
+
+        /**
+         * Expire the current tick and move on to the next one, the nodes that
+         * expire are unlinked and passed to the function
+         */
+        template <typename Func>
+        void advance(Func&& func) {
+            // when the first level wraps around bring the timers due in the
+            // next 256 ticks down from the level above, and so on up
+            auto index = this->now & mask;
+            for (auto level = 1; !index && level < levels; ++level) {
+                index = (this->now >> (bits * level)) & mask;
+                this->cascade(this->wheel[level][index]);
+            }
+
+            auto& slot = this->wheel[0][this->now & mask];
+            while (slot.head) {
+                auto node = slot.head;
+                this->unlink(node);
+                --this->count;
+                func(node);
+            }
+            ++this->now;
+        }
+
+        /**
+         * The number of ticks that can be skipped without missing a timer,
+         * that is the ticks till the next timer in the first level or till
+         * the next time timers are brought down from the levels above,
+         * whichever comes first.  So the thread running the wheel does not
+         * have to wake up for every tick
+         */
+        std::uint64_t idle_ticks() const noexcept {
+            auto index = this->now & mask;
+            auto ticks = std::uint64_t{0};
+            if (!index) {
+                return 0;
+            }
+            for (; index + ticks < slots; ++ticks) {
+                if (this->wheel[0][index + ticks].head) {
+                    return ticks;
+                }
+            }
+            return ticks;
+        }
+
+        /**
+         * Move on by ticks ticks that have nothing to expire, either the
+         * wheel is empty or ticks is at most idle_ticks()
+         */
+        void skip(std::uint64_t ticks) noexcept {
+            assert(!this->count || ticks <= this->idle_ticks());
+            this->now += ticks;
+        }
+
+        /**
+         * Unlink every node in the wheel and pass it to the function
+         */
+        template <typename Func>
+        void clear(Func&& func) {
+            for (auto& level : this->wheel) {
+                for (auto& slot : level) {
+                    while (slot.head) {
+                        auto node = slot.head;
+                        this->unlink(node);
+                        --this->count;
+                        func(node);
+                    }
+                }
+            }
+        }
+
+    private:
+        void push(TimerSlot& slot, TimerNode* node) {
+            node->previous = nullptr;
+            node->next = slot.head;
+            if (slot.head) {
+                slot.head->previous = node;
+            }
+            slot.head = node;
+            node->slot = &slot;
+        }
+
+        void unlink(TimerNode* node) {
+            if (node->previous) {
+                node->previous->next = node->next;
+            } else {
+                node->slot->head = node->next;
+            }
+            if (node->next) {
+                node->next->previous = node->previous;
+            }
+            node->next = nullptr;
+            node->previous = nullptr;
+            node->slot = nullptr;
+        }
+
+        void cascade(TimerSlot& slot) {
+            auto node = std::exchange(slot.head, nullptr);
+            while (node) {
+                auto next = node->next;
+                node->next = nullptr;
+                node->previous = nullptr;
+                node->slot = nullptr;
+                --this->count;
+                this->insert(node);
+                node = next;
+            }
+        }
+
+        std::array<std::array<TimerSlot, slots>, levels> wheel{};
+        std::uint64_t now{0};
+        std::size_t count{0};
+    };
+
+} // namespace detail
+
+} // namespace sharp
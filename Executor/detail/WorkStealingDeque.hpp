@@ -0,0 +1,189 @@
+/**
+ * @file WorkStealingDeque.hpp
+ * @author Aaryaman Sagar
+ *
+ * A Chase-Lev work stealing deque, as described in "Dynamic Circular
+ * Work-Stealing Deque" by David Chase and Yossi Lev, with the memory orderings
+ * from "Correct and Efficient Work-Stealing for Weak Memory Models" by Lê,
+ * Pop, Cohen and Zappa Nardelli
+ */
+
+#pragma once
+
+#include <sharp/Portability/cpp17.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * @class WorkStealingDeque
+     *
+     * A deque of pointers with one owner thread and any number of thieves.
+     * The owner pushes and pops at the bottom like a stack, so the work it
+     * added last (and whose data is most likely still in its cache) is what
+     * it runs next.  Thieves take from the top, the oldest work, and only
+     * contend with the owner when there is one element left
+     *
+     * The deque grows when the owner pushes onto a full one.  The arrays it
+     * grew out of are kept around till the deque is destroyed, because a
+     * thief might still be reading from one of them
+     *
+     * The deque does not own what the pointers point to
+     */
+    template <typename Type>
+    class WorkStealingDeque {
+    public:
+        explicit WorkStealingDeque(std::int64_t capacity = 256)
+                : array{new Array{capacity}} {
+            assert(capacity > 0 && !(capacity & (capacity - 1)));
+        }
+
+        ~WorkStealingDeque() {
+            delete this->array.load();
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        /**
+         * Push a pointer at the bottom of the deque, this must only be
+         * called by the owner
+         */
+        void push(Type* element) {
+            auto b = this->bottom.load(std::memory_order_relaxed);
+            auto t = this->top.load(std::memory_order_acquire);
+            auto current = this->array.load(std::memory_order_relaxed);
+            if (b - t > current->capacity - 1) {
+                current = this->grow(current, t, b);
+            }
+            current->put(b, element);
+            this->bottom.store(b + 1, std::memory_order_release);
+        }
+
+        /**
+         * Pop the pointer at the bottom of the deque, this returns nullptr if
+         * the deque is empty and must only be called by the owner
+         */
+        Type* pop() {
+            auto b = this->bottom.load(std::memory_order_relaxed) - 1;
+            auto current = this->array.load(std::memory_order_relaxed);
+            this->bottom.store(b, std::memory_order_seq_cst);
+            auto t = this->top.load(std::memory_order_seq_cst);
+
+            if (t > b) {
+                // the deque was empty
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            auto element = current->get(b);
+            if (t == b) {
+                // this is the last element, race the thieves for it
+                if (!this->top.compare_exchange_strong(
+                            t, t + 1, std::memory_order_seq_cst,
+                            std::memory_order_relaxed)) {
+                    element = nullptr;
+                }
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return element;
+        }
+
+        /**
+         * Take the pointer at the top of the deque, this can be called from
+         * any thread.  It returns nullptr if the deque is empty or if another
+         * thread got to the element first
+         */
+        Type* steal() {
+            auto t = this->top.load(std::memory_order_seq_cst);
+            auto b = this->bottom.load(std::memory_order_seq_cst);
+            if (t >= b) {
+                return nullptr;
+            }
+
+            auto current = this->array.load(std::memory_order_acquire);
+            auto element = current->get(t);
+            if (!this->top.compare_exchange_strong(
+                        t, t + 1, std::memory_order_seq_cst,
+                        std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return element;
+        }
+
+        /**
+         * An estimate of the number of elements in the deque, only exact
+         * when there are no concurrent operations
+         */
+        std::int64_t size() const {
+            auto b = this->bottom.load(std::memory_order_relaxed);
+            auto t = this->top.load(std::memory_order_relaxed);
+            return (b > t) ? (b - t) : 0;
+        }
+
+    private:
+
+        /**
+         * A circular array, index i lives in slot i % capacity.  The capacity
+         * is always a power of 2 so that is a mask
+         */
+        class Array {
+        public:
+            explicit Array(std::int64_t capacity_in)
+                : capacity{capacity_in},
+                  slots{new std::atomic<Type*>[capacity_in]} {}
+
+            Type* get(std::int64_t index) const {
+                auto& slot = this->slots[index & (this->capacity - 1)];
+                return slot.load(std::memory_order_relaxed);
+            }
+            void put(std::int64_t index, Type* element) {
+                auto& slot = this->slots[index & (this->capacity - 1)];
+                slot.store(element, std::memory_order_relaxed);
+            }
+
+            const std::int64_t capacity;
+
+        private:
+            std::unique_ptr<std::atomic<Type*>[]> slots;
+        };
+
+        /**
+         * Copy the live elements into an array twice the size and publish it,
+         * the old array is retired
+         */
+        Array* grow(Array* current, std::int64_t t, std::int64_t b) {
+            auto bigger = std::make_unique<Array>(current->capacity * 2);
+            for (auto i = t; i < b; ++i) {
+                bigger->put(i, current->get(i));
+            }
+            this->retired.emplace_back(current);
+            this->array.store(bigger.get(), std::memory_order_release);
+            return bigger.release();
+        }
+
+        /**
+         * Thieves move the top and the owner moves the bottom, they are kept
+         * on separate cache lines
+         */
+        alignas(hardware_destructive_interference_size)
+            std::atomic<std::int64_t> top{0};
+        alignas(hardware_destructive_interference_size)
+            std::atomic<std::int64_t> bottom{0};
+        alignas(hardware_destructive_interference_size)
+            std::atomic<Array*> array;
+
+        std::vector<std::unique_ptr<Array>> retired;
+    };
+
+} // namespace detail
+
+} // namespace sharp
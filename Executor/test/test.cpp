@@ -0,0 +1,761 @@
+#include <sharp/Executor/EventLoopExecutor.hpp>
+#include <sharp/Executor/InstrumentedExecutor.hpp>
+#include <sharp/Executor/PriorityExecutor.hpp>
+#include <sharp/Executor/ThreadPoolExecutor.hpp>
+#include <sharp/Executor/TimerExecutor.hpp>
+#include <sharp/Executor/InlineExecutor.hpp>
+#include <sharp/Future/Future.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+namespace {
+
+    /**
+     * Blocks threads till it is opened
+     */
+    class Gate {
+    public:
+        void wait() {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            this->cv.wait(lck, [this]() { return this->open; });
+        }
+        void release() {
+            auto lck = std::unique_lock<std::mutex>{this->mtx};
+            this->open = true;
+            this->cv.notify_all();
+        }
+
+    private:
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool open{false};
+    };
+
+} // namespace <anonymous>
+
+TEST(Executor, InlineExecutor) {
+    auto executor = sharp::InlineExecutor::get();
+    auto ran = false;
+    executor->add([&]() { ran = true; });
+    EXPECT_TRUE(ran);
+    EXPECT_EQ(executor->num_pending_closures(), 0);
+}
+
+TEST(Executor, InlineExecutorTrampolines) {
+    EXPECT_THROW(sharp::InlineExecutor{0}, std::invalid_argument);
+
+    // closures added past the maximum depth run once the outermost one is
+    // done, in the order they were added
+    sharp::InlineExecutor executor{2};
+    auto order = std::vector<int>{};
+    executor.add([&]() {
+        executor.add([&]() {
+            executor.add([&]() { order.push_back(3); });
+            executor.add([&]() { order.push_back(4); });
+            EXPECT_EQ(executor.num_pending_closures(), 2);
+            order.push_back(2);
+        });
+        order.push_back(1);
+    });
+    EXPECT_EQ(order, (std::vector<int>{2, 1, 3, 4}));
+    EXPECT_EQ(executor.num_pending_closures(), 0);
+}
+
+TEST(Executor, InlineExecutorFlatStack) {
+    // every closure adds the next one, without the queue this would need a
+    // stack frame for every closure
+    sharp::InlineExecutor executor{4};
+    auto count = 0;
+    auto deepest = std::uintptr_t{0};
+    auto shallowest = ~std::uintptr_t{0};
+    sharp::Function<void()> next;
+    next = [&]() {
+        auto local = 0;
+        auto address = reinterpret_cast<std::uintptr_t>(&local);
+        deepest = std::max(deepest, address);
+        shallowest = std::min(shallowest, address);
+        if (++count < 100000) {
+            executor.add([&]() { next(); });
+        }
+    };
+    executor.add([&]() { next(); });
+    EXPECT_EQ(count, 100000);
+    EXPECT_LT(deepest - shallowest, 64 * 1024);
+}
+
+TEST(Executor, InlineExecutorExceptions) {
+    sharp::InlineExecutor executor{1};
+    auto ran = false;
+    EXPECT_THROW(executor.add([&]() {
+        executor.add([&]() { ran = true; });
+        throw std::runtime_error{"error"};
+    }), std::runtime_error);
+
+    // the queued closure still ran, and the depth was given back
+    EXPECT_TRUE(ran);
+    auto nested = false;
+    executor.add([&]() { nested = true; });
+    EXPECT_TRUE(nested);
+}
+
+TEST(Executor, InlineExecutorQueuedExceptions) {
+    sharp::InlineExecutor executor{1};
+    auto ran = 0;
+    EXPECT_THROW(executor.add([&]() {
+        executor.add([&]() { throw std::logic_error{"first"}; });
+        executor.add([&]() { throw std::runtime_error{"second"}; });
+        executor.add([&]() { ++ran; });
+    }), std::logic_error);
+
+    // every queued closure ran, and nothing was left in the queue for the
+    // next add() to run
+    EXPECT_EQ(ran, 1);
+    executor.add([&]() {
+        executor.add([&]() { ran += 10; });
+    });
+    EXPECT_EQ(ran, 11);
+}
+
+TEST(Executor, ThreadPoolInvalidThreads) {
+    EXPECT_THROW(sharp::ThreadPoolExecutor{0}, std::invalid_argument);
+}
+
+TEST(Executor, ThreadPoolRunsEverything) {
+    std::atomic<int> count{0};
+    {
+        sharp::ThreadPoolExecutor executor{4};
+        EXPECT_EQ(executor.num_threads(), 4);
+        for (auto i = 0; i < 10000; ++i) {
+            executor.add([&]() { count.fetch_add(1); });
+        }
+    }
+    EXPECT_EQ(count.load(), 10000);
+}
+
+TEST(Executor, ThreadPoolNestedAdds) {
+    // closures added from the workers go to their own deques, every one of
+    // them should still run before the destructor returns
+    std::atomic<int> count{0};
+    {
+        sharp::ThreadPoolExecutor executor{4};
+        for (auto i = 0; i < 100; ++i) {
+            executor.add([&]() {
+                for (auto j = 0; j < 100; ++j) {
+                    executor.add([&]() { count.fetch_add(1); });
+                }
+            });
+        }
+    }
+    EXPECT_EQ(count.load(), 10000);
+}
+
+TEST(Executor, ThreadPoolStealing) {
+    // the closures added by the blocked worker can only run if the other
+    // workers steal them from its deque
+    sharp::ThreadPoolExecutor executor{2};
+    std::mutex mtx;
+    std::condition_variable cv;
+    auto count = 0;
+    std::atomic<bool> done{false};
+
+    executor.add([&]() {
+        for (auto i = 0; i < 100; ++i) {
+            executor.add([&]() {
+                auto lck = std::unique_lock<std::mutex>{mtx};
+                ++count;
+                cv.notify_all();
+            });
+        }
+        auto lck = std::unique_lock<std::mutex>{mtx};
+        done.store(cv.wait_for(lck, std::chrono::seconds{10}, [&]() {
+            return count == 100;
+        }));
+    });
+
+    auto lck = std::unique_lock<std::mutex>{mtx};
+    cv.wait(lck, [&]() { return count == 100; });
+    lck.unlock();
+    while (!done.load()) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(Executor, ThreadPoolNumPendingClosures) {
+    Gate gate;
+    sharp::ThreadPoolExecutor executor{2};
+    std::atomic<int> blocked{0};
+    for (auto i = 0; i < 2; ++i) {
+        executor.add([&]() {
+            blocked.fetch_add(1);
+            gate.wait();
+        });
+    }
+    while (blocked.load() != 2) {
+        std::this_thread::yield();
+    }
+
+    for (auto i = 0; i < 10; ++i) {
+        executor.add([]() {});
+    }
+    EXPECT_EQ(executor.num_pending_closures(), 10);
+    gate.release();
+}
+
+TEST(Executor, ThreadPoolOptions) {
+    auto names = std::set<std::string>{};
+    std::mutex mtx;
+    Gate gate;
+    std::atomic<int> started{0};
+    {
+        auto options = sharp::ThreadPoolExecutor::Options{};
+        options.threads = 2;
+        options.cpus = {0};
+        options.name = "test";
+        sharp::ThreadPoolExecutor executor{options};
+
+        // hold both workers so each closure runs on a different one
+        for (auto i = 0; i < 2; ++i) {
+            executor.add([&]() {
+                char name[16] = {};
+#if defined(__linux__)
+                pthread_getname_np(pthread_self(), name, sizeof(name));
+#endif
+                {
+                    auto lck = std::unique_lock<std::mutex>{mtx};
+                    names.insert(name);
+                }
+                started.fetch_add(1);
+                gate.wait();
+            });
+        }
+        while (started.load() != 2) {
+            std::this_thread::yield();
+        }
+        gate.release();
+    }
+
+#if defined(__linux__)
+    EXPECT_EQ(names, (std::set<std::string>{"test-0", "test-1"}));
+#endif
+}
+
+TEST(Executor, ThreadPoolFutures) {
+    sharp::ThreadPoolExecutor executor{2};
+    auto main_thread = std::this_thread::get_id();
+    for (auto i = 0; i < 100; ++i) {
+        auto promise = sharp::Promise<int>{};
+        auto future = promise.get_future().via(&executor).then([&](auto f) {
+            EXPECT_NE(std::this_thread::get_id(), main_thread);
+            return f.get() * 2;
+        });
+        promise.set_value(i);
+        EXPECT_EQ(future.get(), i * 2);
+    }
+}
+
+TEST(Executor, TimingWheel) {
+    // timers in every level of the wheel and past the end of it expire on
+    // their tick, with the ticks in between skipped where they can be
+    sharp::detail::TimingWheel wheel;
+    auto expiries = std::vector<std::uint64_t>{
+        0, 1, 255, 256, 257, 1000, 65535, 65536, 70000, 1u << 24,
+        (1u << 24) + 12345};
+    auto nodes = std::vector<sharp::detail::TimerNode*>{};
+    for (auto expiry : expiries) {
+        nodes.push_back(new sharp::detail::TimerNode{[]() {}});
+        nodes.back()->expiry = expiry;
+        wheel.insert(nodes.back());
+    }
+    auto erased = new sharp::detail::TimerNode{[]() {}};
+    erased->expiry = 300;
+    wheel.insert(erased);
+    wheel.erase(erased);
+    EXPECT_EQ(wheel.size(), expiries.size());
+
+    auto expired = std::vector<std::uint64_t>{};
+    while (wheel.size()) {
+        if (auto ticks = wheel.idle_ticks()) {
+            wheel.skip(ticks);
+            continue;
+        }
+        auto tick = wheel.current();
+        wheel.advance([&](auto node) {
+            EXPECT_EQ(node->expiry, tick);
+            expired.push_back(tick);
+        });
+    }
+    EXPECT_EQ(expired, expiries);
+
+    for (auto node : nodes) {
+        node->release();
+        node->release();
+    }
+    erased->release();
+    erased->release();
+}
+
+TEST(Executor, TimerInvalidTick) {
+    auto options = sharp::TimerExecutor::Options{};
+    options.tick = std::chrono::nanoseconds{0};
+    EXPECT_THROW(sharp::TimerExecutor{options}, std::invalid_argument);
+}
+
+TEST(Executor, TimerRunsInOrder) {
+    sharp::TimerExecutor executor;
+    std::mutex mtx;
+    auto order = std::vector<int>{};
+    auto gate = std::make_unique<Gate>();
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto delay : {30, 10, 20}) {
+        executor.schedule([&, delay]() {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            auto lck = std::unique_lock<std::mutex>{mtx};
+            EXPECT_GE(elapsed, std::chrono::milliseconds{delay});
+            order.push_back(delay);
+            if (order.size() == 4) {
+                gate->release();
+            }
+        }, std::chrono::milliseconds{delay});
+    }
+    executor.add([&]() {
+        auto lck = std::unique_lock<std::mutex>{mtx};
+        order.push_back(0);
+    });
+
+    gate->wait();
+    EXPECT_EQ(order, (std::vector<int>{0, 10, 20, 30}));
+}
+
+TEST(Executor, TimerCancel) {
+    sharp::TimerExecutor executor;
+    std::atomic<int> ran{0};
+    auto cancelled = executor.schedule([&]() { ++ran; },
+                                       std::chrono::milliseconds{20});
+    auto fired = executor.schedule([&]() { ++ran; },
+                                   std::chrono::milliseconds{1});
+    EXPECT_EQ(executor.num_pending_closures(), 2);
+    EXPECT_TRUE(cancelled.cancel());
+    EXPECT_FALSE(cancelled.cancel());
+    EXPECT_EQ(executor.num_pending_closures(), 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    EXPECT_EQ(ran.load(), 1);
+    EXPECT_FALSE(fired.cancel());
+    EXPECT_EQ(executor.num_pending_closures(), 0);
+}
+
+TEST(Executor, TimerCascades) {
+    // with a 1 microsecond tick these go through the second and third
+    // levels of the wheel
+    auto options = sharp::TimerExecutor::Options{};
+    options.tick = std::chrono::microseconds{1};
+    sharp::TimerExecutor executor{options};
+    std::atomic<int> ran{0};
+    auto start = std::chrono::steady_clock::now();
+    for (auto delay : {1, 5, 100}) {
+        executor.schedule([&, delay]() {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            EXPECT_GE(elapsed, std::chrono::milliseconds{delay});
+            ++ran;
+        }, std::chrono::milliseconds{delay});
+    }
+    while (ran.load() != 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+}
+
+TEST(Executor, TimerManyTimers) {
+    const auto LIMIT = 100000;
+    std::atomic<int> ran{0};
+    {
+        sharp::TimerExecutor executor;
+        auto timers = std::vector<sharp::TimerExecutor::Timer>{};
+        timers.reserve(LIMIT);
+        for (auto i = 0; i < LIMIT; ++i) {
+            timers.push_back(executor.schedule([&]() { ++ran; },
+                        std::chrono::microseconds{i % 50000}));
+        }
+
+        // cancel every other timer, some of them will have fired already
+        auto cancelled = 0;
+        for (auto i = 0; i < LIMIT; i += 2) {
+            cancelled += timers[i].cancel();
+        }
+        while (ran.load() + cancelled != LIMIT) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        EXPECT_EQ(executor.num_pending_closures(), 0);
+    }
+    EXPECT_GE(ran.load(), LIMIT / 2);
+}
+
+TEST(Executor, TimerDestroysPendingTimers) {
+    auto destroyed = std::make_shared<int>(0);
+    {
+        sharp::TimerExecutor executor;
+        executor.schedule([destroyed]() {}, std::chrono::hours{1});
+        EXPECT_EQ(destroyed.use_count(), 2);
+    }
+    EXPECT_EQ(destroyed.use_count(), 1);
+}
+
+TEST(Executor, EventLoopRunsInOrderOnOneThread) {
+    auto order = std::vector<int>{};
+    auto threads = std::set<std::thread::id>{};
+    {
+        auto options = sharp::EventLoopExecutor::Options{};
+        options.name = "test-loop";
+        sharp::EventLoopExecutor loop{options};
+        EXPECT_FALSE(loop.is_loop_thread());
+        for (auto i = 0; i < 100; ++i) {
+            loop.add([&, i]() {
+                EXPECT_TRUE(loop.is_loop_thread());
+#if defined(__linux__)
+                char name[16] = {};
+                pthread_getname_np(pthread_self(), name, sizeof(name));
+                EXPECT_EQ(std::string{name}, "test-loop");
+#endif
+                threads.insert(std::this_thread::get_id());
+                order.push_back(i);
+            });
+        }
+    }
+
+    EXPECT_EQ(threads.size(), 1);
+    EXPECT_EQ(threads.count(std::this_thread::get_id()), 0);
+    EXPECT_EQ(order.size(), 100);
+    for (auto i = 0; i < 100; ++i) {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
+TEST(Executor, EventLoopWakesUpWhenIdle) {
+    sharp::EventLoopExecutor loop;
+    for (auto i = 0; i < 10; ++i) {
+        // give the loop time to go to sleep before every add
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        auto promise = sharp::Promise<int>{};
+        auto future = promise.get_future();
+        loop.add([promise = std::move(promise), i]() mutable {
+            promise.set_value(i);
+        });
+        EXPECT_EQ(future.get(), i);
+    }
+}
+
+TEST(Executor, EventLoopManyProducers) {
+    constexpr auto number_threads = 4;
+    constexpr auto per_thread = 10000;
+
+    // closures only touch state owned by the loop so they need no locks,
+    // and closures from one producer run in the order it added them
+    auto count = 0;
+    auto last = std::vector<int>(number_threads, -1);
+    auto in_order = true;
+    {
+        sharp::EventLoopExecutor loop;
+        auto producers = std::vector<std::thread>{};
+        for (auto t = 0; t < number_threads; ++t) {
+            producers.emplace_back([&, t]() {
+                for (auto i = 0; i < per_thread; ++i) {
+                    loop.add([&, t, i]() {
+                        in_order = in_order && (last[t] == i - 1);
+                        last[t] = i;
+                        ++count;
+                    });
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+    }
+
+    EXPECT_EQ(count, number_threads * per_thread);
+    EXPECT_TRUE(in_order);
+}
+
+TEST(Executor, EventLoopNestedAdds) {
+    std::atomic<int> count{0};
+    {
+        sharp::EventLoopExecutor loop;
+        loop.add([&]() {
+            for (auto i = 0; i < 10; ++i) {
+                loop.add([&]() { count.fetch_add(1); });
+            }
+
+            // closures added from the loop run after the current one
+            EXPECT_EQ(count.load(), 0);
+            EXPECT_EQ(loop.num_pending_closures(), 10);
+        });
+    }
+    EXPECT_EQ(count.load(), 10);
+}
+
+TEST(Executor, EventLoopFutures) {
+    sharp::EventLoopExecutor loop;
+    sharp::ThreadPoolExecutor pool{2};
+    for (auto i = 0; i < 100; ++i) {
+        auto promise = sharp::Promise<int>{};
+        auto future = promise.get_future().via(&loop).then([&](auto f) {
+            EXPECT_TRUE(loop.is_loop_thread());
+            return f.get() * 2;
+        });
+        pool.add([promise = std::move(promise), i]() mutable {
+            promise.set_value(i);
+        });
+        EXPECT_EQ(future.get(), i * 2);
+    }
+}
+
+TEST(Executor, InstrumentedInvalidExecutor) {
+    EXPECT_THROW(sharp::InstrumentedExecutor{nullptr}, std::invalid_argument);
+}
+
+TEST(Executor, InstrumentedCountsClosures) {
+    sharp::InstrumentedExecutor executor{sharp::InlineExecutor::get()};
+    EXPECT_EQ(executor.get_executor(), sharp::InlineExecutor::get());
+    auto empty = executor.snapshot();
+    EXPECT_EQ(empty.added, 0);
+    EXPECT_EQ(empty.run_time.percentile(0.5).count(), 0);
+    EXPECT_EQ(empty.run_time.mean().count(), 0);
+
+    auto ran = 0;
+    for (auto i = 0; i < 10; ++i) {
+        executor.add([&]() { ++ran; });
+    }
+    auto snapshot = executor.snapshot();
+    EXPECT_EQ(ran, 10);
+    EXPECT_EQ(snapshot.added, 10);
+    EXPECT_EQ(snapshot.started, 10);
+    EXPECT_EQ(snapshot.finished, 10);
+    EXPECT_EQ(snapshot.queue_latency.count, 10);
+    EXPECT_EQ(snapshot.run_time.count, 10);
+}
+
+TEST(Executor, InstrumentedHistograms) {
+    // two closures are held back in the pool's queue behind a slow one, so
+    // they wait at least as long as it runs
+    sharp::ThreadPoolExecutor pool{1};
+    sharp::InstrumentedExecutor executor{&pool};
+    auto slow = std::chrono::milliseconds{20};
+    executor.add([&]() { std::this_thread::sleep_for(slow); });
+    executor.add([]() {});
+    executor.add([]() {});
+    while (executor.snapshot().finished != 3) {
+        std::this_thread::yield();
+    }
+
+    auto snapshot = executor.snapshot();
+    EXPECT_EQ(snapshot.added, 3);
+    EXPECT_GE(snapshot.run_time.percentile(1.0), slow);
+    EXPECT_LT(snapshot.run_time.percentile(0.0), slow);
+    EXPECT_GE(snapshot.run_time.total, slow);
+    EXPECT_GE(snapshot.queue_latency.percentile(1.0), slow);
+
+    // the percentile is the upper end of the bucket the value falls in
+    auto histogram = sharp::InstrumentedExecutor::Histogram{};
+    histogram.buckets[11] = 1;
+    histogram.count = 1;
+    histogram.total = std::chrono::nanoseconds{1500};
+    EXPECT_EQ(histogram.percentile(0.5).count(), 2047);
+    EXPECT_EQ(histogram.mean().count(), 1500);
+}
+
+TEST(Executor, InstrumentedSnapshotWhileRunning) {
+    sharp::ThreadPoolExecutor pool{2};
+    sharp::InstrumentedExecutor executor{&pool};
+    std::atomic<bool> done{false};
+    auto reader = std::thread{[&]() {
+        while (!done.load()) {
+            auto snapshot = executor.snapshot();
+            EXPECT_LE(snapshot.finished, snapshot.started);
+            EXPECT_LE(snapshot.started, snapshot.added);
+        }
+    }};
+
+    for (auto i = 0; i < 1000; ++i) {
+        executor.add([]() {});
+    }
+    while (executor.snapshot().finished != 1000) {
+        std::this_thread::yield();
+    }
+    done.store(true);
+    reader.join();
+    EXPECT_EQ(executor.snapshot().queue_latency.count, 1000);
+}
+
+TEST(Executor, PriorityInvalidOptions) {
+    EXPECT_THROW(sharp::PriorityExecutor{0}, std::invalid_argument);
+    auto options = sharp::PriorityExecutor::Options{};
+    options.priorities = 0;
+    EXPECT_THROW(sharp::PriorityExecutor{options}, std::invalid_argument);
+    options.priorities = 2;
+    options.default_priority = 2;
+    EXPECT_THROW(sharp::PriorityExecutor{options}, std::invalid_argument);
+    options.default_priority = 0;
+    options.starvation_limit = 0;
+    EXPECT_THROW(sharp::PriorityExecutor{options}, std::invalid_argument);
+    options.starvation_limit = 1;
+    options.queue_capacity = 0;
+    EXPECT_THROW(sharp::PriorityExecutor{options}, std::invalid_argument);
+
+    sharp::PriorityExecutor executor{1};
+    EXPECT_EQ(executor.num_priorities(), 3);
+    EXPECT_EQ(executor.num_threads(), 1);
+    EXPECT_THROW(executor.add([]() {}, 3), std::out_of_range);
+    EXPECT_THROW(executor.with_priority(3), std::out_of_range);
+}
+
+namespace {
+
+    /**
+     * Holds the only worker of the executor in a closure till the gate is
+     * released, so closures added meanwhile queue up
+     */
+    void block_worker(sharp::PriorityExecutor& executor, Gate& gate) {
+        std::atomic<bool> blocked{false};
+        executor.add([&]() {
+            blocked.store(true);
+            gate.wait();
+        }, 0);
+        while (!blocked.load()) {
+            std::this_thread::yield();
+        }
+    }
+
+} // namespace <anonymous>
+
+TEST(Executor, PriorityRunsMostUrgentFirst) {
+    auto order = std::vector<std::size_t>{};
+    {
+        Gate gate;
+        sharp::PriorityExecutor executor{1};
+        block_worker(executor, gate);
+        for (auto i = 0; i < 3; ++i) {
+            for (auto priority : {std::size_t{2}, std::size_t{0},
+                                  std::size_t{1}}) {
+                executor.add([&order, priority]() {
+                    order.push_back(priority);
+                }, priority);
+            }
+        }
+        executor.add([&order]() { order.push_back(1); });
+        EXPECT_EQ(executor.num_pending_closures(), 10);
+        EXPECT_EQ(executor.num_pending_closures(0), 3);
+        EXPECT_EQ(executor.num_pending_closures(1), 4);
+        gate.release();
+    }
+
+    EXPECT_EQ(order, (std::vector<std::size_t>{0, 0, 0, 1, 1, 1, 1, 2, 2, 2}));
+}
+
+TEST(Executor, PriorityStarvationLimit) {
+    auto order = std::vector<std::size_t>{};
+    {
+        auto options = sharp::PriorityExecutor::Options{};
+        options.threads = 1;
+        options.starvation_limit = 2;
+        Gate gate;
+        sharp::PriorityExecutor executor{options};
+        block_worker(executor, gate);
+        for (auto i = 0; i < 8; ++i) {
+            executor.add([&order]() { order.push_back(0); }, 0);
+        }
+        for (auto i = 0; i < 3; ++i) {
+            executor.add([&order]() { order.push_back(2); }, 2);
+        }
+        gate.release();
+    }
+
+    // the least urgent queue gets a turn after being passed over twice
+    EXPECT_EQ(order, (std::vector<std::size_t>{0, 0, 2, 0, 0, 2, 0, 0, 2,
+                                               0, 0}));
+}
+
+TEST(Executor, PrioritySpillKeepsOrder) {
+    auto order = std::vector<int>{};
+    {
+        auto options = sharp::PriorityExecutor::Options{};
+        options.threads = 1;
+        options.queue_capacity = 2;
+        Gate gate;
+        sharp::PriorityExecutor executor{options};
+        block_worker(executor, gate);
+
+        // most of these do not fit in the ring and spill over, they still
+        // run in the order they were added
+        for (auto i = 0; i < 10; ++i) {
+            executor.add([&order, i]() { order.push_back(i); }, 1);
+        }
+        EXPECT_EQ(executor.num_pending_closures(1), 10);
+        gate.release();
+    }
+
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(Executor, PriorityManyProducers) {
+    constexpr auto number_threads = 4;
+    constexpr auto per_thread = 10000;
+    std::atomic<int> count{0};
+    {
+        auto options = sharp::PriorityExecutor::Options{};
+        options.threads = 4;
+        options.queue_capacity = 64;
+        sharp::PriorityExecutor executor{options};
+        auto producers = std::vector<std::thread>{};
+        for (auto t = 0; t < number_threads; ++t) {
+            producers.emplace_back([&, t]() {
+                for (auto i = 0; i < per_thread; ++i) {
+                    auto priority = static_cast<std::size_t>((t + i) % 3);
+                    executor.add([&]() { count.fetch_add(1); }, priority);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+    }
+    EXPECT_EQ(count.load(), number_threads * per_thread);
+}
+
+TEST(Executor, PriorityFutures) {
+    Gate gate;
+    sharp::PriorityExecutor executor{1};
+    auto urgent = executor.with_priority(0);
+    EXPECT_EQ(urgent, executor.with_priority(0));
+
+    // continuations chained after via() inherit the priority
+    block_worker(executor, gate);
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().via(urgent).then([](auto f) {
+        return f.get() + 1;
+    });
+    EXPECT_EQ(future.get_executor(), urgent);
+    auto chained = std::move(future).then([](auto f) { return f.get() * 2; });
+    EXPECT_EQ(chained.get_executor(), urgent);
+
+    promise.set_value(1);
+    EXPECT_EQ(executor.num_pending_closures(0), 1);
+    EXPECT_EQ(executor.num_pending_closures(1), 0);
+    gate.release();
+    EXPECT_EQ(chained.get(), 4);
+}
@@ -15,12 +15,17 @@
 #include <sharp/Traits/Traits.hpp>
 #include <sharp/Utility/Utility.hpp>
 #include <sharp/Executor/Executor.hpp>
+#include <sharp/Executor/TimerExecutor.hpp>
+#include <sharp/Future/detail/Awaitable.hpp>
 #include <sharp/Future/detail/Future-pre.hpp>
+#include <sharp/Future/detail/FutureImplPtr.hpp>
+#include <sharp/Portability/cpp20.hpp>
 
 #include <memory>
 #include <functional>
 #include <cstddef>
 #include <exception>
+#include <chrono>
 
 namespace sharp {
 
@@ -78,6 +83,15 @@ namespace detail {
          */
         Executor* get_executor();
 
+    protected:
+        /**
+         * Futures pass their executor along when they are moved or turned
+         * into other kinds of futures
+         */
+        ExecutableFuture() = default;
+        explicit ExecutableFuture(Executor* executor_in)
+            : executor{executor_in} {}
+
     private:
         /**
          * The executor member
@@ -245,6 +259,50 @@ public:
      */
     bool is_ready() const;
 
+    /**
+     * Asks for the computation behind this future to stop, this is a request
+     * that is passed on to whatever fulfills the future.  Continuations
+     * chained with .then() pass it on to the future they were attached to
+     * and are skipped when that finishes, the futures returned by when_all()
+     * and when_any() pass it on to all their inputs, and a promise can react
+     * to it through Promise::is_cancellation_requested() and
+     * Promise::set_interrupt_handler()
+     *
+     * The request stops at shared futures, they can have other holders that
+     * still want the value.  So cancelling a continuation of a shared future
+     * skips that continuation and leaves the shared future and its producer
+     * running
+     *
+     *      auto future = fetch(request).then([](auto response) {
+     *          return parse(response.get());
+     *      });
+     *      future.cancel();
+     *
+     * The future still has to be fulfilled, a future whose continuation was
+     * skipped holds a FutureError with the error code cancelled.  Cancelling
+     * a future that has finished does nothing
+     *
+     * Throws an exception if there is no shared state
+     */
+    void cancel();
+
+    /**
+     * Returns a future that is fulfilled with the result of this one if that
+     * comes within the given time, and with a FutureError holding the error
+     * code timeout otherwise.  When the time runs out first this future is
+     * cancelled, so whatever was going to fulfill it can stop
+     *
+     *      auto response = fetch(request).within(std::chrono::seconds{1});
+     *
+     * The deadline is kept by a TimerExecutor, so waiting on any number of
+     * deadlines costs no threads, and the timer is cancelled when the result
+     * comes in first.  The returned future has the executor of this one
+     *
+     * After calling this, the shared state for the future is left empty
+     */
+    Future<Type> within(std::chrono::nanoseconds duration,
+                        TimerExecutor* timers = TimerExecutor::get());
+
     /**
      * Shares the current future and returns a shared version of the same
      * future object, a shared future represents a copyable version of future,
@@ -329,6 +387,24 @@ public:
      */
     Future<Type> via(Executor* executor);
 
+#if SHARP_HAS_COROUTINES
+    /**
+     * Makes futures awaitable in C++20 coroutines, co_await returns the value
+     * or rethrows the exception the future was fulfilled with, like get()
+     *
+     *      auto response = co_await fetch(request);
+     *
+     * Instead of blocking the thread, the coroutine is suspended till the
+     * future is fulfilled and then resumed on the executor set with via(), so
+     * with the default inline executor it is resumed on the thread that
+     * fulfilled the future.  If the future is ready already the coroutine
+     * carries on without suspending
+     *
+     * After calling this, the shared state for the future is left empty
+     */
+    detail::FutureAwaiter<Type, false> operator co_await();
+#endif
+
     /**
      * Make friends with the promise class
      */
@@ -358,6 +434,13 @@ public:
     template <typename T>
     friend class sharp::SharedFuture;
 
+    /**
+     * Make friends with the when_all() and when_any() state, that attaches
+     * callbacks directly to the shared state
+     */
+    template <typename Futures>
+    friend class sharp::detail::WhenState;
+
     /**
      * Make friends with the make_future functions
      */
@@ -374,7 +457,7 @@ private:
      * Construct the future with the shared state passed in.  This should only
      * be called from the Promise class
      */
-    Future(const std::shared_ptr<detail::FutureImpl<Type>>& state);
+    Future(const detail::FutureImplPtr<Type>& state);
 
     /**
      * Check if the shared state exists and if it does not then throw an
@@ -390,7 +473,7 @@ private:
      * Both futures and promises hook into methods in this class for
      * functionality.  Both are thin wrappers around FutureImpl
      */
-    std::shared_ptr<detail::FutureImpl<Type>> shared_state;
+    detail::FutureImplPtr<Type> shared_state;
 };
 
 /**
@@ -414,6 +497,34 @@ Future<std::decay_t<Type>> make_exceptional_future(std::exception_ptr ptr);
 template <typename Type, typename Exception>
 Future<std::decay_t<Type>> make_exceptional_future(Exception);
 
+/**
+ * @class Unit
+ *
+ * The value of futures that only say that something has happened, since
+ * Future<void> is not supported
+ */
+struct Unit {};
+constexpr bool operator==(Unit, Unit) noexcept {
+    return true;
+}
+constexpr bool operator!=(Unit, Unit) noexcept {
+    return false;
+}
+
+/**
+ * @function sleep_for
+ *
+ * Returns a future that is fulfilled once the given time has passed, without
+ * blocking a thread for it.  The timer is kept by the given TimerExecutor and
+ * the future is fulfilled on its thread
+ *
+ *      sharp::sleep_for(std::chrono::milliseconds{100}).then([](auto) {
+ *          retry();
+ *      });
+ */
+inline Future<Unit> sleep_for(std::chrono::nanoseconds duration,
+                              TimerExecutor* timers = TimerExecutor::get());
+
 /**
  * @function when_all
  *
@@ -421,6 +532,11 @@ Future<std::decay_t<Type>> make_exceptional_future(Exception);
  * operations to finish, when_all accepts several future objects as arguments
  * and returns a single future that is fulfilled when all of the passed
  * futures are fulfilled
+ *
+ * The passed futures are moved into the result, the variadic form returns a
+ * future for a tuple of them and the iterator form a future for a vector of
+ * them.  Joining n futures costs one allocation for the whole join (besides
+ * the vector) and no locks
  */
 template <typename... Futures>
 auto when_all(Futures&&... futures);
@@ -436,6 +552,10 @@ auto when_all(BeginIterator first, EndIterator last);
  *
  * Since this has type restrictions this means that you cannot pass futures
  * that wrap different types of objects, all futures must be of the same type
+ *
+ * The result holds all the passed futures like the result of when_all(), the
+ * ones that have not finished yet are handed back with nothing attached to
+ * them so they can be waited on or given continuations of their own
  */
 template <typename... Futures>
 auto when_any(Futures&&... futures);
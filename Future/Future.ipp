@@ -20,6 +20,9 @@
 #include <iterator>
 #include <cassert>
 #include <vector>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
 
 namespace sharp {
 
@@ -34,42 +37,207 @@ namespace detail {
         && !sharp::IsInstantiationOf_v<Type, sharp::SharedFuture>>;
 
     /**
-     * The when_*** implementation, checks when the iteration has been
-     * finished by querying the number of finished objects against func, if
-     * func(number_of_finished) returns true then the value in the promise is
-     * set
+     * The state shared by the callbacks that when_all() and when_any() attach
+     * to their input futures, a fan in costs this one allocation no matter
+     * how many futures go into it
+     *
+     * The input futures are moved in here and handed back in the result, so
+     * there is nothing to copy into when they finish, and the callbacks only
+     * hold a pointer to this so they are stored in the shared states without
+     * allocating.  Both counts include one for the thread attaching the
+     * callbacks.  references is the number of callbacks that can still run
+     * and this is freed when it hits zero, arrivals is the number of inputs
+     * that have to finish before the result is published.  So the result is
+     * never published while the callbacks are still being attached
+     *
+     * When the result is published the callbacks on the input futures that
+     * have not finished are detached, so the losers of a when_any() do not
+     * come back here and can be given continuations of their own
+     *
+     * Cancelling the result cancels all the inputs that are not shared
+     * futures, through an interrupt handler that holds a reference of its
+     * own.  It holds off publishing
+     * the result like the attaching thread does while it goes through the
+     * inputs
      */
-    template <typename Func, typename... Futures>
-    auto when_impl_variadic(Func func, Futures&&... futures);
+    template <typename Futures>
+    class WhenState {
+    public:
+
+        /**
+         * Attach callbacks to the size futures and return a future that is
+         * fulfilled with them once needed of them have finished
+         */
+        static Future<Futures> start(Futures futures, std::int64_t size,
+                                     std::int64_t needed) {
+            auto state = new WhenState{std::move(futures), size, needed};
+            auto future = state->promise.get_future();
+            state->promise.shared_state->set_interrupt_handler([state]() {
+                state->cancel();
+            });
+            sharp::for_each(state->futures, [state](auto& input) {
+                input.shared_state->add_callback([state](auto&) {
+                    state->arrive();
+                });
+            });
+            state->arrive();
+            return future;
+        }
+
+    private:
+        WhenState(Futures futures_in, std::int64_t size, std::int64_t needed)
+            : futures{std::move(futures_in)},
+              references{size + 2},
+              arrivals{needed + 1} {}
+
+        void arrive() {
+            if (this->arrivals.fetch_sub(1) == 1) {
+                this->publish();
+            }
+            this->release(1);
+        }
+
+        void publish() {
+            // the callbacks and the handler detached here will never run, so
+            // their references go with them, the caller still holds one so
+            // this is not freed
+            auto detached = std::int64_t{0};
+            sharp::for_each(this->futures, [&detached](auto& input) {
+                if (WhenState::detach(input)) {
+                    ++detached;
+                }
+            });
+            if (this->promise.shared_state->remove_interrupt_handler()) {
+                ++detached;
+            }
+            this->promise.set_value(std::move(this->futures));
+            this->release(detached);
+        }
+
+        void cancel() {
+            // the inputs are only here till the result is published, so take
+            // an arrival to hold that off, unless it has been published
+            auto current = this->arrivals.load();
+            while (current > 0) {
+                if (this->arrivals.compare_exchange_weak(current,
+                                                         current + 1)) {
+                    sharp::for_each(this->futures, [](auto& input) {
+                        WhenState::cancel(input);
+                    });
+                    this->arrive();
+                    return;
+                }
+            }
+            this->release(1);
+        }
+
+        void release(std::int64_t count) {
+            if (this->references.fetch_sub(count) == count) {
+                delete this;
+            }
+        }
+
+        /**
+         * The callback on a future is the only one on its shared state, so
+         * it can be taken back.  A shared future can have continuations
+         * from others on its shared state, and remove_callback() might take
+         * one of those instead, so callbacks on shared futures are left to
+         * run and drop their reference when the shared future finishes
+         */
+        template <typename Type>
+        static bool detach(Future<Type>& input) {
+            return input.shared_state->remove_callback();
+        }
+        template <typename Type>
+        static bool detach(SharedFuture<Type>&) {
+            return false;
+        }
+
+        /**
+         * A shared future has other holders that still want its value, so
+         * cancelling the result does not get to cancel it for all of them
+         */
+        template <typename Type>
+        static void cancel(Future<Type>& input) {
+            input.shared_state->request_cancellation();
+        }
+        template <typename Type>
+        static void cancel(SharedFuture<Type>&) {}
+
+        Futures futures;
+        sharp::Promise<Futures> promise;
+        std::atomic<std::int64_t> references;
+        std::atomic<std::int64_t> arrivals;
+    };
+
+    /**
+     * Throws a FutureError with the error code no_state if any of the futures
+     * is not valid, the inputs are checked before any of them is moved from
+     */
+    template <typename Futures>
+    void check_when_inputs(const Futures& futures) {
+        sharp::for_each(futures, [](auto& future) {
+            if (!future.valid()) {
+                throw FutureError{FutureErrorCode::no_state};
+            }
+        });
+    }
 
     /**
-     * The when_*** runtime implementation, checks when the iteration has been
-     * finished by querying the number of finished objects against func, if
-     * func(number_of_finished) returns true then the value in the promise is
-     * set
+     * Moves the futures in the range into a vector sized up front, that is
+     * the storage the results are handed back in
      */
-    template <typename Func, typename BeginIterator, typename EndIterator>
-    auto when_impl_iter(Func func, BeginIterator first, EndIterator last);
+    template <typename BeginIterator, typename EndIterator>
+    auto collect_when_inputs(BeginIterator first, EndIterator last) {
+        auto range = sharp::range(first, last);
+        check_when_inputs(range);
+
+        auto futures = std::vector<std::decay_t<decltype(*first)>>{};
+        futures.reserve(std::distance(first, last));
+        for (auto& future : range) {
+            futures.push_back(sharp::move_if_movable(future));
+        }
+        return futures;
+    }
 
-    template <typename Type>
-    void move_from_promise(Promise<Type>& promise, Future<Type>& future) {
-        future = promise.get_future();
+    /**
+     * The continuation the current thread is running, if any.  executor is
+     * the executor it was scheduled on, state is the shared state it
+     * fulfills and depth is the number of continuations that have been run
+     * inline on this stack, see ComposableFuture::then()
+     */
+    struct FusedChain {
+        Executor* executor{nullptr};
+        const void* state{nullptr};
+        int depth{0};
+    };
+    inline FusedChain& fused_chain() {
+        static thread_local FusedChain chain;
+        return chain;
     }
 
+    /**
+     * The number of continuations that can be run inline one inside the
+     * other before the next one is scheduled on the executor again, this
+     * keeps long chains from running out of stack
+     */
+    constexpr auto max_fused_depth = 64;
+
 } // namespace detail
 
 template <typename Type>
 Future<Type>::Future() noexcept {}
 
 template <typename Type>
-Future<Type>::Future(const std::shared_ptr<detail::FutureImpl<Type>>& state)
+Future<Type>::Future(const detail::FutureImplPtr<Type>& state)
         : shared_state{state} {
     this->shared_state->test_and_set_retrieved_flag();
 }
 
 template <typename Type>
 Future<Type>::Future(Future&& other) noexcept
-        : shared_state{std::move(other.shared_state)} {}
+        : detail::ExecutableFuture<Future<Type>>{other},
+          shared_state{std::move(other.shared_state)} {}
 
 template <typename Type>
 Future<Type>::Future(Future<Future<Type>>&& other) : Future{} {
@@ -85,6 +253,13 @@ Future<Type>::Future(Future<Future<Type>>&& other) : Future{} {
     auto promise = sharp::Promise<Type>();
     *this = promise.get_future();
 
+    // cancelling this cancels the outer future, and the inner future once
+    // the outer one has finished
+    promise.shared_state->set_interrupt_handler(
+            [shared_state = other.shared_state]() {
+        shared_state->request_cancellation();
+    });
+
     // clear the shared state of the other future when this function exits
     auto deferred = defer_guard([&other]() {
         other.shared_state.reset();
@@ -94,6 +269,7 @@ Future<Type>::Future(Future<Future<Type>>&& other) : Future{} {
     // has been fulfilled with a Future<Type> object
     other.shared_state->add_callback([promise = std::move(promise)]
             (auto& shared_state_outer) mutable {
+        promise.shared_state->remove_interrupt_handler();
 
         // store an exception in the current future if either the inner future
         // is not ready or if there is an exception instead of a future in the
@@ -112,10 +288,19 @@ Future<Type>::Future(Future<Future<Type>>&& other) : Future{} {
         // inner future that will fire when the inner future has been
         // completed, this will then fulfill *this with the value returned by
         // calling get() on the resulting future
-        assert(shared_state_outer.get_value().shared_state);
-        shared_state_outer.get_value().shared_state->add_callback(
-                [promise = std::move(promise)]
+        auto& inner = shared_state_outer.get_value().shared_state;
+        assert(inner);
+        if (promise.shared_state->is_cancellation_requested()) {
+            inner->request_cancellation();
+        } else {
+            promise.shared_state->set_interrupt_handler(
+                    [shared_state = inner]() {
+                shared_state->request_cancellation();
+            });
+        }
+        inner->add_callback([promise = std::move(promise)]
                 (auto& shared_state_inner) mutable {
+            promise.shared_state->remove_interrupt_handler();
             if (shared_state_inner.contains_exception()) {
                 promise.set_exception(shared_state_inner.get_exception_ptr());
             } else {
@@ -127,6 +312,7 @@ Future<Type>::Future(Future<Future<Type>>&& other) : Future{} {
 
 template <typename Type>
 Future<Type>& Future<Type>::operator=(Future&& other) noexcept {
+    this->detail::ExecutableFuture<Future<Type>>::operator=(other);
     this->shared_state = std::move(other.shared_state);
     return *this;
 }
@@ -141,6 +327,67 @@ bool Future<Type>::valid() const noexcept {
     return static_cast<bool>(this->shared_state);
 }
 
+template <typename Type>
+Future<Type> Future<Type>::within(std::chrono::nanoseconds duration,
+                                 TimerExecutor* timers) {
+    this->check_shared_state();
+    if (this->shared_state->is_ready()) {
+        return std::move(*this);
+    }
+
+    auto deferred = defer_guard([this]() {
+        this->shared_state.reset();
+    });
+
+    // whichever of the result and the timer comes in first fulfills the
+    // returned future, if the result wins the timer is cancelled and if the
+    // timer wins this future is cancelled
+    struct Within {
+        sharp::Promise<Type> promise;
+        std::atomic<bool> done{false};
+        TimerExecutor::Timer timer;
+    };
+    auto within = std::make_shared<Within>();
+    auto future = within->promise.get_future();
+    within->promise.shared_state->set_interrupt_handler(
+            [shared_state = this->shared_state]() {
+        shared_state->request_cancellation();
+    });
+
+    within->timer = timers->schedule(
+            [within, shared_state = this->shared_state]() {
+        // cancel this future before failing the returned one, so whoever
+        // sees the timeout also sees the cancellation
+        if (!within->done.exchange(true)) {
+            within->promise.shared_state->remove_interrupt_handler();
+            shared_state->request_cancellation();
+            auto exc = FutureError{FutureErrorCode::timeout};
+            within->promise.set_exception(std::make_exception_ptr(exc));
+        }
+    }, duration);
+
+    this->shared_state->add_callback([within](auto& state) {
+        if (within->done.exchange(true)) {
+            return;
+        }
+        within->timer.cancel();
+        within->promise.shared_state->remove_interrupt_handler();
+        if (state.contains_exception()) {
+            within->promise.set_exception(state.get_exception_ptr());
+        } else {
+            within->promise.set_value(state.get());
+        }
+    });
+
+    return future.via(this->get_executor());
+}
+
+template <typename Type>
+void Future<Type>::cancel() {
+    this->check_shared_state();
+    this->shared_state->request_cancellation();
+}
+
 template <typename Type>
 void Future<Type>::wait() const {
     this->check_shared_state();
@@ -197,13 +444,21 @@ Future<Type> Future<Type>::via(Executor* executor) {
     return this->template ExecutableFuture<Future<Type>>::via(executor);
 }
 
+#if SHARP_HAS_COROUTINES
+template <typename Type>
+detail::FutureAwaiter<Type, false> Future<Type>::operator co_await() {
+    this->check_shared_state();
+    return {std::move(this->shared_state), this->get_executor()};
+}
+#endif
+
 template <typename Type>
 Future<std::decay_t<Type>> make_ready_future(Type&& object) {
     // make a promise with the value and then return the corresponding future
     auto promise = sharp::Promise<std::decay_t<Type>>{};
     auto future = promise.get_future();
     assert(future.shared_state);
-    future.shared_state->set_value_no_lock(std::forward<Type>(object));
+    future.shared_state->set_value(std::forward<Type>(object));
     return future;
 }
 
@@ -212,7 +467,7 @@ Future<std::decay_t<Type>> make_exceptional_future(std::exception_ptr ptr) {
     auto promise = sharp::Promise<Type>{};
     auto future = promise.get_future();
     assert(future.shared_state);
-    future.shared_state->set_exception_no_lock(ptr);
+    future.shared_state->set_exception(ptr);
     return future;
 }
 
@@ -221,19 +476,24 @@ Future<std::decay_t<Type>> make_exceptional_future(Exception exception) {
     auto promise = sharp::Promise<Type>{};
     auto future = promise.get_future();
     assert(future.shared_state);
-    future.shared_state->set_exception_no_lock(
+    future.shared_state->set_exception(
             std::make_exception_ptr(exception));
     return future;
 }
 
+inline Future<Unit> sleep_for(std::chrono::nanoseconds duration,
+                              TimerExecutor* timers) {
+    auto promise = sharp::Promise<Unit>{};
+    auto future = promise.get_future();
+    timers->schedule([promise = std::move(promise)]() mutable {
+        promise.set_value(Unit{});
+    }, duration);
+    return future;
+}
+
 template <typename... Futures>
 auto when_all(Futures&&... futures) {
-    // make the function that checks when the futures have been completed
-    int length = sizeof...(futures);
-    auto done = [length](int number_done) {
-        assert(number_done <= length);
-        return (number_done == length);
-    };
+    detail::check_when_inputs(std::forward_as_tuple(futures...));
 
     // get the executor from the first element in the argument list, no need
     // to use std::forward here because it's okay to just make a tuple of
@@ -241,7 +501,10 @@ auto when_all(Futures&&... futures) {
     auto executor = std::get<0>(std::forward_as_tuple(futures...))
         .get_executor();
 
-    return detail::when_impl_variadic(done, std::forward<Futures>(futures)...)
+    using Tuple = std::tuple<std::decay_t<Futures>...>;
+    auto length = static_cast<std::int64_t>(sizeof...(futures));
+    return detail::WhenState<Tuple>::start(
+            Tuple{sharp::move_if_movable(futures)...}, length, length)
         .via(executor);
 }
 
@@ -249,20 +512,18 @@ template <typename BeginIterator, typename EndIterator,
           detail::EnableIfNotFutureType<BeginIterator>* = nullptr,
           detail::EnableIfNotFutureType<BeginIterator>* = nullptr>
 auto when_all(BeginIterator first, EndIterator last) {
-    int length = std::distance(first, last);
-    auto done = [length](int number_done) {
-        assert(number_done <= length);
-        return (number_done == length);
-    };
-    return detail::when_impl_iter(done, first, last)
-        .via(first->get_executor());
+    auto executor = first->get_executor();
+    auto futures = detail::collect_when_inputs(first, last);
+    auto length = static_cast<std::int64_t>(futures.size());
+    using Vector = decltype(futures);
+    return detail::WhenState<Vector>::start(
+            std::move(futures), length, length)
+        .via(executor);
 }
 
 template <typename... Futures>
 auto when_any(Futures&&... futures) {
-    auto done = [](int number_done) {
-        return number_done;
-    };
+    detail::check_when_inputs(std::forward_as_tuple(futures...));
 
     // get the executor from the first element in the argument list, no need
     // to use std::forward here because it's okay to just make a tuple of
@@ -270,7 +531,10 @@ auto when_any(Futures&&... futures) {
     auto executor = std::get<0>(std::forward_as_tuple(futures...))
         .get_executor();
 
-    return detail::when_impl_variadic(done, std::forward<Futures>(futures)...)
+    using Tuple = std::tuple<std::decay_t<Futures>...>;
+    auto length = static_cast<std::int64_t>(sizeof...(futures));
+    return detail::WhenState<Tuple>::start(
+            Tuple{sharp::move_if_movable(futures)...}, length, 1)
         .via(executor);
 }
 
@@ -278,11 +542,13 @@ template <typename BeginIterator, typename EndIterator,
           detail::EnableIfNotFutureType<BeginIterator>* = nullptr,
           detail::EnableIfNotFutureType<BeginIterator>* = nullptr>
 auto when_any(BeginIterator first, EndIterator last) {
-    auto done = [](int number_done) {
-        return number_done;
-    };
-    return detail::when_impl_iter(done, first, last)
-        .via(first->get_executor());
+    auto executor = first->get_executor();
+    auto futures = detail::collect_when_inputs(first, last);
+    auto length = static_cast<std::int64_t>(futures.size());
+    using Vector = decltype(futures);
+    return detail::WhenState<Vector>::start(
+            std::move(futures), length, std::min<std::int64_t>(length, 1))
+        .via(executor);
 }
 
 namespace detail {
@@ -308,12 +574,35 @@ namespace detail {
         auto promise = Promise<decltype(func(std::declval<FutureType>()))>{};
         auto future = promise.get_future();
 
+        // cancelling the returned future cancels this one, till this one
+        // finishes and the handler is removed.  A shared future has other
+        // holders and other continuations that still want its value, so
+        // cancelling one of its continuations only skips that continuation
+        if (!sharp::IsInstantiationOf_v<FutureType, sharp::SharedFuture>) {
+            promise.shared_state->set_interrupt_handler(
+                    [shared_state = this->instance().shared_state]() {
+                shared_state->request_cancellation();
+            });
+        }
+
         this->instance().shared_state->add_callback(
                 [executor = this->instance().get_executor(),
                  promise = std::move(promise),
                  func = std::forward<Func>(func),
                  shared_state = this->instance().shared_state]
                 (auto&) mutable {
+            const void* state = shared_state.get();
+
+            // this has finished so there is nothing left to cancel here, and
+            // if the returned future has been cancelled skip the callback
+            // without going through the executor
+            promise.shared_state->remove_interrupt_handler();
+            if (promise.shared_state->is_cancellation_requested()) {
+                auto exc = FutureError{FutureErrorCode::cancelled};
+                promise.set_exception(std::make_exception_ptr(exc));
+                return;
+            }
+
             // bypass the normal execution and assign the shared pointer
             // directly, moving the shared pointer here which refers to the
             // instance on which this callback is executing is safe because
@@ -324,12 +613,31 @@ namespace detail {
             fut.shared_state = std::move(shared_state);
 
             // try and get the value from the callback, if an exception was
-            // thrown, propagate that
+            // thrown, propagate that.  While the callback runs this thread
+            // is marked as running a continuation on the executor, so that
+            // continuations fulfilled from in here can run right away
             assert(executor);
-            executor->add(
-                    [func = std::forward<Func>(func),
-                     fut = std::move(fut),
-                     promise = std::move(promise)]() mutable {
+            auto continuation = [executor,
+                                 func = std::forward<Func>(func),
+                                 fut = std::move(fut),
+                                 promise = std::move(promise)]() mutable {
+                auto& chain = fused_chain();
+                auto previous = chain;
+                chain.executor = executor;
+                chain.state = promise.shared_state.get();
+                ++chain.depth;
+                auto deferred = defer_guard([&chain, previous]() {
+                    chain = previous;
+                });
+
+                // the returned future might have been cancelled while this
+                // was waiting in the executor
+                if (promise.shared_state->is_cancellation_requested()) {
+                    auto exc = FutureError{FutureErrorCode::cancelled};
+                    promise.set_exception(std::make_exception_ptr(exc));
+                    return;
+                }
+
                 try {
                     auto val = func(std::move(fut));
                     promise.set_value(std::move(val));
@@ -337,7 +645,23 @@ namespace detail {
                     promise.set_exception(std::current_exception());
                     return;
                 }
-            });
+            };
+
+            // if the future was fulfilled by the continuation before this one
+            // in the chain, running on the same executor, then this is
+            // already where the executor would run the next one, so run it
+            // inline instead of scheduling it again.  This fuses a chain of
+            // .then() calls on one executor into a single trip through the
+            // executor.  Anything else fulfilled from inside a continuation,
+            // say a promise the callback set, is scheduled as usual so
+            // unrelated callbacks do not run inside the callback
+            auto& chain = fused_chain();
+            if (chain.executor == executor && chain.state == state
+                    && chain.depth < max_fused_depth) {
+                continuation();
+            } else {
+                executor->add(std::move(continuation));
+            }
         });
 
         return future;
@@ -354,121 +678,6 @@ namespace detail {
         return this->executor;
     }
 
-    // helper trait
-    template <typename F>
-    struct PromiseFor {
-        using type = sharp::Promise<typename std::decay_t<F>::value_type>;
-    };
-
-    /**
-     * Waits for all the input futures to finish being set asynchronusly
-     */
-    template <typename Futures, typename Bookkeeping, typename  Func>
-    void wait_for_all(Futures&& futures, Bookkeeping& bookkeeping, Func f) {
-
-        // iterate through all the futures and signal the promsise when all of
-        // them have been satisfied
-        sharp::for_each(futures, [&bookkeeping, &f](auto& future, auto index) {
-            // when the future is complete move it into the tuple of ready
-            // futures, which will at the end contain all the futures that are
-            // ready at a stage where you can signal to the user
-            future.then([bookkeeping, index, f](auto future) {
-                sharp::fetch(bookkeeping->return_promises, index)
-                    .set_value(future.get());
-
-                // if all the futures have been completed, signal
-                ++bookkeeping->counter;
-                if (f(bookkeeping->counter.load())) {
-                    bookkeeping->promise.set_value(
-                        std::move(bookkeeping->return_futures));
-                }
-
-                // return to make the future code not error out
-                return 0;
-            });
-        });
-    }
-
-    template <typename Func, typename... Futures>
-    auto when_impl_variadic(Func f, Futures&&... args) {
-
-        // the returning future will be instantiated with this return type
-        using ReturnFutures = std::tuple<std::decay_t<Futures>...>;
-        using ReturnPromises = sharp::Transform_t<PromiseFor, ReturnFutures>;
-
-        // A single struct to avoid making 2 shared pointers instead of 1
-        struct Bookkeeping {
-            sharp::Promise<ReturnFutures> promise;
-            ReturnFutures return_futures;
-            ReturnPromises return_promises;
-            std::atomic<int> counter{0};
-            Bookkeeping() {
-                // set each future to be from the corresponding promise
-                sharp::for_each(this->return_futures, [this]
-                        (auto& future, auto index) {
-                    move_from_promise(
-                        std::get<static_cast<int>(index)>(
-                            this->return_promises),
-                        future);
-                });
-            }
-        };
-
-        // construct the return type from the argument type list, then construct
-        // an object that will contain the ready futures when they are all done
-        auto futures = std::make_tuple(sharp::move_if_movable(args)...);
-        auto bookkeeping = std::make_shared<Bookkeeping>();
-        auto future = bookkeeping->promise.get_future();
-
-        // wait for all the futures to finish asynchronously by attaching
-        // callbacks on all the input futures
-        wait_for_all(futures, bookkeeping, f);
-
-        return future;
-    }
-
-    template <typename Func, typename BeginIterator, typename EndIterator>
-    auto when_impl_iter(Func f, BeginIterator first, EndIterator last) {
-
-        // the type of the future that is to be returned
-        using FutureValueType = typename std::decay_t<decltype(*first)>
-            ::value_type;
-        using ReturnFutures = std::vector<std::decay_t<decltype(*first)>>;
-        using ReturnPromises = std::vector<sharp::Promise<FutureValueType>>;
-
-        // The bookkeeping shared struct, this will encapsulate three other
-        // things, that help in both hitting the cache more and saving on heap
-        // allocations via shared pointers
-        struct Bookkeeping {
-            sharp::Promise<ReturnFutures> promise;
-            ReturnFutures return_futures;
-            ReturnPromises return_promises;
-            std::atomic<int> counter{0};
-            Bookkeeping(int length) {
-                this->return_promises.reserve(length);
-                this->return_futures.reserve(length);
-                for (auto i : sharp::range(0, length)) {
-                    this->return_promises.emplace_back();
-                    this->return_futures.emplace_back();
-                    move_from_promise(this->return_promises[i],
-                            this->return_futures[i]);
-                }
-            }
-        };
-
-        // make the bookkeeping objects and make the object to return
-        auto length = std::distance(first, last);
-        auto bookkeeping = std::make_shared<Bookkeeping>(length);
-        auto future = bookkeeping->promise.get_future();
-
-        // iterate through all the futures in the bookkeeping struct and then
-        // set callbacks on them via .then(), when sufficient futures have
-        // finished, signal via the promise that the task has been done
-        wait_for_all(sharp::range(first, last), bookkeeping, f);
-
-        return future;
-    }
-
 } // namespace detail
 
 template <typename Type>
@@ -11,6 +11,8 @@ namespace detail {
     const std::string FUTURE_ALREADY_RETRIEVED{"future already retrieved"};
     const std::string PROMISE_ALREADY_SATISFIED{"promise already satisfied"};
     const std::string NO_STATE{"no state"};
+    const std::string CANCELLED{"cancelled"};
+    const std::string TIMEOUT{"timeout"};
 } // namespace detail
 
 /**
@@ -34,7 +36,7 @@ std::string FutureErrorCategory::message(int value) const {
 
     // assert that the integer passed to FutureErrorCategory is within the
     // range of the enumeration, otherwise there will be undefined behavior
-    assert(value <= static_cast<int>(FutureErrorCode::no_state));
+    assert(value <= static_cast<int>(FutureErrorCode::timeout));
     switch (static_cast<FutureErrorCode>(value)) {
         case FutureErrorCode::broken_promise:
             return detail::BROKEN_PROMISE;
@@ -48,6 +50,12 @@ std::string FutureErrorCategory::message(int value) const {
         case FutureErrorCode::no_state:
             return detail::NO_STATE;
             break;
+        case FutureErrorCode::cancelled:
+            return detail::CANCELLED;
+            break;
+        case FutureErrorCode::timeout:
+            return detail::TIMEOUT;
+            break;
     }
 }
 
@@ -28,12 +28,17 @@ namespace sharp {
  *                           promise that already has one of those stored
  * no_state attempt to access future or promise methods when there is no
  *          shared state
+ * cancelled the future was cancelled before its value was computed
+ * timeout the value did not come in within the time it was given, see
+ *         Future::within()
  */
 enum class FutureErrorCode : int {
     broken_promise,
     future_already_retrieved,
     promise_already_satisfied,
-    no_state
+    no_state,
+    cancelled,
+    timeout
 };
 
 /**
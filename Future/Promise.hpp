@@ -12,6 +12,8 @@
 #pragma once
 
 #include <sharp/Tags/Tags.hpp>
+#include <sharp/Future/detail/Future-pre.hpp>
+#include <sharp/Future/detail/FutureImplPtr.hpp>
 
 #include <initializer_list>
 #include <exception>
@@ -112,12 +114,45 @@ public:
      */
     void set_exception(std::exception_ptr ptr);
 
+    /**
+     * Cooperative cancellation, consumers ask for the result to not be
+     * computed anymore with Future::cancel().  The producer can either poll
+     * for that with is_cancellation_requested() or register a handler with
+     * set_interrupt_handler() that is run on the thread asking for
+     * cancellation, or right away if cancellation has already been asked for
+     *
+     *      auto promise = sharp::Promise<int>{};
+     *      promise.set_interrupt_handler([&connection]() {
+     *          connection.close();
+     *      });
+     *
+     * Cancellation is only a request, the promise still has to be fulfilled,
+     * usually with a FutureError holding FutureErrorCode::cancelled.  Only
+     * one handler can be set, and it must not throw
+     *
+     * Both throw an exception if there is no shared state
+     */
+    bool is_cancellation_requested() const;
+    template <typename Func>
+    void set_interrupt_handler(Func&& func);
+
+    /**
+     * Make friends with the classes that link the cancellation of the
+     * futures they return to the futures they were made from
+     */
+    template <typename T>
+    friend class sharp::Future;
+    template <typename T>
+    friend class sharp::detail::ComposableFuture;
+    template <typename Futures>
+    friend class sharp::detail::WhenState;
+
 private:
 
     /**
      * The shared state for the promise
      */
-    std::shared_ptr<detail::FutureImpl<Type>> shared_state;
+    detail::FutureImplPtr<Type> shared_state;
 
     /**
      * Checks if the shared state exists, and if it doesn't then this function
@@ -11,7 +11,7 @@ namespace sharp {
 
 template <typename Type>
 Promise<Type>::Promise()
-        : shared_state{std::make_shared<detail::FutureImpl<Type>>()} {}
+        : shared_state{new detail::FutureImpl<Type>{}} {}
 
 template <typename Type>
 Promise<Type>::~Promise() {
@@ -62,6 +62,19 @@ void Promise<Type>::set_exception(std::exception_ptr ptr) {
     this->shared_state->set_exception(ptr);
 }
 
+template <typename Type>
+bool Promise<Type>::is_cancellation_requested() const {
+    this->check_shared_state();
+    return this->shared_state->is_cancellation_requested();
+}
+
+template <typename Type>
+template <typename Func>
+void Promise<Type>::set_interrupt_handler(Func&& func) {
+    this->check_shared_state();
+    this->shared_state->set_interrupt_handler(std::forward<Func>(func));
+}
+
 template <typename Type>
 void Promise<Type>::check_shared_state() const {
     if (!this->shared_state) {
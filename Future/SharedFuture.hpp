@@ -10,6 +10,16 @@
  * As a result this has slightly different implications on the classes that
  * can be used to instantiate the future, unlike in a future
  *
+ * Any number of threads can block on copies of a shared future and any
+ * number of continuations can be attached to them, all of them are woken up
+ * or run when the shared state is fulfilled.  Blocked threads are woken up
+ * one by one from a list of their own, so they do not stampede on a shared
+ * lock on the way out
+ *
+ * Cancelling a future made from a shared future, with .then(), when_all() or
+ * when_any(), does not cancel the shared future.  Others can be waiting on
+ * it, so a shared future is only ever finished by its producer
+ *
  * Any missing documentation is the same as the corresponding documentation
  * for future
  */
@@ -17,7 +27,10 @@
 #pragma once
 
 #include <sharp/Future/Future.hpp>
+#include <sharp/Future/detail/Awaitable.hpp>
+#include <sharp/Future/detail/FutureImplPtr.hpp>
 #include <sharp/Executor/Executor.hpp>
+#include <sharp/Portability/cpp20.hpp>
 
 #include <memory>
 
@@ -76,6 +89,15 @@ public:
                   = nullptr>
     auto then(Func&& func) -> decltype(func(*this));
 
+#if SHARP_HAS_COROUTINES
+    /**
+     * The same as sharp::Future, except that co_await returns a const
+     * reference to the value like get() does and this shared future stays
+     * valid
+     */
+    detail::FutureAwaiter<Type, true> operator co_await();
+#endif
+
     /**
      * Make friends with the promise class
      */
@@ -105,13 +127,19 @@ public:
     template <typename T>
     friend class sharp::detail::ComposableFuture;
 
+    /**
+     * Make friends with the when_all() and when_any() state
+     */
+    template <typename Futures>
+    friend class sharp::detail::WhenState;
+
 private:
 
     void check_shared_state() const;
     template <typename Func>
     auto then_impl(Func&& func) -> Future<decltype(func(std::move(*this)))>;
 
-    std::shared_ptr<detail::FutureImpl<Type>> shared_state;
+    detail::FutureImplPtr<Type> shared_state;
 };
 
 } // namespace sharp
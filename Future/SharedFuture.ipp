@@ -8,32 +8,23 @@
 
 namespace sharp {
 
-namespace detail {
-
-    /**
-     * Assigns a shared future from the promise
-     */
-    template <typename Type>
-    void move_from_promise(Promise<Type>& promise, SharedFuture<Type>& future) {
-        future = promise.get_future().share();
-    }
-
-} // namespace detail
-
 template <typename Type>
 SharedFuture<Type>::SharedFuture() noexcept {};
 
 template <typename Type>
 SharedFuture<Type>::SharedFuture(SharedFuture&& other) noexcept
-        : shared_state{std::move(other.shared_state)} {}
+        : detail::ExecutableFuture<SharedFuture<Type>>{other},
+          shared_state{std::move(other.shared_state)} {}
 
 template <typename Type>
 SharedFuture<Type>::SharedFuture(const SharedFuture& other)
-        : shared_state{other.shared_state} {}
+        : detail::ExecutableFuture<SharedFuture<Type>>{other},
+          shared_state{other.shared_state} {}
 
 template <typename Type>
 SharedFuture<Type>::SharedFuture(Future<Type>&& other) noexcept
-        : shared_state{std::move(other.shared_state)} {}
+        : detail::ExecutableFuture<SharedFuture<Type>>{other.get_executor()},
+          shared_state{std::move(other.shared_state)} {}
 
 template <typename Type>
 SharedFuture<Type>::SharedFuture(Future<SharedFuture<Type>>&& other) {
@@ -134,6 +125,14 @@ auto SharedFuture<Type>::then(Func&& func)
         .via(this->get_executor());
 }
 
+#if SHARP_HAS_COROUTINES
+template <typename Type>
+detail::FutureAwaiter<Type, true> SharedFuture<Type>::operator co_await() {
+    this->check_shared_state();
+    return {this->shared_state, this->get_executor()};
+}
+#endif
+
 template <typename Type>
 SharedFuture<Type> Future<Type>::share() {
     this->check_shared_state();
@@ -0,0 +1,138 @@
+/**
+ * @file Task.hpp
+ * @author Aaryaman Sagar
+ *
+ * A lazily started coroutine type for writing asynchronous code in C++20
+ * coroutines, tasks await each other directly through symmetric transfer and
+ * futures are only needed at the edges.  Only available when compiling with
+ * coroutine support, see sharp/Portability/cpp20.hpp
+ */
+
+#pragma once
+
+#include <sharp/Portability/cpp20.hpp>
+
+#if SHARP_HAS_COROUTINES
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Executor/InlineExecutor.hpp>
+#include <sharp/Future/Future.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+
+namespace sharp {
+
+template <typename Type>
+class Task;
+
+namespace detail {
+
+    /**
+     * The promise type of tasks and the awaiter for co_await on them, see
+     * Task.ipp
+     */
+    template <typename Type>
+    class TaskPromise;
+    template <typename Type>
+    class TaskAwaiter;
+
+} // namespace detail
+
+/**
+ * @class Task
+ *
+ * The return type of a coroutine that produces a value of type Type
+ * asynchronously.  A task does not start running when it is called, it
+ * starts when it is awaited, and then runs on the thread that awaits it
+ * till it suspends on something
+ *
+ *      sharp::Task<Response> fetch(Request request) {
+ *          auto connection = co_await connect(request.host);
+ *          co_return co_await connection.send(request);
+ *      }
+ *
+ *      sharp::Task<int> count(std::vector<Request> requests) {
+ *          auto total = 0;
+ *          for (auto& request : requests) {
+ *              total += (co_await fetch(request)).size();
+ *          }
+ *          co_return total;
+ *      }
+ *
+ * Awaiting a task suspends the awaiting coroutine and resumes the task
+ * directly, and when the task finishes it resumes the awaiting coroutine
+ * directly, both through symmetric transfer.  So a chain of tasks awaiting
+ * each other does not grow the stack however deep it gets or however many
+ * of them finish without suspending, and there is no shared state or
+ * executor in between, the only allocation is the coroutine frame.  Note
+ * that this relies on the compiler turning the transfer into a tail call,
+ * which GCC only does in optimized builds
+ *
+ * A task is started from code that is not a coroutine with start(), which
+ * returns a future for the result
+ *
+ *      auto future = count(requests).start(&executor);
+ *
+ * Exceptions thrown out of the coroutine are rethrown by co_await, or stored
+ * in the future returned by start().  A task can be awaited or started only
+ * once, and destroying a task that has not been started destroys the
+ * coroutine without running it
+ */
+template <typename Type = void>
+class Task {
+public:
+    using value_type = Type;
+    using promise_type = detail::TaskPromise<Type>;
+
+    /**
+     * Tasks are move only, a moved from task is not valid
+     */
+    Task() noexcept = default;
+    Task(Task&& other) noexcept;
+    Task& operator=(Task&& other) noexcept;
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task();
+
+    /**
+     * Returns true if the task holds a coroutine that has not been awaited or
+     * started
+     */
+    bool valid() const noexcept;
+
+    /**
+     * Run the task and return a future for its result, the task is started
+     * through the executor, so with the default inline executor it runs on
+     * the calling thread till it first suspends.  A Task<void> gives a
+     * Future<Unit>
+     *
+     * Throws a FutureError with the error code no_state if the task is not
+     * valid
+     */
+    auto start(Executor* executor = InlineExecutor::get())
+        -> Future<std::conditional_t<std::is_void<Type>::value, Unit, Type>>;
+
+    /**
+     * The awaiter for co_await on a task, see the class documentation
+     *
+     * Throws a FutureError with the error code no_state if the task is not
+     * valid
+     */
+    detail::TaskAwaiter<Type> operator co_await() &&;
+
+private:
+    friend class detail::TaskPromise<Type>;
+    explicit Task(std::coroutine_handle<promise_type> handle_in) noexcept
+        : handle{handle_in} {}
+
+    std::coroutine_handle<promise_type> handle{nullptr};
+};
+
+} // namespace sharp
+
+#include <sharp/Future/Task.ipp>
+
+#endif // SHARP_HAS_COROUTINES
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Future/Future.hpp>
+#include <sharp/Future/FutureError.hpp>
+#include <sharp/Future/Promise.hpp>
+#include <sharp/Future/Task.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * Suspends a task when it finishes and transfers control to the
+     * coroutine awaiting it, or back to whoever resumed the task if nothing
+     * is awaiting it
+     */
+    class TaskFinalAwaiter {
+    public:
+        bool await_ready() const noexcept {
+            return false;
+        }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<Promise> handle) noexcept {
+            if (auto continuation = handle.promise().continuation) {
+                return continuation;
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * The parts of the promise type of a task that do not depend on the type
+     * of the result.  Tasks start out suspended, and an exception escaping
+     * the coroutine is kept here till the awaiter asks for the result
+     */
+    class TaskPromiseBase {
+    public:
+        std::suspend_always initial_suspend() const noexcept {
+            return {};
+        }
+        TaskFinalAwaiter final_suspend() const noexcept {
+            return {};
+        }
+        void unhandled_exception() noexcept {
+            this->exception = std::current_exception();
+        }
+
+        /**
+         * The coroutine awaiting the task, resumed when the task finishes
+         */
+        std::coroutine_handle<> continuation{nullptr};
+
+    protected:
+        void check_result() const {
+            if (this->exception) {
+                std::rethrow_exception(this->exception);
+            }
+        }
+
+        std::exception_ptr exception;
+    };
+
+    template <typename Type>
+    class TaskPromise : public TaskPromiseBase {
+    public:
+        Task<Type> get_return_object() noexcept {
+            using Handle = std::coroutine_handle<TaskPromise>;
+            return Task<Type>{Handle::from_promise(*this)};
+        }
+
+        template <typename Value = Type>
+        void return_value(Value&& value) {
+            this->value.emplace(std::forward<Value>(value));
+        }
+
+        Type result() {
+            this->check_result();
+            return std::move(*this->value);
+        }
+
+    private:
+        std::optional<Type> value;
+    };
+
+    template <>
+    class TaskPromise<void> : public TaskPromiseBase {
+    public:
+        Task<void> get_return_object() noexcept {
+            using Handle = std::coroutine_handle<TaskPromise>;
+            return Task<void>{Handle::from_promise(*this)};
+        }
+
+        void return_void() const noexcept {}
+
+        void result() const {
+            this->check_result();
+        }
+    };
+
+    /**
+     * Takes the coroutine over from the task being awaited, and destroys it
+     * once the awaiting coroutine has the result
+     */
+    template <typename Type>
+    class TaskAwaiter {
+    public:
+        explicit TaskAwaiter(
+                std::coroutine_handle<TaskPromise<Type>> handle_in) noexcept
+            : handle{handle_in} {}
+        TaskAwaiter(const TaskAwaiter&) = delete;
+        TaskAwaiter& operator=(const TaskAwaiter&) = delete;
+        ~TaskAwaiter() {
+            this->handle.destroy();
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+        std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<> awaiting) noexcept {
+            this->handle.promise().continuation = awaiting;
+            return this->handle;
+        }
+        Type await_resume() {
+            return this->handle.promise().result();
+        }
+
+    private:
+        std::coroutine_handle<TaskPromise<Type>> handle;
+    };
+
+    /**
+     * The coroutine that Task::start() runs a task in, this awaits the task
+     * and moves the result into the promise, and cleans up after itself when
+     * it finishes
+     */
+    class TaskLauncher {
+    public:
+        class promise_type {
+        public:
+            TaskLauncher get_return_object() noexcept {
+                using Handle = std::coroutine_handle<promise_type>;
+                return TaskLauncher{Handle::from_promise(*this)};
+            }
+            std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+            std::suspend_never final_suspend() const noexcept {
+                return {};
+            }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept {
+                std::terminate();
+            }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    template <typename Type, typename Result>
+    TaskLauncher launch_task(Task<Type> task, Promise<Result> promise) {
+        auto result = std::optional<Result>{};
+        try {
+            if constexpr (std::is_void<Type>::value) {
+                co_await std::move(task);
+                result.emplace();
+            } else {
+                result.emplace(co_await std::move(task));
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            co_return;
+        }
+        promise.set_value(std::move(*result));
+    }
+
+} // namespace detail
+
+template <typename Type>
+Task<Type>::Task(Task&& other) noexcept
+    : handle{std::exchange(other.handle, nullptr)} {}
+
+template <typename Type>
+Task<Type>& Task<Type>::operator=(Task&& other) noexcept {
+    auto moved = std::move(other);
+    std::swap(this->handle, moved.handle);
+    return *this;
+}
+
+template <typename Type>
+Task<Type>::~Task() {
+    if (this->handle) {
+        this->handle.destroy();
+    }
+}
+
+template <typename Type>
+bool Task<Type>::valid() const noexcept {
+    return static_cast<bool>(this->handle);
+}
+
+template <typename Type>
+auto Task<Type>::start(Executor* executor)
+        -> Future<std::conditional_t<std::is_void<Type>::value, Unit, Type>> {
+    if (!this->valid()) {
+        throw FutureError{FutureErrorCode::no_state};
+    }
+
+    using Result = std::conditional_t<std::is_void<Type>::value, Unit, Type>;
+    auto promise = Promise<Result>{};
+    auto future = promise.get_future();
+    auto launcher = detail::launch_task(std::move(*this), std::move(promise));
+    executor->add([handle = launcher.handle]() {
+        handle.resume();
+    });
+    return future;
+}
+
+template <typename Type>
+detail::TaskAwaiter<Type> Task<Type>::operator co_await() && {
+    if (!this->valid()) {
+        throw FutureError{FutureErrorCode::no_state};
+    }
+    return detail::TaskAwaiter<Type>{std::exchange(this->handle, nullptr)};
+}
+
+} // namespace sharp
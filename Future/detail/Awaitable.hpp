@@ -0,0 +1,92 @@
+/**
+ * @file Awaitable.hpp
+ * @author Aaryaman Sagar
+ *
+ * The awaiter returned by co_await on a Future or a SharedFuture, this lets a
+ * coroutine wait on a future without blocking the thread it is running on.
+ * Only available when compiling with coroutine support, see
+ * sharp/Portability/cpp20.hpp
+ */
+
+#pragma once
+
+#include <sharp/Portability/cpp20.hpp>
+
+#if SHARP_HAS_COROUTINES
+
+#include <sharp/Executor/Executor.hpp>
+#include <sharp/Future/detail/FutureImplPtr.hpp>
+
+#include <atomic>
+#include <coroutine>
+#include <utility>
+
+namespace sharp {
+namespace detail {
+
+    /**
+     * @class FutureAwaiter
+     *
+     * If the future is ready the coroutine carries on without suspending,
+     * otherwise the coroutine is suspended and resumed through the executor
+     * once the future is fulfilled.  The callback goes into the shared state
+     * the same way a .then() continuation does, so this costs no allocation
+     * past the coroutine frame
+     *
+     * The future can be fulfilled between await_ready() and the callback
+     * being attached, in which case the callback might run before
+     * await_suspend() returns.  Whichever of the two sets resumed second
+     * decides, if that is await_suspend() the coroutine carries on right
+     * away as if the future had been ready to begin with
+     *
+     * Shared is true for shared futures, co_await on those returns a const
+     * reference to the value and leaves it in the shared state
+     */
+    template <typename Type, bool Shared>
+    class FutureAwaiter {
+    public:
+        FutureAwaiter(FutureImplPtr<Type> state_in, Executor* executor_in)
+            : state{std::move(state_in)}, executor{executor_in} {}
+
+        /**
+         * The callback holds a pointer to this, so this cannot be moved once
+         * it has been created
+         */
+        FutureAwaiter(const FutureAwaiter&) = delete;
+        FutureAwaiter(FutureAwaiter&&) = delete;
+        FutureAwaiter& operator=(const FutureAwaiter&) = delete;
+        FutureAwaiter& operator=(FutureAwaiter&&) = delete;
+
+        bool await_ready() const noexcept {
+            return this->state->is_ready();
+        }
+        bool await_suspend(std::coroutine_handle<> handle_in) {
+            this->handle = handle_in;
+            this->state->add_callback([this](auto&) {
+                if (this->resumed.exchange(true)) {
+                    this->executor->add([handle = this->handle]() {
+                        handle.resume();
+                    });
+                }
+            });
+            return !this->resumed.exchange(true);
+        }
+        decltype(auto) await_resume() {
+            if constexpr (Shared) {
+                return this->state->get_copy();
+            } else {
+                return this->state->get();
+            }
+        }
+
+    private:
+        FutureImplPtr<Type> state;
+        Executor* executor;
+        std::coroutine_handle<> handle;
+        std::atomic<bool> resumed{false};
+    };
+
+} // namespace detail
+} // namespace sharp
+
+#endif // SHARP_HAS_COROUTINES
@@ -0,0 +1,138 @@
+/**
+ * @file Callback.hpp
+ * @author Aaryaman Sagar
+ *
+ * The storage for the continuations in a shared state.  Continuations are
+ * only ever run once and destroyed, they are never copied or moved once
+ * stored, so this is a lot simpler than sharp::Function and keeps the
+ * common ones inline without any allocation
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sharp {
+
+namespace detail {
+
+    template <typename Signature>
+    class Callback;
+
+    /**
+     * @class Callback
+     *
+     * Holds a move only function object.  Function objects of up to
+     * inline_size bytes are constructed inline, this covers the
+     * continuations that .then() adds since they capture a handful of
+     * pointers.  Larger ones are allocated on the heap when they are set
+     *
+     * This only covers the continuation while it sits in the shared state.
+     * A continuation that is scheduled on an executor, rather than run
+     * inline or fused into the link before it, is handed to Executor::add()
+     * as a sharp::Function, and that allocates for every function object
+     *
+     * A Callback can neither be copied nor moved, it lives in the shared
+     * state for as long as the continuation does
+     */
+    template <typename... Args>
+    class Callback<void(Args...)> {
+    public:
+        static constexpr std::size_t inline_size = 48;
+
+        Callback() = default;
+        ~Callback() {
+            this->reset();
+        }
+
+        Callback(const Callback&) = delete;
+        Callback& operator=(const Callback&) = delete;
+
+        /**
+         * Store the function object, there must not be one stored already
+         */
+        template <typename Func>
+        void set(Func&& func) {
+            using Functor = std::decay_t<Func>;
+            this->set_impl<Functor>(std::forward<Func>(func),
+                                    Inline<Functor>{});
+        }
+
+        /**
+         * Call the function object, this leaves it stored, reset() destroys
+         * it
+         */
+        void operator()(Args... args) {
+            this->invoke(this->storage, std::forward<Args>(args)...);
+        }
+
+        /**
+         * Destroy the function object, this does nothing if there is none
+         */
+        void reset() noexcept {
+            if (auto destroy = std::exchange(this->destroy, nullptr)) {
+                this->invoke = nullptr;
+                destroy(this->storage);
+            }
+        }
+
+        explicit operator bool() const noexcept {
+            return this->destroy;
+        }
+
+    private:
+        union Storage {
+            void* pointer;
+            std::aligned_storage_t<inline_size,
+                                   alignof(std::max_align_t)> buffer;
+        };
+
+        template <typename Functor>
+        using Inline = std::integral_constant<bool,
+            (sizeof(Functor) <= inline_size)
+            && (alignof(Functor) <= alignof(std::max_align_t))>;
+
+        template <typename Functor, typename Func>
+        void set_impl(Func&& func, std::true_type) {
+            new (&this->storage.buffer) Functor(std::forward<Func>(func));
+            this->invoke = [](Storage& storage, Args&&... args) {
+                (*static_cast<Functor*>(static_cast<void*>(&storage.buffer)))(
+                    std::forward<Args>(args)...);
+            };
+            this->destroy = [](Storage& storage) {
+                static_cast<Functor*>(static_cast<void*>(&storage.buffer))
+                    ->~Functor();
+            };
+        }
+
+        template <typename Functor, typename Func>
+        void set_impl(Func&& func, std::false_type) {
+            this->storage.pointer = new Functor(std::forward<Func>(func));
+            this->invoke = [](Storage& storage, Args&&... args) {
+                (*static_cast<Functor*>(storage.pointer))(
+                    std::forward<Args>(args)...);
+            };
+            this->destroy = [](Storage& storage) {
+                delete static_cast<Functor*>(storage.pointer);
+            };
+        }
+
+        /**
+         * Call the function object and destroy it, both are null when there
+         * is no function object
+         */
+        void (*invoke)(Storage&, Args&&...){nullptr};
+        void (*destroy)(Storage&){nullptr};
+
+        Storage storage;
+    };
+
+    template <typename... Args>
+    constexpr std::size_t Callback<void(Args...)>::inline_size;
+
+} // namespace detail
+
+} // namespace sharp
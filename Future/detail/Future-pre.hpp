@@ -24,6 +24,15 @@ class SharedFuture;
 
 namespace detail {
 
+    /**
+     * Forward declarations of the classes that implement .then(), when_all()
+     * and when_any()
+     */
+    template <typename FutureType>
+    class ComposableFuture;
+    template <typename Futures>
+    class WhenState;
+
     /**
      * Enables the template in whatever way this might be used if the return
      * type of the functor is a future
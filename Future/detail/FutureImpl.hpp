@@ -18,11 +18,12 @@
 #pragma once
 
 #include <sharp/Traits/Traits.hpp>
-#include <sharp/Functional/Functional.hpp>
+#include <sharp/Future/detail/Callback.hpp>
+#include <sharp/Future/detail/InterruptHandler.hpp>
 
 #include <exception>
-#include <condition_variable>
-#include <mutex>
+#include <atomic>
+#include <cstddef>
 #include <initializer_list>
 #include <system_error>
 #include <functional>
@@ -35,11 +36,32 @@ namespace detail {
      * A future impl represents the shared state that a future/promise pair
      * share among them.  This contains all the main code for the futures
      * library
+     *
+     * All the synchronization is done through a single atomic state word,
+     * there is no mutex in here.  The promise and the future each publish
+     * their half (the result and the callback) with one atomic operation on
+     * the state word, and whichever of the two comes second runs the
+     * callback.  Threads that block in wait() sleep on a condition variable
+     * borrowed from a shared table, see ParkingLot.hpp
+     *
+     * The shared state is reference counted intrusively and held through a
+     * FutureImplPtr, the memory for it comes from a per thread pool, see
+     * ThreadLocalPool.hpp.  So a promise and future pair costs one
+     * allocation, and when the shared state is freed on the thread that
+     * made it, not even a trip to the global allocator
      */
     template <typename Type>
     class FutureImpl {
     public:
 
+        /**
+         * The reference count starts out at 1, the reference that is handed
+         * to the first FutureImplPtr
+         */
+        FutureImpl() = default;
+        FutureImpl(const FutureImpl&) = delete;
+        FutureImpl& operator=(const FutureImpl&) = delete;
+
         /**
          * Destructor just asserts that there is no callback registered on the
          * shared state, because if there is a callback then it should already
@@ -50,7 +72,9 @@ namespace detail {
 
         /**
          * The wait function blocks until there is a value or an exception in
-         * the shared state, this uses a condition variable to wait internally
+         * the shared state.  This returns without touching anything but the
+         * state word if the shared state is ready, otherwise it sleeps on the
+         * condition variable in the parking lot bucket for this
          */
         void wait() const;
 
@@ -78,6 +102,9 @@ namespace detail {
 
         /**
          * Set an exception in the shared state that will be rethrown on a get
+         *
+         * Setting a value or an exception more than once throws a
+         * FutureError with the error code promise_already_satisfied
          */
         void set_exception(std::exception_ptr ptr);
 
@@ -100,17 +127,51 @@ namespace detail {
          *
          * The continuation closure will be executed inline and will either be
          * executed immediately if there is a value present in the shared
-         * state or will be packed up and stored in a std::function<> object
-         * to be executed later when the need arises, this way this function
+         * state or will be packed up and stored in a Callback to be executed
+         * later when the need arises, this way this function
          * presents reusable code without causing unnecesary allocation if not
          * needed
          *
+         * Any number of continuations can be added, which is what shared
+         * futures need.  The first one is stored in the shared state itself,
+         * the ones after it are allocated and kept in a list that is guarded
+         * by the parking lot bucket for this, and they run in the order they
+         * were added
+         *
          * The continuation functor must accept a FutureImpl<Type> object by
          * reference
          */
         template <typename Func>
         void add_callback(Func&& func);
 
+        /**
+         * Take back the first continuation added with add_callback() if it
+         * has not been handed off to run yet, this returns true if the
+         * continuation was removed and destroyed and false if it has run or
+         * will run.  This is meant for shared states with a single consumer,
+         * where the first continuation is the one the caller added
+         *
+         * Once this has returned true another continuation can be added
+         */
+        bool remove_callback() noexcept;
+
+        /**
+         * Cooperative cancellation, request_cancellation() marks the shared
+         * state as cancelled and runs the interrupt handler if there is one.
+         * The handler is run once, on the thread that first requests
+         * cancellation, or right away in set_interrupt_handler() if
+         * cancellation has already been requested.  Handlers must not throw
+         *
+         * remove_interrupt_handler() takes the handler back if it has not
+         * been run, it returns true if the handler was removed and destroyed
+         * and false if it has run or is running
+         */
+        void request_cancellation();
+        bool is_cancellation_requested() const noexcept;
+        template <typename Func>
+        void set_interrupt_handler(Func&& func);
+        bool remove_interrupt_handler() noexcept;
+
         /**
          * Returns the current exception_ptr or value assuming there is an
          * exception or value in this
@@ -125,69 +186,97 @@ namespace detail {
         const Type& get_value() const;
 
         /**
-         * Returns true if the shared state contains an exception
-         *
-         * In order to be thread safe, this function first acquires a lock and
-         * then makes the check
+         * Returns true if the shared state contains an exception, this should
+         * only be called once the shared state is ready
          */
         bool contains_exception() const;
 
         /**
-         * Sets the value or exception without locking anything, useful for
-         * when calling from public future functions for example
-         * make_ready_future and make_exceptional_future
+         * Add and drop a reference to the shared state, dropping the last
+         * reference destroys it
          */
-        template <typename... Args>
-        void set_value_no_lock(Args&&... args);
-        template <typename U, typename... Args>
-        void set_value_no_lock(std::initializer_list<U> il, Args&&... args);
-        void set_exception_no_lock(std::exception_ptr ptr);
+        void acquire() noexcept;
+        void release() noexcept;
+
+        /**
+         * Shared states are allocated from the per thread pool
+         */
+        static void* operator new(std::size_t size);
+        static void operator delete(void* pointer) noexcept;
 
     private:
 
         /**
-         * The states the future can have, these should be self explanatory
+         * The bits in the state word
+         *
+         * HAS_CALLBACK and HAS_RESULT are how the future and the promise
+         * publish the callback and the result.  The shared state is done
+         * once both are set, at that point the callback has been handed off
+         * to whoever set the second one.  HAS_EXCEPTION is set along with
+         * HAS_RESULT when the result is an exception
+         *
+         * SATISFIED is set by the first call to set a result, before the
+         * result is constructed, so a second one can throw.  HAS_WAITERS is
+         * set by threads that are about to sleep in wait() so the thread
+         * setting the result knows to wake them, and RETRIEVED is set when a
+         * future is made from the shared state
+         *
+         * CANCELLED and HAS_INTERRUPT_HANDLER work like HAS_RESULT and
+         * HAS_CALLBACK do, whoever sets the second of the two runs the
+         * interrupt handler
+         *
+         * CALLBACK_CLAIMED is set by the thread that gets to store its
+         * continuation in callback, continuations added after that go into
+         * the list of extra callbacks.  HAS_EXTRA_CALLBACKS pairs up with
+         * HAS_RESULT the same way HAS_CALLBACK does
          */
-        enum class FutureState : int {
-            NotFulfilled,
-            ContainsValue,
-            ContainsException,
+        enum : int {
+            HAS_CALLBACK = 1 << 0,
+            HAS_RESULT = 1 << 1,
+            HAS_EXCEPTION = 1 << 2,
+            SATISFIED = 1 << 3,
+            HAS_WAITERS = 1 << 4,
+            RETRIEVED = 1 << 5,
+            CANCELLED = 1 << 6,
+            HAS_INTERRUPT_HANDLER = 1 << 7,
+            CALLBACK_CLAIMED = 1 << 8,
+            HAS_EXTRA_CALLBACKS = 1 << 9,
         };
 
         /**
-         * fixes the internal bookkeeping for the future, including setting
-         * the state variable to the appropriate value and signalling any
-         * waiting threads to wake up
+         * A continuation past the first one, see add_callback()
          */
-        void after_set_value();
-        void after_set_exception();
+        struct ExtraCallback {
+            Callback<void(FutureImpl<Type>&)> callback;
+            ExtraCallback* next{nullptr};
+        };
 
         /**
-         * Checking functions that make sure everything is okay in the future
-         * and if something is wrong they throw the appropriate exception
+         * Add a continuation to the list of extra callbacks, and run the ones
+         * in the list once the result is in
          */
-        void check_get() const;
-        void check_set_value() const;
+        template <typename Func>
+        void add_extra_callback(Func&& func);
+        void run_extra_callbacks();
 
         /**
-         * Executes the callback on this if there is a callback to execute
-         *
-         * The callback is executed inline within the scope of the function
-         * that called execute_callback, i.e. execution is not forwarded to
-         * another thread or something similar
-         *
-         * Locks are assumed to be held before this function is called and the
-         * lock is released right before the callback is executed
+         * Construct the result in the storage with the constructor function,
+         * then publish it with the given bits and run the callback and wake
+         * up waiting threads if there are any
          */
-        void execute_callback(std::unique_lock<std::mutex>& lck);
+        template <typename Constructor>
+        void set_result(Constructor constructor, int result);
 
         /**
-         * Synchronizy locking things
+         * Rethrows the exception if the shared state contains one
          */
-        std::atomic_flag retrieved = ATOMIC_FLAG_INIT;
-        std::atomic<FutureState> state{FutureState::NotFulfilled};
-        mutable std::mutex mtx;
-        mutable std::condition_variable cv;
+        void check_get() const;
+
+        /**
+         * The state word, mutable because waiting threads set HAS_WAITERS
+         */
+        mutable std::atomic<int> state{0};
+        std::atomic<int> references{1};
 
         /**
          * A union containing either an exception_ptr or a value, this should
@@ -197,9 +286,24 @@ namespace detail {
         std::aligned_union_t<0, std::exception_ptr, Type> storage;
 
         /**
-         * A callback functor to be called when the shared state has a value
+         * A callback functor to be called when the shared state has a value,
+         * this is only read by the thread that sets the second of
+         * HAS_CALLBACK and HAS_RESULT
+         */
+        Callback<void(FutureImpl<Type>&)> callback;
+
+        /**
+         * The continuations after the first one, newest first.  This is
+         * guarded by the mutex of the parking lot bucket for this
+         */
+        ExtraCallback* extra_callbacks{nullptr};
+
+        /**
+         * The handler the producer wants to run when cancellation is
+         * requested, this is only read by the thread that sets the second of
+         * HAS_INTERRUPT_HANDLER and CANCELLED
          */
-        sharp::Function<void(FutureImpl<Type>&)> callback;
+        InterruptHandler interrupt_handler;
     };
 
 } // namespace detail
@@ -2,15 +2,17 @@
 
 #include <sharp/Future/FutureError.hpp>
 #include <sharp/Future/detail/FutureImpl.ipp>
+#include <sharp/Future/detail/ParkingLot.hpp>
+#include <sharp/Future/detail/ThreadLocalPool.hpp>
 
 #include <exception>
-#include <condition_variable>
 #include <mutex>
 #include <initializer_list>
 #include <utility>
 #include <cassert>
 #include <memory>
 #include <atomic>
+#include <cstddef>
 
 namespace sharp {
 
@@ -19,81 +21,128 @@ namespace detail {
     template <typename Type>
     FutureImpl<Type>::~FutureImpl() {
         assert(!this->callback);
+        assert(!this->extra_callbacks);
+
+        // destroy whatever was constructed in the storage
+        auto current = this->state.load();
+        if (current & HAS_EXCEPTION) {
+            this->get_exception_ptr().~exception_ptr();
+        } else if (current & HAS_RESULT) {
+            this->get_value().~Type();
+        }
     }
 
     template <typename Type>
-    void FutureImpl<Type>::wait() const {
+    void FutureImpl<Type>::acquire() noexcept {
+        this->references.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        // double checked locking, if the value has been set then just return
-        // because the value has been set; if not then wait on a mutex the
-        // regular way until the value has been set
-        if (this->state.load() != FutureState::NotFulfilled) {
-            return;
+    template <typename Type>
+    void FutureImpl<Type>::release() noexcept {
+        // the last reference has to see everything done through the others
+        // before destroying the shared state
+        if (this->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
         }
+    }
 
-        // if the check above failed then the value has not been set, so sleep
-        // until the value is set
-        auto lck = std::unique_lock<std::mutex>{this->mtx};
-        while (this->state.load() == FutureState::NotFulfilled) {
-            this->cv.wait(lck);
-        }
+    template <typename Type>
+    void* FutureImpl<Type>::operator new(std::size_t size) {
+        assert(size == sizeof(FutureImpl));
+        static_cast<void>(size);
+        return ThreadLocalPool<sizeof(FutureImpl),
+                               alignof(FutureImpl)>::allocate();
     }
 
     template <typename Type>
-    template <typename... Args>
-    void FutureImpl<Type>::set_value_no_lock(Args&&... args) {
-        this->check_set_value();
-        new (&this->get_value()) Type{std::forward<Args>(args)...};
-        this->after_set_value();
+    void FutureImpl<Type>::operator delete(void* pointer) noexcept {
+        ThreadLocalPool<sizeof(FutureImpl),
+                        alignof(FutureImpl)>::deallocate(pointer);
     }
 
     template <typename Type>
-    template <typename U, typename... Args>
-    void FutureImpl<Type>::set_value_no_lock(std::initializer_list<U> il,
-                                             Args&&... args) {
-        this->check_set_value();
-        new (&this->get_value()) Type{il, std::forward<Args>(args)...};
-        this->after_set_value();
+    void FutureImpl<Type>::wait() const {
+
+        // if the value has been set then just return, this is the common case
+        // when the future is read after it has been fulfilled
+        auto current = this->state.load();
+        if (current & HAS_RESULT) {
+            return;
+        }
+
+        // otherwise mark the state as having waiters and go to sleep, the
+        // mark is made in the parking lot with the bucket's mutex held so
+        // that the thread setting the result cannot wake waiters up between
+        // the mark and the sleep
+        while (!(current & HAS_RESULT)) {
+            park(this, [this, &current]() {
+                current = this->state.load();
+                while (!(current & HAS_RESULT)) {
+                    if (this->state.compare_exchange_weak(
+                                current, current | HAS_WAITERS)) {
+                        return true;
+                    }
+                }
+                return false;
+            });
+            current = this->state.load();
+        }
     }
 
     template <typename Type>
-    void FutureImpl<Type>::set_exception_no_lock(std::exception_ptr ptr) {
-        this->check_set_value();
-        new (&this->get_exception_ptr()) std::exception_ptr{ptr};
-        this->after_set_exception();
+    template <typename Constructor>
+    void FutureImpl<Type>::set_result(Constructor constructor, int result) {
+
+        // claim the shared state first, so that a second call to set a result
+        // fails before touching the storage, and give the claim back if
+        // constructing the result fails so the promise can be set again
+        if (this->state.fetch_or(SATISFIED) & SATISFIED) {
+            throw FutureError{FutureErrorCode::promise_already_satisfied};
+        }
+        try {
+            constructor();
+        } catch (...) {
+            this->state.fetch_and(~SATISFIED);
+            throw;
+        }
+
+        // publish the result, if there was a callback already then this was
+        // the second half to come in, so the callback runs here
+        auto previous = this->state.fetch_or(HAS_RESULT | result);
+        if (previous & HAS_WAITERS) {
+            unpark_all(this);
+        }
+        if (previous & HAS_CALLBACK) {
+            this->callback(*this);
+            this->callback.reset();
+        }
+        if (previous & HAS_EXTRA_CALLBACKS) {
+            this->run_extra_callbacks();
+        }
     }
 
     template <typename Type>
     template <typename... Args>
     void FutureImpl<Type>::set_value(Args&&... args) {
-
-        // acquire the lock and then construct the data item in the storage
-        // and execute the callback if there is one set
-        auto lck = std::unique_lock<std::mutex>{this->mtx};
-        this->set_value_no_lock(std::forward<Args>(args)...);
-        this->execute_callback(lck);
+        this->set_result([&]() {
+            new (&this->get_value()) Type{std::forward<Args>(args)...};
+        }, 0);
     }
 
     template <typename Type>
     template <typename U, typename... Args>
     void FutureImpl<Type>::set_value(std::initializer_list<U> il,
                                      Args&&... args) {
-
-        // acquire the lock and then construct the data item in the storage
-        // and execute the callback if there is one set
-        auto lck = std::unique_lock<std::mutex>{this->mtx};
-        this->set_value_no_lock(il, std::forward<Args>(args)...);
-        this->execute_callback(lck);
+        this->set_result([&]() {
+            new (&this->get_value()) Type{il, std::forward<Args>(args)...};
+        }, 0);
     }
 
     template <typename Type>
     void FutureImpl<Type>::set_exception(std::exception_ptr ptr) {
-
-        // acquire the lock and then set the exception and execute the
-        // callback if there is one set
-        auto lck = std::unique_lock<std::mutex>{this->mtx};
-        this->set_exception_no_lock(ptr);
-        this->execute_callback(lck);
+        this->set_result([&]() {
+            new (&this->get_exception_ptr()) std::exception_ptr{ptr};
+        }, HAS_EXCEPTION);
     }
 
     template <typename Type>
@@ -102,11 +151,8 @@ namespace detail {
         // first wait for the result to be ready
         this->wait();
 
-        // grab a lock and then do stuff
-        std::lock_guard<std::mutex> lck(this->mtx);
-
-        // check and throw an exception if the future has already been
-        // fulfilled, and then if not store state and return the moved value
+        // check and throw an exception if the future has been fulfilled with
+        // an exception, and then if not return the moved value
         this->check_get();
         return std::move(this->get_value());
     }
@@ -116,18 +162,15 @@ namespace detail {
         // first wait for the result to be ready
         this->wait();
 
-        // grab a lock
-        std::lock_guard<std::mutex> lck(this->mtx);
-
-        // check and throw an exception if the future has already been
-        // fulfilled, and then if not store state and return the moved value
+        // check and throw an exception if the future has been fulfilled with
+        // an exception, and then if not return a reference to the value
         this->check_get();
         return this->get_value();
     }
 
     template <typename Type>
     void FutureImpl<Type>::test_and_set_retrieved_flag() {
-        if (this->retrieved.test_and_set()) {
+        if (this->state.fetch_or(RETRIEVED) & RETRIEVED) {
             throw FutureError{FutureErrorCode::future_already_retrieved};
         }
     }
@@ -136,73 +179,169 @@ namespace detail {
     template <typename Func>
     void FutureImpl<Type>::add_callback(Func&& func) {
 
-        auto lck = std::unique_lock<std::mutex>{this->mtx};
+        // if the value or exception has already been set then call the
+        // functor now, without packing it up
+        auto current = this->state.load();
+        if (current & HAS_RESULT) {
+            std::forward<Func>(func)(*this);
+            return;
+        }
+
+        // only one thread gets to store its continuation in the shared state
+        // itself, the others go into the list
+        current = this->state.fetch_or(CALLBACK_CLAIMED);
+        if (current & CALLBACK_CLAIMED) {
+            this->add_extra_callback(std::forward<Func>(func));
+            return;
+        }
+        current |= CALLBACK_CLAIMED;
 
-        // this should not be called twice, and will only be called internally
-        // so assert
+        // pack it up into a callback and publish it, if the result comes in
+        // while this is being done then the callback is run here instead
         assert(!this->callback);
+        this->callback.set(std::forward<Func>(func));
+        while (!(current & HAS_RESULT)) {
+            if (this->state.compare_exchange_weak(current,
+                                                  current | HAS_CALLBACK)) {
+                return;
+            }
+        }
+        this->callback(*this);
+        this->callback.reset();
+    }
 
-        // if the value or exception has already been set then call the
-        // functor now
-        if (this->state.load() != FutureState::NotFulfilled) {
-            lck.unlock();
-            std::forward<Func>(func)(*this);
-        } else {
-            // otherwise pack it up into a callback and store the callback
-            this->callback = std::forward<Func>(func);
+    template <typename Type>
+    bool FutureImpl<Type>::remove_callback() noexcept {
+
+        // the callback belongs to whoever sets the second of HAS_CALLBACK and
+        // HAS_RESULT, so it can only be taken back by clearing HAS_CALLBACK
+        // before the result comes in
+        auto current = this->state.load();
+        auto cleared = ~(HAS_CALLBACK | CALLBACK_CLAIMED);
+        while ((current & HAS_CALLBACK) && !(current & HAS_RESULT)) {
+            if (this->state.compare_exchange_weak(current,
+                                                  current & cleared)) {
+                this->callback.reset();
+                return true;
+            }
         }
+        return false;
     }
 
     template <typename Type>
-    void FutureImpl<Type>::check_get() const {
-        if (this->state.load() == FutureState::ContainsException) {
-            std::rethrow_exception(this->get_exception_ptr());
+    template <typename Func>
+    void FutureImpl<Type>::add_extra_callback(Func&& func) {
+        auto extra = new ExtraCallback{};
+        extra->callback.set(std::forward<Func>(func));
+
+        // the list is only read by the thread that sets the second of
+        // HAS_EXTRA_CALLBACKS and HAS_RESULT, so link the callback in and
+        // publish it with the bucket's mutex held, that way the thread
+        // setting the result sees the whole list once it has the mutex
+        {
+            auto& bucket = parking_bucket(this);
+            auto lck = std::unique_lock<std::mutex>{bucket.mtx};
+            auto current = this->state.load();
+            while (!(current & HAS_RESULT)) {
+                if (this->state.compare_exchange_weak(
+                            current, current | HAS_EXTRA_CALLBACKS)) {
+                    extra->next = this->extra_callbacks;
+                    this->extra_callbacks = extra;
+                    return;
+                }
+            }
         }
+
+        // the result came in first, so this runs the callback
+        extra->callback(*this);
+        delete extra;
     }
 
     template <typename Type>
-    void FutureImpl<Type>::check_set_value() const {
-        auto state = this->state.load();
-        if (state == FutureState::ContainsException
-                || state == FutureState::ContainsValue) {
-            throw FutureError{FutureErrorCode::promise_already_satisfied};
+    void FutureImpl<Type>::run_extra_callbacks() {
+        auto extras = static_cast<ExtraCallback*>(nullptr);
+        {
+            auto& bucket = parking_bucket(this);
+            auto lck = std::unique_lock<std::mutex>{bucket.mtx};
+            extras = std::exchange(this->extra_callbacks, nullptr);
+        }
+
+        // the list is newest first, so reverse it to run the callbacks in
+        // the order they were added
+        auto ordered = static_cast<ExtraCallback*>(nullptr);
+        while (extras) {
+            auto next = extras->next;
+            extras->next = ordered;
+            ordered = extras;
+            extras = next;
+        }
+        while (ordered) {
+            auto next = ordered->next;
+            ordered->callback(*this);
+            delete ordered;
+            ordered = next;
         }
     }
 
     template <typename Type>
-    void FutureImpl<Type>::after_set_value() {
-        this->state.store(FutureState::ContainsValue);
-        this->cv.notify_one();
+    void FutureImpl<Type>::request_cancellation() {
+        auto previous = this->state.fetch_or(CANCELLED);
+        if ((previous & HAS_INTERRUPT_HANDLER) && !(previous & CANCELLED)) {
+            this->interrupt_handler.run();
+        }
     }
 
     template <typename Type>
-    void FutureImpl<Type>::after_set_exception() {
-        this->state.store(FutureState::ContainsException);
-        this->cv.notify_one();
+    bool FutureImpl<Type>::is_cancellation_requested() const noexcept {
+        return this->state.load() & CANCELLED;
     }
 
     template <typename Type>
-    void FutureImpl<Type>::execute_callback(std::unique_lock<std::mutex>& lck) {
-        assert(lck.owns_lock());
-        if (!this->callback) {
-            return;
+    template <typename Func>
+    void FutureImpl<Type>::set_interrupt_handler(Func&& func) {
+        assert(!(this->state.load() & HAS_INTERRUPT_HANDLER));
+
+        // publish the handler the same way add_callback() publishes the
+        // callback, if cancellation comes in first the handler runs here
+        this->interrupt_handler.set(std::forward<Func>(func));
+        auto current = this->state.load();
+        while (!(current & CANCELLED)) {
+            if (this->state.compare_exchange_weak(
+                        current, current | HAS_INTERRUPT_HANDLER)) {
+                return;
+            }
         }
-        lck.unlock();
+        this->interrupt_handler.run();
+    }
 
-        // execute the callback and then hard reset the function object
-        this->callback(*this);
-        this->callback = std::decay_t<decltype(this->callback)>{};
+    template <typename Type>
+    bool FutureImpl<Type>::remove_interrupt_handler() noexcept {
+        auto current = this->state.load();
+        while ((current & HAS_INTERRUPT_HANDLER) && !(current & CANCELLED)) {
+            if (this->state.compare_exchange_weak(
+                        current, current & ~HAS_INTERRUPT_HANDLER)) {
+                this->interrupt_handler.reset();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Type>
+    void FutureImpl<Type>::check_get() const {
+        if (this->state.load() & HAS_EXCEPTION) {
+            std::rethrow_exception(this->get_exception_ptr());
+        }
     }
 
     template <typename Type>
     bool FutureImpl<Type>::is_ready() const noexcept {
-        return (this->state.load() != FutureState::NotFulfilled);
+        return this->state.load() & HAS_RESULT;
     }
 
     template <typename Type>
     bool FutureImpl<Type>::contains_exception() const {
-        std::lock_guard<std::mutex> lck{this->mtx};
-        return (this->state.load() == FutureState::ContainsException);
+        return this->state.load() & HAS_EXCEPTION;
     }
 
     template <typename Type>
@@ -0,0 +1,97 @@
+/**
+ * @file FutureImplPtr.hpp
+ * @author Aaryaman Sagar
+ *
+ * The pointer through which promises and futures share a FutureImpl.  The
+ * reference count lives in the FutureImpl itself, so the shared state is a
+ * single allocation and there is no separate control block
+ */
+
+#pragma once
+
+#include <utility>
+
+namespace sharp {
+
+namespace detail {
+
+    template <typename Type>
+    class FutureImpl;
+
+    /**
+     * @class FutureImplPtr
+     *
+     * An intrusive reference counted pointer, with the subset of the
+     * std::shared_ptr interface that the futures code uses.  The count is
+     * maintained with FutureImpl::acquire() and FutureImpl::release(), the
+     * latter destroys the shared state when the last reference goes away
+     *
+     * Moves do not touch the reference count, copies increment it
+     */
+    template <typename Type>
+    class FutureImplPtr {
+    public:
+        using Impl = FutureImpl<Type>;
+
+        FutureImplPtr() noexcept = default;
+
+        /**
+         * Take over the reference held by the caller, new objects start out
+         * with a reference count of 1 so this is the way to construct a
+         * pointer to one
+         */
+        explicit FutureImplPtr(Impl* impl_in) noexcept : impl{impl_in} {}
+
+        FutureImplPtr(const FutureImplPtr& other) noexcept
+                : impl{other.impl} {
+            if (this->impl) {
+                this->impl->acquire();
+            }
+        }
+        FutureImplPtr(FutureImplPtr&& other) noexcept
+            : impl{std::exchange(other.impl, nullptr)} {}
+
+        FutureImplPtr& operator=(const FutureImplPtr& other) noexcept {
+            auto copy = other;
+            std::swap(this->impl, copy.impl);
+            return *this;
+        }
+        FutureImplPtr& operator=(FutureImplPtr&& other) noexcept {
+            auto moved = std::move(other);
+            std::swap(this->impl, moved.impl);
+            return *this;
+        }
+
+        ~FutureImplPtr() {
+            this->reset();
+        }
+
+        /**
+         * Drop the reference this holds, if any
+         */
+        void reset() noexcept {
+            if (this->impl) {
+                std::exchange(this->impl, nullptr)->release();
+            }
+        }
+
+        Impl* get() const noexcept {
+            return this->impl;
+        }
+        Impl* operator->() const noexcept {
+            return this->impl;
+        }
+        Impl& operator*() const noexcept {
+            return *this->impl;
+        }
+        explicit operator bool() const noexcept {
+            return this->impl;
+        }
+
+    private:
+        Impl* impl{nullptr};
+    };
+
+} // namespace detail
+
+} // namespace sharp
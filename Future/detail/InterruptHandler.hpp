@@ -0,0 +1,111 @@
+/**
+ * @file InterruptHandler.hpp
+ * @author Aaryaman Sagar
+ *
+ * The storage for the interrupt handler in a shared state.  Every shared
+ * state has room for one but few ever get one, so this is kept to two
+ * pointers instead of a whole sharp::Function
+ */
+
+#pragma once
+
+#include <sharp/Defer/Defer.hpp>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * @class InterruptHandler
+     *
+     * Holds a handler that is either run once or thrown away.  Handlers of
+     * up to a pointer in size are stored inline, this covers the ones the
+     * futures code installs since they capture a single pointer to a shared
+     * state.  Larger ones are allocated on the heap when they are set
+     */
+    class InterruptHandler {
+    public:
+        InterruptHandler() = default;
+        ~InterruptHandler() {
+            this->reset();
+        }
+
+        InterruptHandler(const InterruptHandler&) = delete;
+        InterruptHandler& operator=(const InterruptHandler&) = delete;
+
+        /**
+         * Store the handler, there must not be one stored already
+         */
+        template <typename Func>
+        void set(Func&& func) {
+            using Handler = std::decay_t<Func>;
+            this->set_impl<Handler>(std::forward<Func>(func),
+                                    Inline<Handler>{});
+        }
+
+        /**
+         * Run the handler and destroy it, or just destroy it.  Both do
+         * nothing if there is no handler
+         */
+        void run() {
+            if (auto manager = std::exchange(this->manager, nullptr)) {
+                manager(*this, true);
+            }
+        }
+        void reset() noexcept {
+            if (auto manager = std::exchange(this->manager, nullptr)) {
+                manager(*this, false);
+            }
+        }
+
+    private:
+        template <typename Handler>
+        using Inline = std::integral_constant<bool,
+            (sizeof(Handler) <= sizeof(void*))
+            && (alignof(Handler) <= alignof(void*))>;
+
+        template <typename Handler, typename Func>
+        void set_impl(Func&& func, std::true_type) {
+            new (&this->storage) Handler(std::forward<Func>(func));
+            this->manager = [](InterruptHandler& self, bool run) {
+                auto& handler = *static_cast<Handler*>(
+                    static_cast<void*>(&self.storage));
+                auto deferred = sharp::defer([&]() { handler.~Handler(); });
+                if (run) {
+                    handler();
+                }
+            };
+        }
+
+        template <typename Handler, typename Func>
+        void set_impl(Func&& func, std::false_type) {
+            this->storage.pointer = new Handler(std::forward<Func>(func));
+            this->manager = [](InterruptHandler& self, bool run) {
+                auto handler = static_cast<Handler*>(self.storage.pointer);
+                auto deferred = sharp::defer([&]() { delete handler; });
+                if (run) {
+                    (*handler)();
+                }
+            };
+        }
+
+        /**
+         * Runs the handler if asked to and then destroys it, null when there
+         * is no handler
+         */
+        void (*manager)(InterruptHandler&, bool){nullptr};
+
+        union Storage {
+            void* pointer;
+            std::aligned_storage_t<sizeof(void*), alignof(void*)> buffer;
+        } storage;
+    };
+
+} // namespace detail
+
+} // namespace sharp
@@ -0,0 +1,147 @@
+/**
+ * @file ParkingLot.hpp
+ * @author Aaryaman Sagar
+ *
+ * A process wide table that threads can sleep in, keyed by the address of
+ * whatever they are waiting for.  This lets objects like the shared state of
+ * a future get by with just an atomic integer instead of carrying a mutex
+ * and a condition variable of their own, they only borrow a spot in here when
+ * a thread actually has to block
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * A thread sleeping in the parking lot, these live on the stack of the
+     * sleeping thread and are linked into the bucket for the address it is
+     * waiting on.  Each one has a condition variable of its own so waking a
+     * thread up does not wake up the other threads in the bucket, and woken
+     * threads do not have to go through the bucket's mutex on the way out
+     */
+    struct ParkingNode {
+        const void* address{nullptr};
+        ParkingNode* next{nullptr};
+        ParkingNode* previous{nullptr};
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool signaled{false};
+    };
+
+    /**
+     * A mutex and the list of the threads sleeping on addresses that hash
+     * here, on a cache line of their own so threads sleeping on different
+     * buckets do not contend
+     */
+    struct alignas(64) ParkingBucket {
+        std::mutex mtx;
+        ParkingNode* head{nullptr};
+        ParkingNode* tail{nullptr};
+    };
+
+    /**
+     * Returns the bucket for the given address, different addresses can hash
+     * to the same bucket
+     */
+    inline ParkingBucket& parking_bucket(const void* address) {
+        constexpr auto number_buckets = std::size_t{64};
+        static ParkingBucket buckets[number_buckets];
+
+        // the low bits of an address are mostly the same because of
+        // alignment, so shift them out before picking a bucket
+        auto key = reinterpret_cast<std::uintptr_t>(address);
+        key ^= key >> 6;
+        key ^= key >> 12;
+        return buckets[key % number_buckets];
+    }
+
+    /**
+     * Put the calling thread to sleep on the address till unpark_all() is
+     * called for it.  should_sleep is called with the bucket's mutex held,
+     * and the thread only goes to sleep if it returns true.  So if whatever
+     * wakes threads up calls unpark_all() after changing what should_sleep
+     * checks, a thread can not go to sleep after missing the wake up
+     *
+     * Returns false if the thread did not go to sleep
+     */
+    template <typename ShouldSleep>
+    bool park(const void* address, ShouldSleep should_sleep) {
+        ParkingNode node;
+        node.address = address;
+
+        auto& bucket = parking_bucket(address);
+        {
+            auto lck = std::unique_lock<std::mutex>{bucket.mtx};
+            if (!should_sleep()) {
+                return false;
+            }
+            node.previous = bucket.tail;
+            if (bucket.tail) {
+                bucket.tail->next = &node;
+            } else {
+                bucket.head = &node;
+            }
+            bucket.tail = &node;
+        }
+
+        auto lck = std::unique_lock<std::mutex>{node.mtx};
+        while (!node.signaled) {
+            node.cv.wait(lck);
+        }
+        return true;
+    }
+
+    /**
+     * Wake up every thread sleeping on the address, the threads are taken
+     * out of the bucket first and then woken up one by one outside the
+     * bucket's mutex
+     */
+    inline void unpark_all(const void* address) {
+        auto& bucket = parking_bucket(address);
+        auto woken = static_cast<ParkingNode*>(nullptr);
+        {
+            auto lck = std::unique_lock<std::mutex>{bucket.mtx};
+            auto node = bucket.head;
+            while (node) {
+                auto next = node->next;
+                if (node->address == address) {
+                    if (node->previous) {
+                        node->previous->next = node->next;
+                    } else {
+                        bucket.head = node->next;
+                    }
+                    if (node->next) {
+                        node->next->previous = node->previous;
+                    } else {
+                        bucket.tail = node->previous;
+                    }
+                    node->next = woken;
+                    woken = node;
+                }
+                node = next;
+            }
+        }
+
+        // a node belongs to the thread sleeping on it again as soon as it
+        // sees signaled, so it is signaled and notified with its mutex held
+        // and not touched after that
+        while (woken) {
+            auto node = woken;
+            woken = woken->next;
+            auto lck = std::unique_lock<std::mutex>{node->mtx};
+            node->signaled = true;
+            node->cv.notify_one();
+        }
+    }
+
+} // namespace detail
+
+} // namespace sharp
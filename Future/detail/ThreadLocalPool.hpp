@@ -0,0 +1,157 @@
+/**
+ * @file ThreadLocalPool.hpp
+ * @author Aaryaman Sagar
+ *
+ * A per thread cache of fixed size blocks of memory.  The shared state of a
+ * future is allocated from here so that creating and destroying promise and
+ * future pairs at a high rate mostly stays out of the global allocator
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace sharp {
+
+namespace detail {
+
+    /**
+     * @class ThreadLocalPool
+     *
+     * Every thread keeps a free list of blocks of Size bytes aligned to
+     * Align, allocations are taken from the free list of the calling thread
+     * and blocks are given back to the free list of the thread that frees
+     * them, which need not be the one that allocated them.  The blocks all
+     * come from ::operator new, so a block moving from one thread's list to
+     * another's is fine
+     *
+     * Each free list holds at most max_blocks blocks, anything over that is
+     * given back to ::operator delete.  So a thread that only ever frees
+     * (for example a thread that only reads from futures) does not end up
+     * hoarding memory, and the list of a thread is freed when the thread
+     * exits
+     *
+     * Blocks are not sent back to the thread that allocated them.  So the
+     * pool only saves trips to the global allocator when blocks are mostly
+     * freed on the threads that allocate them.  When one thread allocates
+     * and another frees, as with a promise made on a worker and its future
+     * read on the caller, the freeing thread's list fills up to max_blocks
+     * and then spills, and the allocating thread's list stays empty, so
+     * each of those allocations goes to ::operator new
+     */
+    template <std::size_t Size, std::size_t Align = alignof(std::max_align_t)>
+    class ThreadLocalPool {
+    public:
+        static void* allocate() {
+            if (destroyed()) {
+                return new_block();
+            }
+            auto& list = free_list();
+            if (!list.head) {
+                return new_block();
+            }
+            auto block = list.head;
+            list.head = block->next;
+            --list.size;
+            return block;
+        }
+
+        static void deallocate(void* pointer) noexcept {
+            if (destroyed()) {
+                delete_block(pointer);
+                return;
+            }
+            auto& list = free_list();
+            if (list.size >= max_blocks) {
+                delete_block(pointer);
+                return;
+            }
+            auto block = static_cast<Block*>(pointer);
+            block->next = list.head;
+            list.head = block;
+            ++list.size;
+        }
+
+    private:
+        static constexpr std::size_t max_blocks = 128;
+
+        /**
+         * Free blocks are linked through their first bytes
+         */
+        struct Block {
+            Block* next;
+        };
+        static_assert(Size >= sizeof(Block), "blocks too small to link");
+        static_assert(Align && !(Align & (Align - 1)),
+                      "alignment must be a power of two");
+
+        /**
+         * ::operator new only guarantees the alignment of std::max_align_t,
+         * so blocks that need more are carved out of a larger allocation,
+         * with a pointer to that allocation kept right before the block
+         */
+        static constexpr bool over_aligned = Align > alignof(std::max_align_t);
+        static void* new_block() {
+            if (!over_aligned) {
+                return ::operator new(Size);
+            }
+            auto raw = ::operator new(Size + Align);
+            auto address = (reinterpret_cast<std::uintptr_t>(raw) + Align)
+                & ~(Align - 1);
+            auto block = reinterpret_cast<void*>(address);
+            static_cast<void**>(block)[-1] = raw;
+            return block;
+        }
+        static void delete_block(void* block) noexcept {
+            if (!over_aligned) {
+                ::operator delete(block);
+                return;
+            }
+            ::operator delete(static_cast<void**>(block)[-1]);
+        }
+
+        /**
+         * The free blocks of a thread, they are given back to ::operator
+         * delete when the thread exits
+         */
+        struct FreeList {
+            ~FreeList() {
+                destroyed() = true;
+                while (this->head) {
+                    auto block = this->head;
+                    this->head = block->next;
+                    delete_block(block);
+                }
+            }
+
+            Block* head{nullptr};
+            std::size_t size{0};
+        };
+
+        static FreeList& free_list() {
+            static thread_local FreeList list;
+            return list;
+        }
+
+        /**
+         * Set once a thread's list has been destroyed, so blocks freed by
+         * thread local destructors that run after it go straight back to
+         * ::operator delete.  This has no destructor of its own, so it can
+         * still be read then
+         */
+        static bool& destroyed() noexcept {
+            static thread_local bool flag{false};
+            return flag;
+        }
+    };
+
+    template <std::size_t Size, std::size_t Align>
+    constexpr std::size_t ThreadLocalPool<Size, Align>::max_blocks;
+    template <std::size_t Size, std::size_t Align>
+    constexpr bool ThreadLocalPool<Size, Align>::over_aligned;
+
+} // namespace detail
+
+} // namespace sharp
@@ -0,0 +1,63 @@
+/**
+ * @file allocations.cpp
+ * @author Aaryaman Sagar
+ *
+ * Tests that count the allocations futures make.  These replace the global
+ * operator new, so they are kept out of the main test binary
+ */
+
+#include <sharp/Future/Future.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    /**
+     * The number of allocations made on this thread, counted by the
+     * replacement of operator new below
+     */
+    thread_local std::size_t allocations = 0;
+
+} // namespace <anonymous>
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (auto pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc{};
+}
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+TEST(Allocations, FusedThenChainDoesNotAllocate) {
+    // the first continuation in a chain is handed to the executor, every one
+    // after it is fused into the one before it, so the rest of the chain
+    // only goes through the shared states and the continuations stored in
+    // them
+    auto chain = [](int links) {
+        auto promise = sharp::Promise<int>{};
+        auto future = promise.get_future();
+        for (auto i = 0; i < links; ++i) {
+            future = future.then([](auto f) { return f.get() + 1; });
+        }
+
+        auto before = allocations;
+        promise.set_value(0);
+        EXPECT_EQ(future.get(), links);
+        return allocations - before;
+    };
+
+    // the first chain fills this thread's pool of shared states, after that
+    // a long chain allocates no more than a single continuation does
+    chain(50);
+    EXPECT_EQ(chain(50), chain(1));
+}
@@ -0,0 +1,280 @@
+/**
+ * @file benchmark.cpp
+ * @author Aaryaman Sagar
+ *
+ * Benchmarks for creating, completing and sharing futures, run with
+ *
+ *      buck run //Future/test:benchmark -- --iterations=1000000
+ *
+ * Every benchmark is run with the shared state held the way promises and
+ * futures hold it (an intrusively counted FutureImpl from the per thread
+ * pool) and with the same FutureImpl held in a std::shared_ptr from
+ * std::make_shared, the way it used to be held.  The std::promise and
+ * std::future pair is measured as well for reference.  The fan_out
+ * benchmarks join one future per iteration with when_all() and when_any().
+ * The results are printed to stdout as one JSON object so that runs on
+ * different commits can be compared by a script
+ *
+ * A benchmark can be picked out with --filter=<substring>, which is matched
+ * against its name, for example
+ *
+ *      buck run //Future/test:benchmark -- --filter=create/
+ */
+
+#include <sharp/Future/Future.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/**
+ * The options read from the command line
+ */
+struct Options {
+    int iterations{1000000};
+    std::string filter;
+};
+
+/**
+ * The results of one benchmark
+ */
+struct Result {
+    std::string name;
+    int iterations;
+    double seconds;
+};
+
+using SharedImpl = std::shared_ptr<sharp::detail::FutureImpl<int>>;
+using IntrusiveImpl = sharp::detail::FutureImplPtr<int>;
+
+/**
+ * Create a pair, fulfill it and read the value, all on one thread.  The
+ * intrusive and shared_ptr benchmarks work on the shared state directly so
+ * that they differ only in how it is held, the promise benchmark goes
+ * through the public interface
+ */
+void create_intrusive(int iterations) {
+    for (auto i = 0; i < iterations; ++i) {
+        auto promise = IntrusiveImpl{new sharp::detail::FutureImpl<int>{}};
+        auto future = promise;
+        promise->set_value(i);
+        future->get();
+    }
+}
+void create_promise(int iterations) {
+    for (auto i = 0; i < iterations; ++i) {
+        auto promise = sharp::Promise<int>{};
+        auto future = promise.get_future();
+        promise.set_value(i);
+        future.get();
+    }
+}
+void create_shared_ptr(int iterations) {
+    for (auto i = 0; i < iterations; ++i) {
+        auto promise = std::make_shared<sharp::detail::FutureImpl<int>>();
+        auto future = promise;
+        promise->set_value(i);
+        future->get();
+    }
+}
+void create_std(int iterations) {
+    for (auto i = 0; i < iterations; ++i) {
+        auto promise = std::promise<int>{};
+        auto future = promise.get_future();
+        promise.set_value(i);
+        future.get();
+    }
+}
+
+/**
+ * Create pairs on one thread and fulfill, read and destroy them on another,
+ * so the memory for the shared state is freed on a different thread from
+ * the one it was allocated on
+ */
+template <typename Promise, typename Make, typename Complete>
+void cross_thread(int iterations, Make make, Complete complete) {
+    auto promises = std::vector<Promise>{};
+    promises.reserve(iterations);
+    for (auto i = 0; i < iterations; ++i) {
+        promises.push_back(make());
+    }
+    std::thread{[&]() {
+        for (auto i = 0; i < iterations; ++i) {
+            complete(promises[i], i);
+        }
+        promises.clear();
+    }}.join();
+}
+void cross_thread_intrusive(int iterations) {
+    cross_thread<IntrusiveImpl>(
+        iterations,
+        []() { return IntrusiveImpl{new sharp::detail::FutureImpl<int>{}}; },
+        [](auto& promise, int i) {
+            auto future = promise;
+            promise->set_value(i);
+            future->get();
+        });
+}
+void cross_thread_shared_ptr(int iterations) {
+    cross_thread<SharedImpl>(
+        iterations,
+        []() { return std::make_shared<sharp::detail::FutureImpl<int>>(); },
+        [](auto& promise, int i) {
+            auto future = promise;
+            promise->set_value(i);
+            future->get();
+        });
+}
+
+/**
+ * Copy a handle to a ready shared state and read through the copy, this is
+ * the reference count traffic of passing a SharedFuture around
+ */
+void copy_intrusive(int iterations) {
+    auto shared = IntrusiveImpl{new sharp::detail::FutureImpl<int>{}};
+    shared->set_value(1);
+    auto sum = 0;
+    for (auto i = 0; i < iterations; ++i) {
+        auto copy = shared;
+        sum += copy->get_copy();
+    }
+    static_cast<void>(sum);
+}
+void copy_shared_ptr(int iterations) {
+    auto shared = std::make_shared<sharp::detail::FutureImpl<int>>();
+    shared->set_value(1);
+    auto sum = 0;
+    for (auto i = 0; i < iterations; ++i) {
+        auto copy = shared;
+        sum += copy->get_copy();
+    }
+    static_cast<void>(sum);
+}
+void copy_std(int iterations) {
+    auto promise = std::promise<int>{};
+    auto shared = promise.get_future().share();
+    promise.set_value(1);
+    auto sum = 0;
+    for (auto i = 0; i < iterations; ++i) {
+        auto copy = shared;
+        sum += copy.get();
+    }
+    static_cast<void>(sum);
+}
+
+/**
+ * Join a fan out of iterations futures with when_all() and when_any(), the
+ * futures are fulfilled after the join has been set up
+ */
+template <typename Join>
+void fan_out(int iterations, Join join) {
+    auto promises = std::vector<sharp::Promise<int>>(iterations);
+    auto futures = std::vector<sharp::Future<int>>{};
+    futures.reserve(iterations);
+    for (auto& promise : promises) {
+        futures.push_back(promise.get_future());
+    }
+    auto joined = join(futures.begin(), futures.end());
+    for (auto i = 0; i < iterations; ++i) {
+        promises[i].set_value(i);
+    }
+    joined.get();
+}
+void fan_out_when_all(int iterations) {
+    fan_out(iterations, [](auto first, auto last) {
+        return sharp::when_all(first, last);
+    });
+}
+void fan_out_when_any(int iterations) {
+    fan_out(iterations, [](auto first, auto last) {
+        return sharp::when_any(first, last);
+    });
+}
+
+class Benchmarks {
+public:
+    explicit Benchmarks(Options options_in) : options{options_in} {}
+
+    void run(const std::string& name, std::function<void(int)> benchmark) {
+        if (name.find(this->options.filter) == std::string::npos) {
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        benchmark(this->options.iterations);
+        auto end = std::chrono::steady_clock::now();
+        auto seconds = std::chrono::duration<double>(end - start).count();
+        this->results.push_back({name, this->options.iterations, seconds});
+    }
+
+    void print() const {
+        std::cout << "{\n  \"benchmarks\": [";
+        auto first = true;
+        for (auto& result : this->results) {
+            std::cout << (first ? "\n" : ",\n");
+            first = false;
+            std::cout << "    {"
+                << "\"name\": \"" << result.name << "\", "
+                << "\"iterations\": " << result.iterations << ", "
+                << "\"seconds\": " << std::fixed << std::setprecision(6)
+                    << result.seconds << ", "
+                << "\"iterations_per_second\": " << std::setprecision(1)
+                    << result.iterations / result.seconds
+                << "}";
+        }
+        std::cout << "\n  ]\n}" << std::endl;
+    }
+
+private:
+    Options options;
+    std::vector<Result> results;
+};
+
+Options parse_options(int argc, char** argv) {
+    auto options = Options{};
+    for (auto i = 1; i < argc; ++i) {
+        auto argument = std::string{argv[i]};
+        auto iterations = std::string{"--iterations="};
+        auto filter = std::string{"--filter="};
+        if (argument.compare(0, iterations.size(), iterations) == 0) {
+            options.iterations
+                = std::atoi(argument.c_str() + iterations.size());
+        } else if (argument.compare(0, filter.size(), filter) == 0) {
+            options.filter = argument.substr(filter.size());
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--iterations=<count>] [--filter=<substring>]"
+                      << std::endl;
+            std::exit(1);
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    auto benchmarks = Benchmarks{parse_options(argc, argv)};
+    benchmarks.run("create/intrusive", create_intrusive);
+    benchmarks.run("create/shared_ptr", create_shared_ptr);
+    benchmarks.run("create/promise", create_promise);
+    benchmarks.run("create/std", create_std);
+    benchmarks.run("cross_thread/intrusive", cross_thread_intrusive);
+    benchmarks.run("cross_thread/shared_ptr", cross_thread_shared_ptr);
+    benchmarks.run("copy/intrusive", copy_intrusive);
+    benchmarks.run("copy/shared_ptr", copy_shared_ptr);
+    benchmarks.run("copy/std", copy_std);
+    benchmarks.run("fan_out/when_all", fan_out_when_all);
+    benchmarks.run("fan_out/when_any", fan_out_when_any);
+    benchmarks.print();
+}
@@ -1,5 +1,7 @@
 #include <sharp/Future/Future.hpp>
+#include <sharp/Future/Task.hpp>
 #include <sharp/Threads/Threads.hpp>
+#include <sharp/Executor/InlineExecutor.hpp>
 
 #include <gtest/gtest.h>
 
@@ -8,6 +10,10 @@
 #include <utility>
 #include <iostream>
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
 
 TEST(Future, Basic) {
     auto promise = sharp::Promise<int>{};
@@ -528,6 +534,99 @@ TEST(Future, WhenAnyBasic) {
     }
 }
 
+TEST(Future, WhenAllLargeFanOut) {
+    const auto LIMIT = 10000;
+    auto promises = std::vector<sharp::Promise<int>>(LIMIT);
+    auto futures = std::vector<sharp::Future<int>>{};
+    for (auto& promise : promises) {
+        futures.push_back(promise.get_future());
+    }
+
+    // half the futures are ready before when_all is called and the other
+    // half are fulfilled from another thread while it runs
+    for (auto i = 0; i < LIMIT / 2; ++i) {
+        promises[i].set_value(i);
+    }
+    auto thread = std::thread{[&]() {
+        for (auto i = LIMIT / 2; i < LIMIT; ++i) {
+            promises[i].set_value(i);
+        }
+    }};
+    auto future = sharp::when_all(futures.begin(), futures.end());
+    thread.join();
+
+    auto results = future.get();
+    EXPECT_EQ(results.size(), LIMIT);
+    for (auto i = 0; i < LIMIT; ++i) {
+        EXPECT_EQ(results[i].get(), i);
+    }
+}
+
+TEST(Future, WhenAnyDetachesLosers) {
+    auto promises = std::vector<sharp::Promise<int>>(100);
+    auto futures = std::vector<sharp::Future<int>>{};
+    for (auto& promise : promises) {
+        futures.push_back(promise.get_future());
+    }
+    auto future = sharp::when_any(futures.begin(), futures.end());
+    promises[42].set_value(42);
+
+    // the losers are handed back without when_any's callbacks on them, so
+    // they can be given continuations of their own
+    auto results = future.get();
+    EXPECT_EQ(results[42].get(), 42);
+    auto sum = 0;
+    auto thenned = std::vector<sharp::Future<int>>{};
+    for (auto i = 0; i < 100; ++i) {
+        if (i != 42) {
+            thenned.push_back(results[i].then([&sum](auto f) {
+                sum += f.get();
+                return 0;
+            }));
+        }
+    }
+    for (auto i = 0; i < 100; ++i) {
+        if (i != 42) {
+            promises[i].set_value(i);
+        }
+    }
+    EXPECT_EQ(sum, 99 * 100 / 2 - 42);
+}
+
+TEST(Future, WhenAnyRacingPromises) {
+    for (auto i = 0; i < 100; ++i) {
+        auto promises = std::vector<sharp::Promise<int>>(4);
+        auto futures = std::vector<sharp::Future<int>>{};
+        for (auto& promise : promises) {
+            futures.push_back(promise.get_future());
+        }
+
+        auto threads = std::vector<std::thread>{};
+        for (auto j = 0; j < 4; ++j) {
+            threads.emplace_back([&promises, j]() {
+                promises[j].set_value(j);
+            });
+        }
+        auto future = sharp::when_any(futures.begin(), futures.end());
+        auto results = future.get();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (auto j = 0; j < 4; ++j) {
+            EXPECT_EQ(results[j].get(), j);
+        }
+    }
+}
+
+TEST(Future, WhenAllInvalidInput) {
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future();
+    auto invalid = sharp::Future<int>{};
+    EXPECT_THROW(sharp::when_all(future, invalid), sharp::FutureError);
+    EXPECT_TRUE(future.valid());
+}
+
 TEST(Future, SharedFutureBasic) {
     auto promise = sharp::Promise<int>{};
     auto future = promise.get_future().share();
@@ -582,6 +681,109 @@ TEST(Future, SharedFutureWhenAll) {
     }
 }
 
+TEST(Future, SharedFutureWakesAllWaiters) {
+    // many threads blocked on one shared state, along with threads blocked
+    // on other shared states that share buckets in the parking lot with it
+    for (auto i = 0; i < 10; ++i) {
+        auto promise = sharp::Promise<int>{};
+        auto shared = promise.get_future().share();
+        auto others = std::vector<sharp::Promise<int>>(8);
+        std::atomic<int> woken{0};
+        auto threads = std::vector<std::thread>{};
+        for (auto& other : others) {
+            threads.emplace_back([future = other.get_future().share()]() {
+                EXPECT_EQ(future.get(), 2);
+            });
+        }
+        for (auto j = 0; j < 100; ++j) {
+            threads.emplace_back([shared, &woken]() {
+                EXPECT_EQ(shared.get(), 1);
+                ++woken;
+            });
+        }
+
+        promise.set_value(1);
+        while (woken.load() != 100) {
+            std::this_thread::yield();
+        }
+        for (auto& other : others) {
+            other.set_value(2);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+TEST(Future, SharedFutureManyContinuations) {
+    auto promise = sharp::Promise<int>{};
+    auto shared = promise.get_future().share();
+    auto order = std::vector<int>{};
+    auto futures = std::vector<sharp::Future<int>>{};
+    for (auto i = 0; i < 10; ++i) {
+        auto copy = shared;
+        futures.push_back(copy.then([&order, i](auto future) {
+            order.push_back(i);
+            return future.get() + i;
+        }));
+    }
+
+    // the continuations run in the order they were attached, and the ones
+    // attached after the result is in run right away
+    promise.set_value(1);
+    auto copy = shared;
+    futures.push_back(copy.then([&order](auto future) {
+        order.push_back(10);
+        return future.get() + 10;
+    }));
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+    for (auto i = 0; i < 11; ++i) {
+        EXPECT_EQ(futures[i].get(), i + 1);
+    }
+}
+
+TEST(Future, SharedFutureConcurrentContinuations) {
+    for (auto i = 0; i < 100; ++i) {
+        auto promise = sharp::Promise<int>{};
+        auto shared = promise.get_future().share();
+        std::atomic<int> ran{0};
+        auto threads = std::vector<std::thread>{};
+        for (auto j = 0; j < 4; ++j) {
+            threads.emplace_back([shared, &ran]() mutable {
+                for (auto k = 0; k < 10; ++k) {
+                    auto copy = shared;
+                    copy.then([&ran](auto future) {
+                        EXPECT_EQ(future.get(), 1);
+                        return ++ran;
+                    });
+                }
+            });
+        }
+        promise.set_value(1);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(ran.load(), 40);
+    }
+}
+
+TEST(Future, SharedFutureWhenAnyLeavesOtherContinuations) {
+    auto promise_one = sharp::Promise<int>{};
+    auto promise_two = sharp::Promise<int>{};
+    auto one = promise_one.get_future().share();
+    auto two = promise_two.get_future().share();
+    auto copy = two;
+    auto other = copy.then([](auto future) { return future.get(); });
+
+    auto any = sharp::when_any(one, two);
+    promise_one.set_value(1);
+    EXPECT_EQ(std::get<0>(any.get()).get(), 1);
+
+    // when_any() finishing does not take the other continuation off two
+    promise_two.set_value(2);
+    EXPECT_EQ(other.get(), 2);
+}
+
 TEST(Future, GetSetSpeedTest) {
 
     const auto LIMIT = 100000;
@@ -680,3 +882,555 @@ TEST(Future, MakeExceptionalFutureWithExceptionPtr) {
         EXPECT_EQ(value, 1.0);
     }
 }
+
+TEST(Future, SharedFutureManyWaiters) {
+    for (auto i = 0; i < 100; ++i) {
+        auto promise = sharp::Promise<int>{};
+        auto future = promise.get_future().share();
+
+        // every thread blocked on the shared state should be woken up
+        auto threads = std::vector<std::thread>{};
+        std::atomic<int> sum{0};
+        for (auto j = 0; j < 4; ++j) {
+            threads.emplace_back([future, &sum]() {
+                sum.fetch_add(future.get());
+            });
+        }
+
+        promise.set_value(2);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(sum.load(), 8);
+    }
+}
+
+TEST(Future, ThenRacesWithSetValue) {
+    // the callback and the value are published by different threads, the
+    // callback should run exactly once no matter which comes in first
+    for (auto i = 0; i < 1000; ++i) {
+        auto promise = sharp::Promise<int>{};
+        auto future = promise.get_future();
+
+        auto th = std::thread{[&promise, i]() {
+            promise.set_value(i);
+        }};
+        auto counter = std::make_shared<std::atomic<int>>(0);
+        auto after = future.then([counter](auto future) {
+            counter->fetch_add(1);
+            return future.get() + 1;
+        });
+
+        EXPECT_EQ(after.get(), i + 1);
+        EXPECT_EQ(counter->load(), 1);
+        th.join();
+    }
+}
+
+TEST(Future, SetValueConstructorThrows) {
+    class ThrowsOnCopy {
+    public:
+        explicit ThrowsOnCopy(int value_in) : value{value_in} {}
+        ThrowsOnCopy(const ThrowsOnCopy& other) : value{other.value} {
+            if (this->value == 0) {
+                throw std::runtime_error{"copy"};
+            }
+        }
+        int value;
+    };
+
+    // a failed set should leave the promise free to be set again
+    auto promise = sharp::Promise<ThrowsOnCopy>{};
+    auto future = promise.get_future();
+    EXPECT_THROW(promise.set_value(ThrowsOnCopy{0}), std::runtime_error);
+    EXPECT_FALSE(future.is_ready());
+    promise.set_value(ThrowsOnCopy{1});
+    EXPECT_EQ(future.get().value, 1);
+}
+
+TEST(Future, SharedStateFreedOnAnotherThread) {
+    // the shared states are allocated on this thread and the last references
+    // to them are dropped on another, so their memory ends up in the other
+    // thread's pool
+    auto futures = std::vector<sharp::Future<int>>{};
+    for (auto i = 0; i < 1000; ++i) {
+        auto promise = sharp::Promise<int>{};
+        futures.push_back(promise.get_future());
+        promise.set_value(i);
+    }
+    std::thread{[futures = std::move(futures)]() mutable {
+        for (auto i = 0; i < 1000; ++i) {
+            EXPECT_EQ(futures[i].get(), i);
+        }
+    }}.join();
+
+    // and this thread can keep allocating after that
+    for (auto i = 0; i < 1000; ++i) {
+        auto shared = sharp::make_ready_future(i).share();
+        auto copy = shared;
+        EXPECT_EQ(copy.get(), i);
+    }
+}
+
+namespace {
+
+    /**
+     * An executor that queues closures till they are run by hand
+     */
+    class ManualExecutor : public sharp::Executor {
+    public:
+        void add(sharp::Function<void()> closure) override {
+            ++this->added;
+            this->closures.push_back(std::move(closure));
+        }
+
+        void drain() {
+            while (!this->closures.empty()) {
+                auto closure = std::move(this->closures.front());
+                this->closures.erase(this->closures.begin());
+                closure();
+            }
+        }
+
+        int added{0};
+
+    private:
+        std::vector<sharp::Function<void()>> closures;
+    };
+
+} // namespace <anonymous>
+
+TEST(Future, OverAlignedSharedState) {
+    // values that need more than the default alignment still get it from
+    // the per thread pool, including blocks that are reused
+    struct alignas(128) Aligned {
+        int value;
+    };
+    for (auto i = 0; i < 4; ++i) {
+        auto promise = sharp::Promise<Aligned>{};
+        auto future = promise.get_future().share();
+        promise.set_value(Aligned{i});
+        auto& value = future.get();
+        EXPECT_EQ(value.value, i);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&value) % 128, 0u);
+    }
+}
+
+TEST(Future, SharedStateSize) {
+    // besides the callback a shared state is a handful of words, the
+    // interrupt handler that few shared states use takes two of them
+    using SharedState = sharp::detail::FutureImpl<int>;
+    using Callback = sharp::detail::Callback<void(SharedState&)>;
+    EXPECT_LE(sizeof(SharedState), sizeof(Callback) + 6 * sizeof(void*));
+}
+
+TEST(Future, ThenChainFusedOnOneExecutor) {
+    auto executor = ManualExecutor{};
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().via(&executor)
+        .then([](auto f) { return f.get() + 1; })
+        .then([](auto f) { return f.get() * 2; })
+        .then([](auto f) { return f.get() + 3; })
+        .then([](auto f) { return f.get() * 4; })
+        .then([](auto f) { return f.get() + 5; });
+
+    // the chain is only scheduled once, every continuation after the first
+    // runs inline once the one before it has finished
+    promise.set_value(1);
+    EXPECT_EQ(executor.added, 1);
+    EXPECT_FALSE(future.is_ready());
+    executor.drain();
+    EXPECT_EQ(executor.added, 1);
+    EXPECT_EQ(future.get(), ((1 + 1) * 2 + 3) * 4 + 5);
+}
+
+TEST(Future, ThenChainFusionSwitchesExecutors) {
+    auto one = ManualExecutor{};
+    auto two = ManualExecutor{};
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().via(&one)
+        .then([](auto f) { return f.get() + 1; })
+        .then([](auto f) { return f.get() + 1; })
+        .via(&two)
+        .then([](auto f) { return f.get() + 1; })
+        .then([](auto f) { return f.get() + 1; });
+
+    // a continuation on another executor is always scheduled on it
+    promise.set_value(0);
+    one.drain();
+    EXPECT_EQ(one.added, 1);
+    EXPECT_EQ(two.added, 1);
+    EXPECT_FALSE(future.is_ready());
+    two.drain();
+    EXPECT_EQ(future.get(), 4);
+}
+
+TEST(Future, ThenChainFusionDepthLimit) {
+    // long chains go back through the executor every so often instead of
+    // growing the stack without bound
+    auto executor = ManualExecutor{};
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().via(&executor);
+    for (auto i = 0; i < 1000; ++i) {
+        future = future.then([](auto f) { return f.get() + 1; });
+    }
+
+    promise.set_value(0);
+    executor.drain();
+    EXPECT_GT(executor.added, 1);
+    EXPECT_LT(executor.added, 1000 / 32);
+    EXPECT_EQ(future.get(), 1000);
+}
+
+TEST(Future, ThenChainFusionOnlyFusesLinks) {
+    // a promise set from inside a continuation is not the next link in that
+    // chain, so its continuation is scheduled instead of running in there
+    auto executor = ManualExecutor{};
+    auto other = sharp::Promise<int>{};
+    auto inside = false;
+    auto ran = false;
+    auto unrelated = other.get_future().via(&executor).then([&](auto f) {
+        EXPECT_FALSE(inside);
+        ran = true;
+        return f.get();
+    });
+
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().via(&executor).then([&](auto f) {
+        inside = true;
+        other.set_value(1);
+        inside = false;
+        return f.get();
+    });
+
+    promise.set_value(0);
+    executor.drain();
+    EXPECT_EQ(executor.added, 2);
+    EXPECT_TRUE(ran);
+    EXPECT_EQ(future.get(), 0);
+    EXPECT_EQ(unrelated.get(), 1);
+}
+
+TEST(Future, ThenChainInlineFlatStack) {
+    // a chain on the inline executor that is far too long to run with a
+    // stack frame per continuation, the inline executor runs it in rounds
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future();
+    for (auto i = 0; i < 200000; ++i) {
+        future = future.then([](auto f) { return f.get() + 1; });
+    }
+
+    promise.set_value(0);
+    EXPECT_TRUE(future.is_ready());
+    EXPECT_EQ(future.get(), 200000);
+}
+
+TEST(Future, CancelSkipsPendingContinuations) {
+    auto promise = sharp::Promise<int>{};
+    auto ran = 0;
+    auto future = promise.get_future()
+        .then([&ran](auto f) { ++ran; return f.get() + 1; })
+        .then([&ran](auto f) { ++ran; return f.get() + 1; });
+
+    // the request goes all the way up to the promise, and when the promise
+    // is fulfilled the continuations are skipped
+    EXPECT_FALSE(promise.is_cancellation_requested());
+    future.cancel();
+    EXPECT_TRUE(promise.is_cancellation_requested());
+    promise.set_value(1);
+    EXPECT_EQ(ran, 0);
+    try {
+        future.get();
+        EXPECT_TRUE(false);
+    } catch (sharp::FutureError& error) {
+        EXPECT_EQ(error.code(),
+                  std::make_error_code(sharp::FutureErrorCode::cancelled));
+    }
+}
+
+TEST(Future, CancelRunsInterruptHandler) {
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future();
+    auto interrupted = 0;
+    promise.set_interrupt_handler([&]() {
+        ++interrupted;
+        promise.set_exception(std::make_exception_ptr(
+                    sharp::FutureError{sharp::FutureErrorCode::cancelled}));
+    });
+
+    future.cancel();
+    future.cancel();
+    EXPECT_EQ(interrupted, 1);
+    EXPECT_TRUE(future.is_ready());
+    EXPECT_THROW(future.get(), sharp::FutureError);
+
+    // a handler set after cancellation has been requested runs right away
+    auto other = sharp::Promise<int>{};
+    auto cancelled = other.get_future().then([](auto f) { return f.get(); });
+    cancelled.cancel();
+    other.set_interrupt_handler([&]() { ++interrupted; });
+    EXPECT_EQ(interrupted, 2);
+}
+
+TEST(Future, CancelAfterCompletion) {
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().then([](auto f) { return f.get(); });
+    promise.set_value(1);
+    future.cancel();
+    EXPECT_EQ(future.get(), 1);
+}
+
+TEST(Future, CancelUnwrappedFuture) {
+    auto outer = sharp::Promise<int>{};
+    auto inner = sharp::Promise<int>{};
+    auto inner_future = inner.get_future();
+    auto future = outer.get_future().then([&](auto f) {
+        f.get();
+        return std::move(inner_future);
+    });
+
+    // cancelling reaches the inner future once the outer one has produced
+    // it
+    outer.set_value(1);
+    EXPECT_FALSE(inner.is_cancellation_requested());
+    future.cancel();
+    EXPECT_TRUE(inner.is_cancellation_requested());
+    inner.set_value(2);
+    EXPECT_EQ(future.get(), 2);
+}
+
+TEST(Future, CancelFanOut) {
+    auto promises = std::vector<sharp::Promise<int>>(100);
+    auto futures = std::vector<sharp::Future<int>>{};
+    for (auto& promise : promises) {
+        futures.push_back(promise.get_future().then([](auto f) {
+            return f.get();
+        }));
+    }
+    auto future = sharp::when_all(futures.begin(), futures.end());
+    future.cancel();
+
+    // every producer sees the request and gives up
+    for (auto& promise : promises) {
+        EXPECT_TRUE(promise.is_cancellation_requested());
+        promise.set_exception(std::make_exception_ptr(
+                    sharp::FutureError{sharp::FutureErrorCode::cancelled}));
+    }
+    for (auto& result : future.get()) {
+        EXPECT_THROW(result.get(), sharp::FutureError);
+    }
+}
+
+TEST(Future, CancelStopsAtSharedFuture) {
+    auto promise = sharp::Promise<int>{};
+    auto shared = promise.get_future().share();
+    auto copies = std::vector<sharp::SharedFuture<int>>(4, shared);
+    auto one = copies[0].then([](auto f) { return f.get() + 1; });
+    auto two = copies[1].then([](auto f) { return f.get() + 2; });
+    auto both = sharp::when_all(copies[2], copies[3]);
+
+    // the other continuation still wants the value, so the producer is not
+    // asked to stop
+    one.cancel();
+    both.cancel();
+    EXPECT_FALSE(promise.is_cancellation_requested());
+    promise.set_value(1);
+    EXPECT_EQ(two.get(), 3);
+    EXPECT_EQ(shared.get(), 1);
+    EXPECT_THROW(one.get(), sharp::FutureError);
+}
+
+TEST(Future, SleepFor) {
+    auto timers = std::make_unique<sharp::TimerExecutor>();
+    auto start = std::chrono::steady_clock::now();
+    auto future = sharp::sleep_for(std::chrono::milliseconds{10},
+                                   timers.get());
+    EXPECT_EQ(future.get(), sharp::Unit{});
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds{10});
+}
+
+TEST(Future, WithinTimesOut) {
+    auto timers = std::make_unique<sharp::TimerExecutor>();
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().within(std::chrono::milliseconds{5},
+                                              timers.get());
+    try {
+        future.get();
+        EXPECT_TRUE(false);
+    } catch (sharp::FutureError& error) {
+        EXPECT_EQ(error.code(),
+                  std::make_error_code(sharp::FutureErrorCode::timeout));
+    }
+
+    // the producer is told nobody is waiting anymore
+    EXPECT_TRUE(promise.is_cancellation_requested());
+    promise.set_value(1);
+}
+
+TEST(Future, WithinSucceeds) {
+    auto timers = std::make_unique<sharp::TimerExecutor>();
+    auto promise = sharp::Promise<int>{};
+    auto future = promise.get_future().within(std::chrono::hours{1},
+                                              timers.get());
+    EXPECT_EQ(timers->num_pending_closures(), 1);
+    promise.set_value(1);
+    EXPECT_EQ(future.get(), 1);
+
+    // the timer does not hang around till the deadline
+    EXPECT_EQ(timers->num_pending_closures(), 0);
+    EXPECT_FALSE(promise.is_cancellation_requested());
+}
+
+TEST(Future, WithinReady) {
+    auto timers = std::make_unique<sharp::TimerExecutor>();
+    auto promise = sharp::Promise<int>{};
+    promise.set_value(1);
+    auto future = promise.get_future().within(std::chrono::milliseconds{1},
+                                              timers.get());
+    EXPECT_EQ(timers->num_pending_closures(), 0);
+    EXPECT_EQ(future.get(), 1);
+}
+
+#if SHARP_HAS_COROUTINES
+namespace {
+
+    sharp::Task<int> await_future(sharp::Future<int> future) {
+        co_return co_await future;
+    }
+
+    sharp::Task<int> add_one(int value) {
+        co_return value + 1;
+    }
+
+    sharp::Task<int> recurse(int depth) {
+        if (!depth) {
+            co_return 0;
+        }
+        co_return (co_await recurse(depth - 1)) + 1;
+    }
+
+} // namespace <anonymous>
+
+TEST(Future, AwaitReadyFuture) {
+    auto future = await_future(sharp::make_ready_future(1)).start();
+    EXPECT_TRUE(future.is_ready());
+    EXPECT_EQ(future.get(), 1);
+}
+
+TEST(Future, AwaitFutureResumesOnExecutor) {
+    auto executor = ManualExecutor{};
+    auto promise = sharp::Promise<int>{};
+    auto future = await_future(promise.get_future().via(&executor)).start();
+    EXPECT_FALSE(future.is_ready());
+
+    // the coroutine is resumed through the executor and not on the thread
+    // that fulfilled the promise
+    promise.set_value(2);
+    EXPECT_FALSE(future.is_ready());
+    EXPECT_EQ(executor.added, 1);
+    executor.drain();
+    EXPECT_EQ(future.get(), 2);
+}
+
+TEST(Future, AwaitFutureFromOtherThread) {
+    auto promise = sharp::Promise<int>{};
+    auto future = await_future(promise.get_future()).start();
+    auto th = std::thread{[&]() {
+        promise.set_value(3);
+    }};
+    EXPECT_EQ(future.get(), 3);
+    th.join();
+}
+
+TEST(Future, AwaitFutureException) {
+    auto promise = sharp::Promise<int>{};
+    auto future = await_future(promise.get_future()).start();
+    promise.set_exception(std::make_exception_ptr(std::logic_error{""}));
+    EXPECT_THROW(future.get(), std::logic_error);
+}
+
+TEST(Future, AwaitSharedFuture) {
+    auto promise = sharp::Promise<int>{};
+    auto shared = promise.get_future().share();
+    auto coroutine = [](auto shared) -> sharp::Task<int> {
+        auto& first = co_await shared;
+        auto& second = co_await shared;
+        EXPECT_EQ(&first, &second);
+        co_return first + second;
+    };
+    auto future = coroutine(shared).start();
+    promise.set_value(2);
+    EXPECT_EQ(future.get(), 4);
+    EXPECT_EQ(shared.get(), 2);
+}
+
+TEST(Future, AwaitSharedFutureFromManyCoroutines) {
+    auto promise = sharp::Promise<int>{};
+    auto shared = promise.get_future().share();
+    auto coroutine = [](auto shared) -> sharp::Task<int> {
+        co_return co_await shared;
+    };
+    auto futures = std::vector<sharp::Future<int>>{};
+    for (auto i = 0; i < 10; ++i) {
+        futures.push_back(coroutine(shared).start());
+    }
+    promise.set_value(3);
+    for (auto& future : futures) {
+        EXPECT_EQ(future.get(), 3);
+    }
+}
+
+TEST(Future, TaskIsLazy) {
+    auto ran = false;
+    auto coroutine = [&]() -> sharp::Task<> {
+        ran = true;
+        co_return;
+    };
+    {
+        auto task = coroutine();
+        EXPECT_TRUE(task.valid());
+        EXPECT_FALSE(ran);
+    }
+    EXPECT_FALSE(ran);
+
+    auto executor = ManualExecutor{};
+    auto task = coroutine();
+    auto future = task.start(&executor);
+    EXPECT_FALSE(task.valid());
+    EXPECT_THROW(task.start(), sharp::FutureError);
+    EXPECT_FALSE(ran);
+    executor.drain();
+    EXPECT_TRUE(ran);
+    EXPECT_EQ(future.get(), sharp::Unit{});
+}
+
+TEST(Future, TaskExceptions) {
+    auto thrower = []() -> sharp::Task<int> {
+        throw std::runtime_error{""};
+        co_return 1;
+    };
+    auto catcher = [&]() -> sharp::Task<> {
+        EXPECT_THROW(co_await thrower(), std::runtime_error);
+        co_return;
+    };
+    catcher().start().get();
+    EXPECT_THROW(thrower().start().get(), std::runtime_error);
+}
+
+TEST(Future, TaskSymmetricTransfer) {
+    // tasks that finish without suspending and a deep chain of tasks, control
+    // goes back and forth between them without nesting calls when the
+    // compiler turns the transfers into tail calls.  GCC only does that when
+    // optimizing, so these are kept to what fits on the stack without it
+    auto loop = []() -> sharp::Task<int> {
+        auto value = 0;
+        for (auto i = 0; i < 1000; ++i) {
+            value = co_await add_one(value);
+        }
+        co_return value;
+    };
+    EXPECT_EQ(loop().start().get(), 1000);
+    EXPECT_EQ(recurse(1000).start().get(), 1000);
+}
+#endif
@@ -9,3 +9,5 @@
 #pragma once
 
 #include <sharp/Portability/detail/optional.hpp>
+#include <sharp/Portability/detail/interference.hpp>
+#include <sharp/Portability/detail/uncaught_exceptions.hpp>
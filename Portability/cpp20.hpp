@@ -0,0 +1,12 @@
+/**
+ * @file cpp20.hpp
+ * @author Aaryaman Sagar
+ *
+ * Includes the files that detect features from C++20 which are only
+ * available when the library is compiled as C++20, code that uses these
+ * should be guarded with the macros defined in them
+ */
+
+#pragma once
+
+#include <sharp/Portability/detail/coroutine.hpp>
@@ -0,0 +1,22 @@
+/**
+ * @file coroutine.hpp
+ * @author Aaryaman Sagar
+ *
+ * Defines SHARP_HAS_COROUTINES to 1 and includes <coroutine> if the compiler
+ * supports C++20 coroutines, otherwise SHARP_HAS_COROUTINES is 0.  The
+ * awaitable interfaces in the library are only declared when this is 1, so
+ * the rest of the library still builds as C++14
+ */
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define SHARP_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifndef SHARP_HAS_COROUTINES
+#define SHARP_HAS_COROUTINES 0
+#endif
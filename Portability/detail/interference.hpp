@@ -0,0 +1,25 @@
+/**
+ * @file interference.hpp
+ * @author Aaryaman Sagar
+ *
+ * Contains a stand in for std::hardware_destructive_interference_size from
+ * C++17.  Not all standard libraries ship the constant yet, and the ones that
+ * do warn when it leaks into an ABI, so this just hardcodes the common value
+ * for the platforms that this library is built on
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace sharp {
+
+/**
+ * The minimum offset between two objects to avoid false sharing, i.e. the
+ * size of a cache line on x86-64 and most ARM64 cores.  Data that is written
+ * to by different threads concurrently should be laid out at least this far
+ * apart
+ */
+constexpr std::size_t hardware_destructive_interference_size = 64;
+
+} // namespace sharp
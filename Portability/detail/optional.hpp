@@ -1070,6 +1070,8 @@ namespace std {
     constexpr auto in_place = std::experimental::in_place;
 
 } // namespace std
+#else
+# include <optional>
 #endif
 
 # endif //___OPTIONAL_HPP___
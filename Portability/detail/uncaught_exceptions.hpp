@@ -0,0 +1,30 @@
+/**
+ * @file uncaught_exceptions.hpp
+ * @author Aaryaman Sagar
+ *
+ * Contains a stand in for std::uncaught_exceptions() from C++17.  When the
+ * standard library does not have it this falls back to the C++14
+ * std::uncaught_exception(), which only says whether there are any
+ */
+
+#pragma once
+
+#include <exception>
+
+namespace sharp {
+
+/**
+ * The number of exceptions currently being propagated on this thread, or
+ * just 1 if there are any when the count is not available.  An object that
+ * compares this on construction and destruction can tell whether it is
+ * being destroyed because of an exception
+ */
+inline int uncaught_exceptions() noexcept {
+#if defined(__cpp_lib_uncaught_exceptions)
+    return std::uncaught_exceptions();
+#else
+    return std::uncaught_exception() ? 1 : 0;
+#endif
+}
+
+} // namespace sharp
@@ -22,6 +22,7 @@
 
 #include <sharp/Tags/Tags.hpp>
 
+#include <cstddef>
 #include <utility>
 #include <cassert>
 #include <iterator>
@@ -128,6 +129,13 @@ public:
      */
     NodeIterator erase(NodeIterator iterator) noexcept;
 
+    /**
+     * Remove the given node from the list, this is useful when the node is
+     * all that is at hand, for example when a node is owned by an object on
+     * the stack that needs to take itself off the list before it goes away
+     */
+    NodeIterator erase(TransparentNode<Type>* node_to_erase) noexcept;
+
     /**
      * Return an iterator to the beginning of the linked list
      */
@@ -75,6 +75,11 @@ public:
         return *this;
     }
 
+    /**
+     * Iterators are cheap to copy around, they are just a pointer
+     */
+    NodeIterator(const NodeIterator&) noexcept = default;
+
     /**
      * Assignment operator to assign to and from an iterator
      */
@@ -276,8 +281,20 @@ TransparentList<Type>::erase(TransparentList<Type>::NodeIterator iterator)
         }
         return iterator_to_return;
     }
-    assert(this->tail != this->head);
+
+    // if this was the last node in the list then the one before it is the
+    // new last node
+    if (this->tail == iterator.node_ptr) {
+        this->tail = this->tail->prev;
+    }
+    assert(this->tail != this->head || !this->head->next);
     return iterator_to_return;
 }
 
+template <typename Type>
+typename TransparentList<Type>::NodeIterator
+TransparentList<Type>::erase(TransparentNode<Type>* node_to_erase) noexcept {
+    return this->erase(NodeIterator{node_to_erase});
+}
+
 } // namespace sharp
@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <iostream>
@@ -197,6 +198,31 @@ TEST(TransparentList, test_increment_decrement_iterators) {
     EXPECT_EQ(iter, list.end());
 }
 
+TEST(TransparentList, test_erase_node) {
+    auto list = sharp::TransparentList<int>{};
+    auto one = TransparentNode<int>{emplace_construct::tag, 1};
+    auto two = TransparentNode<int>{emplace_construct::tag, 2};
+    auto three = TransparentNode<int>{emplace_construct::tag, 3};
+    list.push_back(&one);
+    list.push_back(&two);
+    list.push_back(&three);
+
+    // erasing the last node should leave the one before it at the back
+    list.erase(&three);
+    auto four = TransparentNode<int>{emplace_construct::tag, 4};
+    list.push_back(&four);
+    auto vec = std::vector<int>{};
+    for (auto node : list) {
+        vec.push_back(node->datum);
+    }
+    EXPECT_EQ(vec, (std::vector<int>{1, 2, 4}));
+
+    list.erase(&two);
+    list.erase(&one);
+    list.erase(&four);
+    EXPECT_EQ(list.begin(), list.end());
+}
+
 TEST(TransparentList, test_insert) {
     auto list = sharp::TransparentList<int>{};
     auto one = make_unique<TransparentNode<int>>(emplace_construct::tag, 1);